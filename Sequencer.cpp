@@ -3,6 +3,8 @@
 #include <chrono>
 #include <csignal>
 #include <syslog.h>
+#include <string>
+#include <getopt.h>
 
 
 extern "C" {
@@ -10,89 +12,356 @@ extern "C" {
     #include <rte_ethdev.h>
     #include <rte_mbuf.h>
     #include <rte_ring.h>
+    #include <rte_mempool.h>
     #include "packet_logger.h"
     #include "server_service.h"
+    #include "rules.h"
+    #include "burst_classify.h"
+    #include "flow_table.h"
+    #include "heavy_hitters.h"
+    #include "log_writer.h"
+    #include "pkt_latency.h"
+    #include "dashboard.h"
+    #include "overload.h"
+    #include "alert.h"
+    #include "bpf_filter.h"
 
 }
 
 pthread_t rx_thread, detect_thread, log_thread, led_thread;
 
+extern "C" bool service_budget_left(void) { return Service::budgetLeft(); }
+extern "C" void service_report_items(uint64_t items, uint64_t backlog) { Service::reportItems(items, backlog); }
+extern "C" const struct idle_policy *service_idle_policy(void) { return Service::idlePolicy(); }
+
+// Set while the services run, for readers on other threads (the metrics endpoint)
+static std::atomic<Sequencer*> running_sequencer{nullptr};
+extern "C" unsigned service_get_metrics(struct service_metrics *out, unsigned max) {
+    Sequencer* sequencer = running_sequencer.load(std::memory_order_acquire);
+    return sequencer ? sequencer->getMetrics(out, max) : 0;
+}
+
+static unsigned run_duration_s = 0;  // 0 = run until SIGINT/SIGTERM
+static constexpr int ANALYSIS_INTERVAL_S = 5;
+static volatile sig_atomic_t dump_requested = 0;  // SIGUSR1: write <service>_hist.csv and pkt_latency_hist.csv now
+static volatile sig_atomic_t bpf_reload_requested = 0;  // SIGHUP: load the --bpf program again
+static const char *rules_path = RULES_DEFAULT_FILE;
+static enum burst_impl classifier_impl = BURST_IMPL_AUTO;
+static ServiceBackend service_backend = ServiceBackend::Thread;
+static struct idle_policy poll_idle_policy{};  // RX/DETECT; busy unless --idle says otherwise
+static std::string alert_sinks = "syslog,led";
+static uint32_t alert_window_ms = ALERT_WINDOW_MS;
+static const char *bpf_spec = nullptr;
+
+// Application options follow the EAL ones after "--":
+//   --rx-queues N   spread RX over N RSS queues, each with its own RX/DETECT pair
+//   --duration S    stop after S seconds (used by the benchmark scripts)
+//   --rules FILE    detection rule file (default rules.conf)
+//   --classifier X  force the burst classifier: scalar, sse4.2, avx2 (default: best available)
+//   --flow-limits P:S:N:T  flood pps, SYN/s, new flows/s per host pair, idle timeout (s); 0 disables
+//   --idle MODE     RX/DETECT idle behaviour: busy (default) or
+//                   adaptive[:SPIN:PAUSE:POWER:POWER_US:SLEEP_US] (see idle_poll.h)
+//   --backend B     service threads: thread (default) or lcore, which needs
+//                   every service core in the EAL -l list (see lcore_backend.h)
+//   --retain R      packets kept past DETECT and written to threats.pcap:
+//                   none (default), threats or all
+//   --overload P    SAFE records shed at DETECT when detected_ring passes its
+//                   high watermark: none (default), sample[:N] or summarize,
+//                   optionally :HIGH:LOW in percent (see overload.h)
+//   --alerts SINKS  where threat alerts go, comma-separated: syslog, led[:PATH],
+//                   http:HOST:PORT/PATH (default syslog,led; see alert.h)
+//   --alert-window MS  alerts of one flow are coalesced over MS (default 1000)
+//   --bpf FILE[:SECTION]  eBPF prefilter run by DETECT ahead of the rules
+//                   (see bpf_filter.h); SIGHUP reloads it without stopping
+static int parse_app_args(int argc, char *argv[]) {
+    static const struct option long_opts[] = {
+        {"rx-queues", required_argument, nullptr, 'q'},
+        {"duration",  required_argument, nullptr, 'd'},
+        {"rules",     required_argument, nullptr, 'r'},
+        {"classifier", required_argument, nullptr, 'c'},
+        {"flow-limits", required_argument, nullptr, 'f'},
+        {"idle",      required_argument, nullptr, 'i'},
+        {"backend",   required_argument, nullptr, 'b'},
+        {"retain",    required_argument, nullptr, 'k'},
+        {"overload",  required_argument, nullptr, 'o'},
+        {"alerts",    required_argument, nullptr, 'a'},
+        {"alert-window", required_argument, nullptr, 'w'},
+        {"bpf",       required_argument, nullptr, 'p'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    optind = 1;
+    while ((opt = getopt_long(argc, argv, "q:d:r:c:f:i:b:k:o:a:w:p:", long_opts, nullptr)) != -1) {
+        switch (opt) {
+        case 'q': {
+            long n = strtol(optarg, nullptr, 10);
+            if (n < 1 || n > MAX_RX_QUEUES) {
+                syslog(LOG_ERR, "--rx-queues must be 1..%d", MAX_RX_QUEUES);
+                return -1;
+            }
+            nb_rx_queues = (uint16_t)n;
+            break;
+        }
+        case 'd':
+            run_duration_s = (unsigned)strtoul(optarg, nullptr, 10);
+            break;
+        case 'r':
+            rules_path = optarg;
+            break;
+        case 'c': {
+            std::string impl = optarg;
+            if (impl == "scalar")      classifier_impl = BURST_IMPL_SCALAR;
+            else if (impl == "sse4.2") classifier_impl = BURST_IMPL_SSE42;
+            else if (impl == "avx2")   classifier_impl = BURST_IMPL_AVX2;
+            else if (impl != "auto") {
+                syslog(LOG_ERR, "Unknown classifier '%s'", optarg);
+                return -1;
+            }
+            break;
+        }
+        case 'f':
+            if (sscanf(optarg, "%u:%u:%u:%u", &flow_limits.pps, &flow_limits.syn_ps,
+                       &flow_limits.new_flows_ps, &flow_limits.idle_timeout_s) != 4) {
+                syslog(LOG_ERR, "--flow-limits expects PPS:SYN:NEWFLOWS:TIMEOUT");
+                return -1;
+            }
+            break;
+        case 'i':
+            if (idle_policy_parse(optarg, &poll_idle_policy) < 0) {
+                syslog(LOG_ERR, "--idle expects busy or adaptive[:SPIN:PAUSE:POWER:POWER_US:SLEEP_US]");
+                return -1;
+            }
+            break;
+        case 'b': {
+            std::string backend = optarg;
+            if (backend == "thread")     service_backend = ServiceBackend::Thread;
+            else if (backend == "lcore") service_backend = ServiceBackend::Lcore;
+            else {
+                syslog(LOG_ERR, "Unknown backend '%s'", optarg);
+                return -1;
+            }
+            break;
+        }
+        case 'k': {
+            std::string retain = optarg;
+            if (retain == "none")         retain_policy = RETAIN_NONE;
+            else if (retain == "threats") retain_policy = RETAIN_THREATS;
+            else if (retain == "all")     retain_policy = RETAIN_ALL;
+            else {
+                syslog(LOG_ERR, "--retain expects none, threats or all");
+                return -1;
+            }
+            break;
+        }
+        case 'o':
+            if (overload_parse(optarg, &overload_config) < 0) {
+                syslog(LOG_ERR, "--overload expects none, sample[:N] or summarize, then optional :HIGH:LOW");
+                return -1;
+            }
+            break;
+        case 'a':
+            alert_sinks = optarg;
+            break;
+        case 'w':
+            alert_window_ms = (uint32_t)strtoul(optarg, nullptr, 10);
+            break;
+        case 'p':
+            bpf_spec = optarg;
+            break;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     openlog("PthreadService", LOG_PID | LOG_CONS | LOG_PERROR, LOG_USER);
     syslog(LOG_INFO, "Starting DPDK packet sniffer with sequencer-controlled services...");
 
     // Initialize DPDK
-    if (rte_eal_init(argc, argv) < 0) {
+    int eal_args = rte_eal_init(argc, argv);
+    if (eal_args < 0) {
         syslog(LOG_ERR, "Failed to initialize DPDK EAL");
         return -1;
     }
+    if (parse_app_args(argc - eal_args, argv + eal_args) < 0)
+        return -1;
 
     // Setup signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, [](int) { dump_requested = 1; });
+    signal(SIGHUP, [](int) { bpf_reload_requested = 1; });
 
-    // Create mbuf pool
-    mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL", NUM_MBUFS, MBUF_CACHE_SIZE, 0,
+    // Compile detection rules before any traffic is accepted
+    if (rules_load(rules_path) < 0) {
+        syslog(LOG_ERR, "Failed to load detection rules from %s", rules_path);
+        return -1;
+    }
+    burst_classify_init(classifier_impl);
+    if (pkt_latency_init() < 0)
+        return -1;
+
+    // Create mbuf pool (each extra queue pins another RX ring's worth of mbufs)
+    mbuf_pool = rte_pktmbuf_pool_create("MBUF_POOL", NUM_MBUFS * nb_rx_queues, MBUF_CACHE_SIZE, 0,
                                         RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
     if (!mbuf_pool) {
         syslog(LOG_ERR, "Cannot create mbuf pool");
         return -1;
     }
 
-    // Configure Ethernet port
-    struct rte_eth_conf port_conf = {};
-    if (rte_eth_dev_configure(port_id, 1, 0, &port_conf) < 0 ||
-        rte_eth_rx_queue_setup(port_id, 0, RX_RING_SIZE, rte_eth_dev_socket_id(port_id), NULL, mbuf_pool) < 0 ||
-        rte_eth_dev_start(port_id) < 0) {
-        syslog(LOG_ERR, "Failed to configure/start port %u", port_id);
+    // Create detection descriptor pool (replaces per-packet malloc in RX)
+    unsigned nb_results = NUM_RESULTS + (nb_rx_queues - 1) * PACKET_RING_SIZE;
+    result_pool = rte_mempool_create(RESULT_POOL_NAME, nb_results, sizeof(struct detection_result),
+                                     RESULT_CACHE_SIZE, 0, NULL, NULL, NULL, NULL, rte_socket_id(), 0);
+    if (!result_pool) {
+        syslog(LOG_ERR, "Cannot create detection result pool");
         return -1;
     }
 
-    // Create CSV output
-    csv_file = fopen("packet_logger.csv", "w");
-    if (!csv_file) {
-        syslog(LOG_ERR, "Failed to open CSV file");
+    // Configure Ethernet port, with RSS when more than one RX queue is requested
+    struct rte_eth_dev_info dev_info;
+    if (rte_eth_dev_info_get(port_id, &dev_info) < 0 || nb_rx_queues > dev_info.max_rx_queues) {
+        syslog(LOG_ERR, "Port %u cannot provide %u RX queues", port_id, nb_rx_queues);
+        return -1;
+    }
+    struct rte_eth_conf port_conf = {};
+    if (nb_rx_queues > 1) {
+        port_conf.rxmode.mq_mode = RTE_ETH_MQ_RX_RSS;
+        port_conf.rx_adv_conf.rss_conf.rss_hf =
+            (RTE_ETH_RSS_IP | RTE_ETH_RSS_TCP | RTE_ETH_RSS_UDP) & dev_info.flow_type_rss_offloads;
+        if (port_conf.rx_adv_conf.rss_conf.rss_hf == 0) {
+            // e.g. net_ring: every queue is already its own ring, nothing to hash
+            syslog(LOG_WARNING, "Port %u has no RSS offloads, queues are fed by the driver", port_id);
+            port_conf.rxmode.mq_mode = RTE_ETH_MQ_RX_NONE;
+        }
+    }
+    if (rte_eth_dev_configure(port_id, nb_rx_queues, 0, &port_conf) < 0) {
+        syslog(LOG_ERR, "Failed to configure port %u", port_id);
+        return -1;
+    }
+    for (uint16_t q = 0; q < nb_rx_queues; q++) {
+        if (rte_eth_rx_queue_setup(port_id, q, RX_RING_SIZE, rte_eth_dev_socket_id(port_id), NULL, mbuf_pool) < 0) {
+            syslog(LOG_ERR, "Failed to set up RX queue %u on port %u", q, port_id);
+            return -1;
+        }
+    }
+    if (rte_eth_dev_start(port_id) < 0) {
+        syslog(LOG_ERR, "Failed to start port %u", port_id);
         return -1;
     }
-    fprintf(csv_file, "Timestamp,Source MAC,Destination MAC,Threat Status\n");
 
-    // Create rings
+    // Binary packet log; convert with logbin2csv.py. Retained packets share its thread
+    if (retain_policy != RETAIN_NONE && log_writer_capture_open(LOG_CAPTURE_FILE) < 0)
+        return -1;
+    if (log_writer_start(LOG_BIN_FILE, LOG_WRITER_CORE) < 0)
+        return -1;
+
+    // Alert thread, woken by DETECT through an eventfd
+    alert_set_window(alert_window_ms);
+    if (alert_add_sinks(alert_sinks.c_str()) < 0 || alert_start(LOG_WRITER_CORE, nb_rx_queues > 1) < 0)
+        return -1;
+
+    // Create rings: one RX->DETECT ring per queue, all DETECT stages share detected_ring
     // New
-    packet_ring = rte_ring_create(PACKET_RING_NAME, 2048, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
-    detected_ring = rte_ring_create(DETECTED_RING_NAME, 8192, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    for (uint16_t q = 0; q < nb_rx_queues; q++) {
+        std::string name = std::string(PACKET_RING_NAME) + "_" + std::to_string(q);
+        packet_rings[q] = rte_ring_create(name.c_str(), PACKET_RING_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!packet_rings[q]) {
+            syslog(LOG_ERR, "Failed to create rings");
+            return -1;
+        }
+    }
+    unsigned detected_flags = RING_F_SC_DEQ | (nb_rx_queues == 1 ? RING_F_SP_ENQ : 0);
+    detected_ring = rte_ring_create(DETECTED_RING_NAME, DETECTED_RING_SIZE, rte_socket_id(), detected_flags);
+    threat_ring = rte_ring_create(THREAT_RING_NAME, THREAT_RING_SIZE, rte_socket_id(), detected_flags);
 
     //packet_ring = rte_ring_create(PACKET_RING_NAME, 1024, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
     //detected_ring = rte_ring_create(DETECTED_RING_NAME, 1024, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
-    if (!packet_ring || !detected_ring) {
+    if (!detected_ring || !threat_ring) {
         syslog(LOG_ERR, "Failed to create rings");
         return -1;
     }
+    if (overload_config.policy != OVERLOAD_NONE)
+        syslog(LOG_INFO, "[OVERLOAD] %s SAFE records above %u%% of detected_ring, until below %u%%",
+               overload_policy_name(overload_config.policy), overload_config.high_pct, overload_config.low_pct);
+
+    // Prefilter before DETECT starts, so the first burst already runs it
+    if (bpf_filter_init(nb_rx_queues) < 0 || (bpf_spec && bpf_filter_load(bpf_spec) < 0))
+        return -1;
 
     // Create Sequencer
-    Sequencer sequencer;
+    Sequencer sequencer(service_backend);
     int max_priority = sched_get_priority_max(SCHED_FIFO);
 
 
     // Add services directly (real functional services)
-    sequencer.addService(rx_service,     "RX",     RX_CORE_ID,        max_priority, INFINITE_PERIOD);   // RX service: every 5 ms
-    sequencer.addService(detect_service, "DETECT", DETECTION_CORE_ID, max_priority, INFINITE_PERIOD);   // Detection service: every 5 ms
-    sequencer.addService(server_service,    "LED",    LOGGER_CORE_ID,    max_priority-1, 10);   // LED service: every 5 ms
-    sequencer.addService(logger_service, "LOGGER", LOGGER_CORE_ID,    max_priority, 5);  // Logger service: every 10 ms
+    // One RX/DETECT pair per RX queue; queue 0 keeps the original names and cores
+    for (uint16_t q = 0; q < nb_rx_queues; q++) {
+        std::string suffix = q == 0 ? "" : std::to_string(q);
+        sequencer.addService([q] { rx_service(q); },     "RX" + suffix,     RX_QUEUE_CORE(q),     max_priority, INFINITE_PERIOD);
+        sequencer.addService([q] { detect_service(q); }, "DETECT" + suffix, DETECT_QUEUE_CORE(q), max_priority, INFINITE_PERIOD);
+        sequencer.setIdlePolicy("RX" + suffix, poll_idle_policy);
+        sequencer.setIdlePolicy("DETECT" + suffix, poll_idle_policy);
+    }
+    sequencer.addService(server_service,    "LED",    LOGGER_CORE_ID,    max_priority-1, 10000, 1000);   // HTTP/metrics: every 10 ms, scrapes for up to 1 ms
+    sequencer.addService(logger_service, "LOGGER", LOGGER_CORE_ID,    max_priority, 5000, 2000);  // Logger service: every 5 ms, drains for up to 2 ms
 
 
     // Start the sequencer
-    sequencer.startServices();
+    if (!sequencer.startServices()) {
+        force_quit = true;      // lets services already on lcores return
+        sequencer.stopServices();
+        return -1;
+    }
+    running_sequencer.store(&sequencer, std::memory_order_release);
 
+    // Screen on the main lcore at normal priority, never on a service core
+    if (dashboard_start(&pipeline_dashboard, LOG_WRITER_CORE, nullptr) < 0)
+        syslog(LOG_WARNING, "Running without the dashboard");
 
 
+
+    auto run_start = std::chrono::steady_clock::now();
+    auto last_analysis = run_start;
+
     // Run system
 while (!force_quit) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // Re-run the response-time analysis with the WCETs measured so far
+        if (std::chrono::steady_clock::now() - last_analysis >= std::chrono::seconds(ANALYSIS_INTERVAL_S)) {
+            last_analysis = std::chrono::steady_clock::now();
+            sequencer.analyzeSchedulability(false);
+        }
+        if (run_duration_s && std::chrono::steady_clock::now() - run_start >= std::chrono::seconds(run_duration_s))
+            force_quit = true;
+        if (dump_requested) {
+            dump_requested = 0;
+            sequencer.dumpHistograms();
+            pkt_latency_write_csv(PKT_LAT_CSV_FILE);
+            pkt_latency_log();
+        }
+        // Swap in the rebuilt program; on failure the running one stays
+        if (bpf_reload_requested) {
+            bpf_reload_requested = 0;
+            if (bpf_spec)
+                bpf_filter_load(bpf_spec);
+            else
+                syslog(LOG_WARNING, "[BPF] SIGHUP ignored, no --bpf program to reload");
+        }
     }
 
 
     // Stop the sequencer
-    sequencer.stopServices();
+    running_sequencer.store(nullptr, std::memory_order_release);
+    sequencer.stopServices();     // joins DETECT: no alert_raise() past here
+    dashboard_stop();
+    alert_stop();
+    log_writer_stop();
+    sequencer.analyzeSchedulability(true);
+    syslog(LOG_INFO, "[SEQUENCER] Deadline overruns: %" PRIu64 "\n", sequencer.getOverruns());
+    double run_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
 
 
     struct rte_eth_stats stats;
@@ -102,8 +371,62 @@ while (!force_quit) {
     } else {
         syslog(LOG_INFO,"Failed to get Ethernet stats!\n");
     }
+    uint64_t pool_exhausted = 0, total_detected = 0;
+    for (uint16_t q = 0; q < nb_rx_queues; q++) {
+        std::string rx_name = "RX" + std::to_string(q), detect_name = "DETECT" + std::to_string(q);
+        print_stage_stats(rx_name.c_str(), &rx_stats[q]);
+        print_stage_stats(detect_name.c_str(), &detect_stats[q]);
+        total_rx += rx_stats[q].objs;
+        total_detected += detect_stats[q].objs;
+        pool_exhausted += result_pool_exhausted[q];
+
+        if (flow_tables[q]) {
+            struct flow_table_stats fs;
+            flow_table_get_stats(flow_tables[q], &fs);
+            syslog(LOG_INFO, "[FLOW%u] active %u/%u, inserts %" PRIu64 ", evictions %" PRIu64
+                   ", insert failures %" PRIu64 ", alerts %" PRIu64 ", %zu bytes/flow\n",
+                   q, fs.active, fs.capacity, fs.inserts, fs.evictions, fs.insert_failures,
+                   fs.alerts, flow_table_memory(flow_tables[q]) / fs.capacity);
+            // DETECT, its only writer, was joined in stopServices()
+            flow_table_free(flow_tables[q]);
+            flow_tables[q] = nullptr;
+        }
+        // Readers are the LED service (joined above) and the dashboard (stopped)
+        hh_free(top_src_mac[q]);
+        hh_free(top_src_ip[q]);
+        top_src_mac[q] = top_src_ip[q] = nullptr;
+    }
+    print_stage_stats("LOGGER", &logger_stats);
+    print_stage_stats("LOGGER threat lane", &threat_lane_stats);
+    pkt_latency_log();
+    pkt_latency_write_csv(PKT_LAT_CSV_FILE);
+    struct log_writer_stats ls;
+    log_writer_get_stats(&ls);
+    syslog(LOG_INFO, "[LOGWRITER] records %" PRIu64 ", dropped %" PRIu64 ", %" PRIu64 " writes, %" PRIu64 " bytes, "
+           "%" PRIu64 " packets captured, %" PRIu64 " capture drops\n",
+           ls.records, ls.dropped, ls.writes, ls.bytes, ls.captured, ls.capture_dropped);
+    struct dashboard_stats ds;
+    dashboard_get_stats(&ds);
+    syslog(LOG_INFO, "[DASHBOARD] %" PRIu64 " refreshes, %" PRIu64 " records pushed, %" PRIu64 " torn reads\n",
+           ds.refreshes, ds.pushed, ds.torn);
+    struct alert_stats as;
+    alert_get_stats(&as);
+    syslog(LOG_INFO, "[ALERT] %" PRIu64 " events raised, %" PRIu64 " dropped, %" PRIu64 " wakeups, %" PRIu64 " alerts, "
+           "%" PRIu64 " follow-ups, %" PRIu64 " coalesced, %" PRIu64 " sink errors\n",
+           as.raised, as.dropped, as.wakeups, as.alerts, as.follow_ups, as.coalesced, as.sink_errors);
+    struct bpf_filter_stats bs[BPF_FILTER_HISTORY];
+    unsigned nb_bpf = bpf_filter_get_stats(bs, BPF_FILTER_HISTORY);
+    for (unsigned i = 0; i < nb_bpf; i++)
+        syslog(LOG_INFO, "[BPF] generation %u %s (%s%s): %" PRIu64 " packets, %" PRIu64 " THREAT, %" PRIu64
+               " SAFE, %.1f ns/packet\n", bs[i].generation, bs[i].name, bs[i].jit ? "JIT" : "interpreter",
+               bs[i].active ? ", active" : "", bs[i].packets, bs[i].threats, bs[i].safe, bs[i].ns_per_packet);
+    // Only now: stopServices() has joined DETECT, the last user of the QSBR
+    bpf_filter_free();
+    syslog(LOG_INFO, "Result pool: %u in use of %u, exhausted drops: %" PRIu64 "\n",
+           rte_mempool_in_use_count(result_pool), nb_results, pool_exhausted);
+    syslog(LOG_INFO, "RX rate: %.0f pps, DETECT rate: %.0f pps over %.2f s (rx queues = %u)\n",
+           total_rx / run_s, total_detected / run_s, run_s, nb_rx_queues);
 
-    fclose(csv_file);
     rte_eth_dev_stop(port_id);
     rte_eth_dev_close(port_id);
     rte_eal_cleanup();
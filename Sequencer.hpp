@@ -12,10 +12,13 @@
  */
 extern "C" {
     #include "packet_logger.h"
+    #include "latency_hist.h"
+    #include "lcore_backend.h"
 }
 #pragma once
 
 #include <cstdint>
+#include <cinttypes>
 #include <functional>
 #include <thread>
 #include <vector>
@@ -27,17 +30,28 @@ extern "C" {
 #include <iostream>
 #include <syslog.h>
 #include <limits>
-#include <mutex>
 #include <algorithm>
-#include <queue>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <cerrno>
+#include <cstdlib>
+#include <cmath>
+#include <string>
 #include <atomic>
 #include <thread>
 
 
 
+// Where a service's thread comes from: a std::jthread pinned by hand, or an
+// EAL lcore (see lcore_backend.h), which DPDK recognizes for rte_lcore_id()
+// and per-lcore mempool caches
+enum class ServiceBackend { Thread, Lcore };
+
 // The service class contains the service function and service parameters
-// (priority, affinity, etc). It spawns a thread to run the service, configures
-// the thread as required, and executes the service whenever it gets released.
+// (priority, affinity, etc). Once started it runs the service on its own
+// thread, configures the thread as required, and executes the service
+// whenever it gets released.
 
 class Service
 {
@@ -48,8 +62,12 @@ public:
     Service(const Service&) = delete;
     Service& operator=(const Service&) = delete;
 
+    // budgetUs: execution budget per release; the service keeps batching work
+    // while service_budget_left() is true. 0 = one batch per release.
+    // period is in microseconds (INFINITE_PERIOD = released once at start)
     template<typename T>
-    Service(T&& doService, const std::string& serviceName, uint8_t affinity, uint8_t priority, uint32_t period) :
+    Service(T&& doService, const std::string& serviceName, uint8_t affinity, uint8_t priority, uint32_t period,
+            uint32_t budgetUs = 0) :
         _doService(std::forward<T>(doService)),
         _serviceName(serviceName),
         _service(),
@@ -57,19 +75,37 @@ public:
         _affinity(affinity),
         _priority(priority),
         _period(period),
-        _minJitter(std::numeric_limits<double>::max()),
-        _minExecTime(std::numeric_limits<double>::max())
+        _budgetUs(budgetUs)
     {
+        lhist_reset(&_execHist);
+        lhist_reset(&_jitterHist);
+        lhist_reset(&_periodJitterHist);
         sem_init(&_sem, 0, 0);
-        _service = std::jthread(&Service::_provideService, this);
-        _csvFile = fopen((_serviceName + "_exec_times.csv").c_str(), "w");
-        if (_period != INFINITE_PERIOD) {   // Only for periodic services
-        _csvFile = fopen((_serviceName + "_exec_times.csv").c_str(), "w");
-        if (_csvFile) {
-            fprintf(_csvFile, "ExecutionTime_us\n");
-            fflush(_csvFile);
-        }
     }
+
+    // Lcore falls back to a pinned, EAL-registered thread when the core is
+    // the main lcore or already hosts a service. Fails if the core is not
+    // in the EAL coremask.
+    bool start(ServiceBackend backend) {
+        if (backend == ServiceBackend::Lcore) {
+            if (lcore_backend_check(_affinity) < 0) {
+                syslog(LOG_ERR, "[SEQUENCER] %s: core %u is not an EAL lcore (check -l)",
+                       _serviceName.c_str(), _affinity);
+                return false;
+            }
+            int ret = lcore_backend_launch(_affinity, &Service::_lcoreEntry, this);
+            if (ret == 0) {
+                _onLcore = true;
+                return true;
+            }
+            if (ret != -EBUSY) {
+                syslog(LOG_ERR, "[SEQUENCER] %s: cannot launch on lcore %u", _serviceName.c_str(), _affinity);
+                return false;
+            }
+            _registerLcore = true;
+        }
+        _service = std::jthread(&Service::_provideService, this);
+        return true;
     }
 
     void stop(){
@@ -77,26 +113,135 @@ public:
         sem_post(&_sem);
     }
 
-    void release(){
-        struct timespec releaseTime;
-        clock_gettime(CLOCK_MONOTONIC, &releaseTime);
-        {
-            std::lock_guard<std::mutex> lock(_releaseMutex);
-            _releaseTimes.push(releaseTime);
+    // After stop(): block until the service has returned from its lcore or
+    // thread, so nothing polls the port once the caller closes it and cleans
+    // up EAL, and nothing still uses state the caller tears down
+    void join(){
+        if (_onLcore) {
+            lcore_backend_wait(_affinity);
+            _onLcore = false;
+        }
+        if (_service.joinable())
+            _service.join();
+    }
+
+    // releaseTime is the scheduled release instant, so start jitter includes
+    // the sequencer's own wakeup latency. A release that arrives while the
+    // previous one has not started yet is counted as missed and dropped.
+    // The instant travels through a single atomic slot: one writer (the
+    // release thread), one reader (the service thread), no lock.
+    // A release that finds the previous execution still running is a
+    // deadline overrun (implicit deadline = period), whether or not it is
+    // also missed.
+    bool release(const struct timespec& releaseTime){
+        if (_executing.load(std::memory_order_relaxed))
+            _overruns.fetch_add(1, std::memory_order_relaxed);
+        int pending = 0;
+        sem_getvalue(&_sem, &pending);
+        if (pending > 0) {
+            _missedReleases.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+        _releaseSlot.store(toNs(releaseTime), std::memory_order_release);
         sem_post(&_sem);
+        return true;
     }
 
     ~Service()
     {
         stop();
+        if (_onLcore)
+            lcore_backend_wait(_affinity);
         sem_destroy(&_sem);
-        if (_csvFile) fclose(_csvFile);
         printStatistics();
     }
 
+    // Write exec time and jitter histograms (us) to <name>_hist.csv in one go.
+    // Safe while running; counts of a live service are a close snapshot.
+    // The Sequencer dumps every service when it stops them.
+    void dumpHistograms() const {
+        if (_period == INFINITE_PERIOD)
+            return;     // one endless execution, nothing to histogram
+        FILE* f = fopen((_serviceName + "_hist.csv").c_str(), "w");
+        if (!f) {
+            syslog(LOG_ERR, "[SEQUENCER] Cannot write %s_hist.csv", _serviceName.c_str());
+            return;
+        }
+        lhist_write_csv(&_execHist, f, "exec", 1000.0, 1);
+        lhist_write_csv(&_jitterHist, f, "release_to_start", 1000.0, 0);
+        lhist_write_csv(&_periodJitterHist, f, "period_jitter", 1000.0, 0);
+        fclose(f);
+    }
+
     sem_t& getSemaphore() { return _sem; }
     uint32_t getPeriod() const { return _period; }
+    uint8_t getPriority() const { return _priority; }
+    uint64_t getMissedReleases() const { return _missedReleases.load(std::memory_order_relaxed); }
+    const struct latency_hist& getReleaseToStart() const { return _jitterHist; }
+    uint64_t getOverruns() const { return _overruns.load(std::memory_order_relaxed); }
+    uint8_t getAffinity() const { return _affinity; }
+    uint32_t getBudgetUs() const { return _budgetUs; }
+    const std::string& getName() const { return _serviceName; }
+
+    // Worst-case execution time for schedulability analysis: the measured
+    // maximum once the service has run, the declared budget before that
+    uint64_t getWcetNs() const {
+        uint64_t measured = _execHist.max;
+        return std::max(measured, (uint64_t)_budgetUs * 1000);
+    }
+
+    // Snapshot for the metrics endpoint; safe while the service runs
+    void getMetrics(struct service_metrics& m) const {
+        snprintf(m.name, sizeof(m.name), "%s", _serviceName.c_str());
+        m.core = _affinity;
+        m.priority = _priority;
+        m.period_us = _period;
+        m.budget_us = _budgetUs;
+        m.releases = _execHist.count;
+        m.missed = getMissedReleases();
+        m.overruns = getOverruns();
+        m.exec_p50_ns = lhist_percentile(&_execHist, 50);
+        m.exec_p99_ns = lhist_percentile(&_execHist, 99);
+        m.exec_max_ns = _execHist.max;
+        m.exec_sum_ns = _execHist.sum;
+        m.jitter_p50_ns = lhist_percentile(&_jitterHist, 50);
+        m.jitter_p99_ns = lhist_percentile(&_jitterHist, 99);
+        m.jitter_max_ns = _jitterHist.max;
+        m.jitter_sum_ns = _jitterHist.sum;
+        m.jitter_count = _jitterHist.count;
+    }
+
+    // Called from inside _doService through the C hooks in packet_logger.h
+    static bool budgetLeft() {
+        Service* self = _current;
+        if (!self || self->_budgetUs == 0)
+            return false;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return diffTimeUs(self->_releaseStart, now) < self->_budgetUs;
+    }
+
+    // Read by busy-polling services once they start; set before startServices()
+    void setIdlePolicy(const struct idle_policy& policy) { _idlePolicy = policy; }
+
+    static const struct idle_policy* idlePolicy() {
+        static const struct idle_policy busy{};
+        return _current ? &_current->_idlePolicy : &busy;
+    }
+
+    static void reportItems(uint64_t items, uint64_t backlog) {
+        Service* self = _current;
+        if (!self)
+            return;
+        self->_minItems = std::min(self->_minItems, items);
+        self->_maxItems = std::max(self->_maxItems, items);
+        self->_totalItems += items;
+        ++self->_itemsCount;
+        self->_maxBacklog = std::max(self->_maxBacklog, backlog);
+        self->_totalBacklog += backlog;
+        if (backlog > 0 && self->_budgetUs > 0 && !budgetLeft())
+            ++self->_budgetExhausted;   // stopped by the budget with work left
+    }
     
 private:
     std::function<void(void)> _doService;
@@ -108,57 +253,73 @@ private:
     uint8_t _affinity;
     uint8_t _priority;
     uint32_t _period;
-    FILE *_csvFile = nullptr;
-
-    std::queue<struct timespec> _releaseTimes;
-    std::mutex _releaseMutex;
-
-    double _minJitter = 0, _maxJitter = 0, _totalJitter = 0;
-    size_t _jitterCount = 0;
-    double _minExecTime = 0, _maxExecTime = 0, _totalExecTime = 0;
-    size_t _execCount = 0;
+    uint32_t _budgetUs;
+    bool _onLcore = false;          // launched with rte_eal_remote_launch
+    bool _registerLcore = false;    // jthread that takes an lcore id
+    struct idle_policy _idlePolicy{};    // IDLE_MODE_BUSY
+
+    static inline thread_local Service* _current = nullptr;
+    struct timespec _releaseStart{};
+
+    std::atomic<uint64_t> _releaseSlot{0};   // scheduled release in ns, 0 = consumed
+    uint64_t _lastReleaseNs = 0, _lastStartNs = 0;
+
+    // Fixed-size histograms in ns: execution time, release-to-start latency
+    // and period-to-period variation of start times
+    struct latency_hist _execHist;
+    struct latency_hist _jitterHist;
+    struct latency_hist _periodJitterHist;
+    uint64_t _minItems = std::numeric_limits<uint64_t>::max(), _maxItems = 0, _totalItems = 0;
+    size_t _itemsCount = 0;
+    uint64_t _maxBacklog = 0, _totalBacklog = 0;
+    size_t _budgetExhausted = 0;
+    // Written by the release thread, read by the metrics thread
+    std::atomic<uint64_t> _missedReleases{0};
+    std::atomic<uint64_t> _overruns{0};
+    std::atomic<bool> _executing{false};
 
     static inline double diffTimeUs(const struct timespec &start, const struct timespec &end) {
         return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
     }
 
+    static inline uint64_t toNs(const struct timespec &ts) {
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    void _recordJitter(uint64_t releaseNs, uint64_t startNs) {
+        lhist_record(&_jitterHist, startNs > releaseNs ? startNs - releaseNs : 0);
+
+        // Start-to-start spacing vs the scheduled spacing; skipped releases
+        // widen both, so misses do not show up as jitter
+        if (_lastReleaseNs) {
+            int64_t expected = (int64_t)(releaseNs - _lastReleaseNs);
+            int64_t actual = (int64_t)(startNs - _lastStartNs);
+            lhist_record(&_periodJitterHist, (uint64_t)std::llabs(actual - expected));
+        }
+        _lastReleaseNs = releaseNs;
+        _lastStartNs = startNs;
+    }
+
     void _taskLoop() {
         while (_running.load()) {
             sem_wait(&_sem);
             if (!_running.load()) break;
 
-            struct timespec releaseTime, startTime, endTime;
-            {
-                std::lock_guard<std::mutex> lock(_releaseMutex);
-                if (!_releaseTimes.empty()) {
-                    while (_releaseTimes.size() > 1) _releaseTimes.pop();
-                    releaseTime = _releaseTimes.front();
-                    _releaseTimes.pop();
-                } else {
-                    clock_gettime(CLOCK_MONOTONIC, &releaseTime);
-                }
-            }
-
+            struct timespec startTime, endTime;
+            uint64_t releaseNs = _releaseSlot.exchange(0, std::memory_order_acquire);
             clock_gettime(CLOCK_MONOTONIC, &startTime);
-            double jitter = diffTimeUs(releaseTime, startTime);
-            _minJitter = std::min(_minJitter, jitter);
-            _maxJitter = std::max(_maxJitter, jitter);
-            _totalJitter += jitter;
-            ++_jitterCount;
+            // An empty slot means a racing release was folded into the previous
+            // wakeup; run anyway but leave it out of the jitter statistics
+            if (releaseNs)
+                _recordJitter(releaseNs, toNs(startTime));
 
+            _releaseStart = startTime;
+            _executing.store(true, std::memory_order_relaxed);
             _doService();
+            _executing.store(false, std::memory_order_relaxed);
 
             clock_gettime(CLOCK_MONOTONIC, &endTime);
-            double execTime = diffTimeUs(startTime, endTime);
-            _minExecTime = std::min(_minExecTime, execTime);
-            _maxExecTime = std::max(_maxExecTime, execTime);
-            _totalExecTime += execTime;
-            ++_execCount;
-
-            if (_csvFile) {
-                fprintf(_csvFile, "%.2f\n", execTime);
-                fflush(_csvFile);
-            }
+            lhist_record(&_execHist, toNs(endTime) - toNs(startTime));
         }
     }
 
@@ -174,22 +335,46 @@ private:
     }
 
     void _provideService() {
+        _current = this;
         _initializeService();
+        // After pinning: the lcore takes the thread's current cpuset
+        if (_registerLcore)
+            lcore_backend_register();
         _taskLoop();
+        if (_registerLcore)
+            lcore_backend_unregister();
+    }
+
+    static int _lcoreEntry(void* self) {
+        static_cast<Service*>(self)->_provideService();
+        return 0;
     }
 
 
+    static void printHistogram(const char* label, const struct latency_hist& h) {
+        if (h.count == 0)
+            return;
+        syslog(LOG_INFO, "  %s (us): min = %.2f, p50 = %.2f, p99 = %.2f, p99.9 = %.2f, max = %.2f, avg = %.2f\n",
+               label, h.min / 1e3, lhist_percentile(&h, 50) / 1e3, lhist_percentile(&h, 99) / 1e3,
+               lhist_percentile(&h, 99.9) / 1e3, h.max / 1e3, (double)h.sum / h.count / 1e3);
+    }
+
     void printStatistics() const {
   if (_period == INFINITE_PERIOD){
         return;
         }  // Skip printing statistics for infinite services
-        syslog(LOG_INFO,"\n=== Service: %-10s (Period: %u us) Statistics ===\n", _serviceName.c_str(), _period*1000);
-        if (_jitterCount > 0)
-             syslog(LOG_INFO, " Start Jitter (us): min = %.2f, max = %.2f, avg = %.2f\n",
-                   _minJitter, _maxJitter, _totalJitter / _jitterCount);
-        if (_execCount > 0)
-             syslog(LOG_INFO, "  Execution Time (us): min = %.2f, max = %.2f, avg = %.2f\n",
-                   _minExecTime, _maxExecTime, _totalExecTime / _execCount);
+        syslog(LOG_INFO,"\n=== Service: %-10s (Period: %u us) Statistics ===\n", _serviceName.c_str(), _period);
+        printHistogram("Release-to-start", _jitterHist);
+        printHistogram("Period-to-period jitter", _periodJitterHist);
+        syslog(LOG_INFO, "  Missed releases: %" PRIu64 " of %" PRIu64 ", deadline overruns: %" PRIu64 "\n",
+               getMissedReleases(), getMissedReleases() + _execHist.count, getOverruns());
+        printHistogram("Execution Time", _execHist);
+        if (_itemsCount > 0) {
+             syslog(LOG_INFO, "  Items/release: min = %" PRIu64 ", max = %" PRIu64 ", avg = %.2f (budget %u us)\n",
+                   _minItems, _maxItems, (double)_totalItems / _itemsCount, _budgetUs);
+             syslog(LOG_INFO, "  Backlog after release: max = %" PRIu64 ", avg = %.2f, budget exhausted %zu/%zu\n",
+                   _maxBacklog, (double)_totalBacklog / _itemsCount, _budgetExhausted, _itemsCount);
+        }
     }
 
 
@@ -197,9 +382,18 @@ private:
 // The sequencer class contains the services set and manages
 // starting/stopping the services. While the services are running,
 // the sequencer releases each service at the requisite timepoint.
+//
+// Releases come from a precomputed table covering one hyperperiod (LCM of
+// all periods, in us). The release thread sleeps with clock_nanosleep on
+// absolute CLOCK_MONOTONIC deadlines derived from the start time, so wakeup
+// latency never accumulates into drift.
 class Sequencer
 {
 public:
+    static constexpr size_t RELEASE_TABLE_MAX = 65536;
+
+    explicit Sequencer(ServiceBackend backend = ServiceBackend::Thread) : _backend(backend) {}
+
     template<typename... Args>
     void addService(Args&&... args)
     {
@@ -207,39 +401,61 @@ public:
         // constructing it in-place with the given args
         //_services.emplace_back(std::forward<Args>(args)...);
             _services.emplace_back(std::make_unique<Service>(std::forward<Args>(args)...));
+        // A service that could not start fails startServices()
+        if (!_services.back()->start(_backend))
+            _startFailed = true;
     }
-void startServices()
+
+// Returns false if the periods do not fit a release table
+bool startServices()
 {
-    _runningTimer.store(true);
+    if (_startFailed || !_buildReleaseTable())
+        return false;
+    // Budgets are the only WCETs known before anything ran
+    analyzeSchedulability(true);
 
+    _runningTimer.store(true);
     _tickThread = std::jthread([](Sequencer* self) {
-        int tick_ms = 0;
-        static std::unordered_map<Service*, bool> started_map;  // Moved outside loop
-
-        while (self->_runningTimer.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            ++tick_ms;
-
-            for (auto& service : self->_services) {
-                Service* service_ptr = service.get(); // Get raw pointer once
-
-                if (service_ptr->getPeriod() == INFINITE_PERIOD) {
-                    if (!started_map[service_ptr]) {
-                        sem_post(&service_ptr->getSemaphore());
-                        started_map[service_ptr] = true;
-                    }
-                }
-                else if (tick_ms % service_ptr->getPeriod() == 0) {
-                    sem_post(&service_ptr->getSemaphore());
-                }
-            }
+        sched_param sch_params{};
+        sch_params.sched_priority = sched_get_priority_max(SCHED_FIFO);
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch_params);
 
-            if (tick_ms >= 1000) tick_ms = 0;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (auto& service : self->_services)
+            if (service->getPeriod() == INFINITE_PERIOD)
+                service->release(now);
+
+        // First periodic release 1 ms from now
+        uint64_t start = toNs(now) + 1000000;
+        uint64_t cycle = 0;
+        size_t idx = 0;
+
+        while (self->_runningTimer.load() && !self->_releaseTable.empty()) {
+            const ReleasePoint& point = self->_releaseTable[idx];
+            uint64_t due = start + cycle * self->_hyperperiodNs + point.offsetNs;
+            struct timespec dueTs = fromNs(due);
+
+            // A late wakeup returns immediately for past deadlines; services that
+            // have not started their previous release count the extra ones as missed
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &dueTs, nullptr) == EINTR) {}
+            if (!self->_runningTimer.load())
+                break;
+            for (Service* service : point.services)
+                service->release(dueTs);
+
+            if (++idx == self->_releaseTable.size()) {
+                idx = 0;
+                ++cycle;
+            }
         }
     }, this);
+    return true;
 }
 
 
+// Returns once every service has exited; persistent services leave their
+// loop on force_quit, which the caller sets first
 void stopServices()
 {
     _runningTimer.store(false); // Tell tick thread to stop
@@ -248,43 +464,209 @@ void stopServices()
 
     for (auto& service : _services)
         service->stop();
+    for (auto& service : _services)
+        service->join();
+    dumpHistograms();
 }
 
+Service* findService(const std::string& name)
+{
+    for (auto& service : _services)
+        if (service->getName() == name)
+            return service.get();
+    return nullptr;
+}
+
+// Returns false if no service has that name
+bool setIdlePolicy(const std::string& name, const struct idle_policy& policy)
+{
+    Service* service = findService(name);
+    if (service)
+        service->setIdlePolicy(policy);
+    return service != nullptr;
+}
+
+uint64_t getHyperperiodUs() const { return _hyperperiodNs / 1000; }
+
+// Periodic services only; the pollers have one endless execution
+unsigned getMetrics(struct service_metrics* out, unsigned max) const
+{
+    unsigned n = 0;
+    for (auto& service : _services)
+        if (n < max && service->getPeriod() != INFINITE_PERIOD)
+            service->getMetrics(out[n++]);
+    return n;
+}
+void dumpHistograms() const
+{
+    for (auto& service : _services)
+        service->dumpHistograms();
+}
+
+// Fixed-priority analysis per core: utilization against the rate-monotonic
+// bound, then exact response times R = C + sum(ceil(R / Tj) * Cj) over the
+// services of equal or higher priority on the same core, with the period
+// as deadline. C is the WCET from getWcetNs(). A busy-polling service
+// (INFINITE_PERIOD) leaves nothing for periodic services on its core at
+// the same or lower priority. Returns false if any service can miss.
+// verbose logs the whole table; otherwise only changes in the verdict.
+bool analyzeSchedulability(bool verbose)
+{
+    std::map<uint8_t, std::vector<Service*>> cores;
+    for (auto& service : _services)
+        cores[service->getAffinity()].push_back(service.get());
+
+    size_t failing = 0;
+    for (auto& [core, services] : cores) {
+        std::stable_sort(services.begin(), services.end(),
+                         [](Service* a, Service* b) { return a->getPriority() > b->getPriority(); });
+
+        const Service* poller = nullptr;
+        double util = 0;
+        size_t periodic = 0;
+        for (Service* s : services) {
+            if (s->getPeriod() == INFINITE_PERIOD) {
+                poller = poller ? poller : s;
+                continue;
+            }
+            util += (double)s->getWcetNs() / (s->getPeriod() * 1000.0);
+            ++periodic;
+        }
+        if (periodic == 0)
+            continue;
+        double rmBound = periodic * (std::pow(2.0, 1.0 / periodic) - 1);
+        if (verbose)
+            syslog(LOG_INFO, "[SEQUENCER] Core %u: U = %.3f, RM bound %.3f%s%s\n", core, util, rmBound,
+                   poller ? ", busy-polled by " : "", poller ? poller->getName().c_str() : "");
+
+        for (Service* s : services) {
+            if (s->getPeriod() == INFINITE_PERIOD)
+                continue;
+            uint64_t deadline = (uint64_t)s->getPeriod() * 1000;
+            uint64_t wcet = s->getWcetNs();
+            bool starved = poller && poller->getPriority() >= s->getPriority();
+            uint64_t response = starved ? UINT64_MAX : _responseTime(s, services, deadline);
+            bool ok = response <= deadline;
+            failing += !ok;
+
+            if (verbose || !ok)
+                syslog(ok ? LOG_INFO : LOG_WARNING,
+                       "[SEQUENCER]   %-10s prio %3u  C = %8.1f us%s  T = D = %7u us  R = %s  %s\n",
+                       s->getName().c_str(), s->getPriority(), wcet / 1e3, wcet ? "" : " (unmeasured)",
+                       s->getPeriod(), response == UINT64_MAX ? "unbounded" : std::to_string(response / 1000).append(" us").c_str(),
+                       ok ? "ok" : "DEADLINE MISS POSSIBLE");
+        }
+    }
+
+    if (!verbose && failing != _lastFailing)
+        syslog(failing ? LOG_WARNING : LOG_INFO, "[SEQUENCER] %zu service(s) fail response-time analysis\n", failing);
+    _lastFailing = failing;
+    return failing == 0;
+}
+
+uint64_t getOverruns() const
+{
+    uint64_t overruns = 0;
+    for (auto& service : _services)
+        overruns += service->getOverruns();
+    return overruns;
+}
+
+uint64_t getMissedReleases() const
+{
+    uint64_t missed = 0;
+    for (auto& service : _services)
+        missed += service->getMissedReleases();
+    return missed;
+}
+size_t getReleaseTableSize() const { return _releaseTable.size(); }
 
 
 private:
+    struct ReleasePoint {
+        uint64_t offsetNs;                 // from the start of the hyperperiod
+        std::vector<Service*> services;    // released together, in priority order
+    };
+
     std::jthread _tickThread;
     std::atomic<bool> _runningTimer {false};
+    ServiceBackend _backend;
+    bool _startFailed = false;
     //std::vector<Service> _services;
     std::vector<std::unique_ptr<Service>> _services;
+    std::vector<ReleasePoint> _releaseTable;
+    uint64_t _hyperperiodNs = 0;
+    size_t _lastFailing = 0;
 
-     static inline Sequencer* _instance = nullptr;
-    timer_t _timerId;
-
-    static void _timerHandler(int sig, siginfo_t* si, void* uc)
+    // Classic response-time iteration; SCHED_FIFO peers of equal priority
+    // can run first, so they count as interference too
+    static uint64_t _responseTime(const Service* s, const std::vector<Service*>& core, uint64_t deadline)
     {
-    (void)sig; (void)si; (void)uc;
-        static int tick = 0;
-        tick += 1;
+        uint64_t response = s->getWcetNs();
+        for (;;) {
+            uint64_t next = s->getWcetNs();
+            for (const Service* j : core) {
+                if (j == s || j->getPeriod() == INFINITE_PERIOD || j->getPriority() < s->getPriority())
+                    continue;
+                uint64_t period = (uint64_t)j->getPeriod() * 1000;
+                next += (response + period - 1) / period * j->getWcetNs();
+            }
+            if (next == response || next > deadline)
+                return next;
+            response = next;
+        }
+    }
+
+    static uint64_t toNs(const struct timespec& ts) {
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
 
-        if (!_instance) return;
+    static struct timespec fromNs(uint64_t ns) {
+        return { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    }
 
-        for (auto& service : _instance->_services)
-        {
-            if (service->getPeriod() == INFINITE_PERIOD)
-                {
-                    static bool started = false;
-                    if (!started)
-                    {
-                        sem_post(&service->getSemaphore());
-                        started = true;
-                    }
-                }
-                else if (tick % service->getPeriod() == 0)
-                    {
-                        sem_post(&service->getSemaphore());
-                    }
+    bool _buildReleaseTable()
+    {
+        uint64_t hyperUs = 1;
+        size_t releases = 0;
+        for (auto& service : _services) {
+            uint32_t period = service->getPeriod();
+            if (period == INFINITE_PERIOD)
+                continue;
+            if (period == 0) {
+                syslog(LOG_ERR, "[SEQUENCER] Service period must be at least 1 us");
+                return false;
+            }
+            hyperUs = std::lcm(hyperUs, (uint64_t)period);
+            if (hyperUs > std::numeric_limits<uint32_t>::max())
+                break;
+        }
+        for (auto& service : _services)
+            if (service->getPeriod() != INFINITE_PERIOD)
+                releases += hyperUs / service->getPeriod();
+        if (releases > RELEASE_TABLE_MAX) {
+            syslog(LOG_ERR, "[SEQUENCER] Hyperperiod of %" PRIu64 " us needs %zu releases (max %zu); "
+                   "choose harmonic periods", hyperUs, releases, RELEASE_TABLE_MAX);
+            return false;
+        }
+
+        std::map<uint64_t, std::vector<Service*>> points;
+        for (auto& service : _services) {
+            uint32_t period = service->getPeriod();
+            if (period == INFINITE_PERIOD)
+                continue;
+            for (uint64_t t = 0; t < hyperUs; t += period)
+                points[t * 1000].push_back(service.get());
+        }
+        _releaseTable.clear();
+        for (auto& [offset, services] : points) {
+            std::stable_sort(services.begin(), services.end(),
+                             [](Service* a, Service* b) { return a->getPriority() > b->getPriority(); });
+            _releaseTable.push_back({offset, std::move(services)});
         }
-        if (tick >= 100) tick = 0;
+        _hyperperiodNs = hyperUs * 1000;
+        syslog(LOG_INFO, "[SEQUENCER] Hyperperiod %" PRIu64 " us, %zu release points",
+               hyperUs, _releaseTable.size());
+        return true;
     }
 };
@@ -0,0 +1,463 @@
+// alert.c
+#define _GNU_SOURCE
+#include "alert.h"
+#include "pkt_latency.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <rte_cycles.h>
+#include <rte_ring.h>
+#include <rte_ring_elem.h>
+
+_Static_assert((ALERT_FLOWS & (ALERT_FLOWS - 1)) == 0, "coalescing table size must be a power of two");
+
+#define DRAIN_BURST 64
+#define MAX_SINK_TYPES 8
+
+struct flow_slot {
+    bool used;
+    struct alert_event first;
+    uint64_t opened_ms;
+    uint64_t count;
+};
+
+struct sink {
+    const struct alert_sink_ops *ops;
+    void *ctx;
+};
+
+static struct rte_ring *alert_ring;
+static int event_fd = -1;
+static int consumer_waiting;        // set by the thread before it sleeps on event_fd
+static pthread_t alert_thread;
+static volatile bool alert_running;
+static uint32_t window_ms = ALERT_WINDOW_MS;
+static struct flow_slot flows[ALERT_FLOWS];
+static struct sink sinks[ALERT_MAX_SINKS];
+static unsigned nb_sinks;
+static const struct alert_sink_ops *sink_types[MAX_SINK_TYPES];
+static unsigned nb_sink_types;
+static struct alert_stats stats;
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void format_flow(const struct alert_flow *f, char *buf, size_t len) {
+    char src[INET_ADDRSTRLEN], dst[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &f->src_ip, src, sizeof(src));
+    inet_ntop(AF_INET, &f->dst_ip, dst, sizeof(dst));
+    snprintf(buf, len, "%s:%u -> %s:%u proto %u", src, f->src_port, dst, f->dst_port, f->proto);
+}
+
+// syslog sink
+
+static void *syslog_open(const char *arg) {
+    (void)arg;
+    return (void *)1;
+}
+
+static int syslog_emit(void *ctx, const struct alert *a) {
+    char flow[96];
+    const uint8_t *m = a->first.src_mac;
+    (void)ctx;
+    format_flow(&a->first.flow, flow, sizeof(flow));
+    if (a->follow_up)
+        syslog(LOG_WARNING, "[ALERT] %s: %" PRIu64 " THREAT packets in %u ms\n", flow, a->count, window_ms);
+    else
+        syslog(LOG_WARNING, "[ALERT] THREAT %s from %02X:%02X:%02X:%02X:%02X:%02X, rule %u, flow alerts 0x%x, "
+               "queue %u, detect->alert %.1f us\n", flow, m[0], m[1], m[2], m[3], m[4], m[5],
+               a->first.rule_id, a->first.flow_alerts, a->first.queue, a->latency_ns / 1e3);
+    return 0;
+}
+
+static void syslog_close(void *ctx) {
+    (void)ctx;
+}
+
+// led sink: a GPIO value file, as under /sys/class/gpio/gpioN/value
+
+struct led {
+    int fd;
+    bool on;
+    uint64_t last_alert_ms;
+};
+
+static int led_set(struct led *led, bool on) {
+    led->on = on;
+    return pwrite(led->fd, on ? "1\n" : "0\n", 2, 0) == 2 ? 0 : -1;
+}
+
+static void *led_open(const char *arg) {
+    const char *path = arg ? arg : ALERT_LED_FILE;
+    struct led *led = calloc(1, sizeof(*led));
+    if (!led)
+        return NULL;
+    led->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (led->fd < 0) {
+        syslog(LOG_ERR, "[ALERT] Cannot open LED %s: %s", path, strerror(errno));
+        free(led);
+        return NULL;
+    }
+    led_set(led, false);
+    return led;
+}
+
+static int led_emit(void *ctx, const struct alert *a) {
+    struct led *led = ctx;
+    (void)a;
+    led->last_alert_ms = monotonic_ms();
+    return led->on ? 0 : led_set(led, true);
+}
+
+static void led_tick(void *ctx, uint64_t now_ms) {
+    struct led *led = ctx;
+    if (led->on && now_ms - led->last_alert_ms >= ALERT_LED_HOLD_MS)
+        led_set(led, false);
+}
+
+static void led_close(void *ctx) {
+    struct led *led = ctx;
+    led_set(led, false);
+    close(led->fd);
+    free(led);
+}
+
+// http sink: one short-lived POST per alert
+
+struct http {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    char host[64];
+    char path[128];
+};
+
+static void *http_open(const char *arg) {
+    char host[64], port[8];
+    const char *path;
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM }, *res;
+
+    if (!arg || sscanf(arg, "%63[^:]:%7[0-9]", host, port) != 2) {
+        syslog(LOG_ERR, "[ALERT] http sink expects http:HOST:PORT/PATH");
+        return NULL;
+    }
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        syslog(LOG_ERR, "[ALERT] Cannot resolve %s", host);
+        return NULL;
+    }
+    struct http *h = calloc(1, sizeof(*h));
+    if (!h) {
+        freeaddrinfo(res);
+        return NULL;
+    }
+    memcpy(&h->addr, res->ai_addr, res->ai_addrlen);
+    h->addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+    snprintf(h->host, sizeof(h->host), "%s:%s", host, port);
+    path = strchr(arg, '/');
+    snprintf(h->path, sizeof(h->path), "%s", path ? path : "/alert");
+    return h;
+}
+
+// Wait for fd to become ready within what is left of the deadline
+static int wait_fd(int fd, short events, uint64_t deadline_ms) {
+    uint64_t now = monotonic_ms();
+    struct pollfd p = { .fd = fd, .events = events };
+    if (now >= deadline_ms)
+        return -1;
+    return poll(&p, 1, (int)(deadline_ms - now)) == 1 ? 0 : -1;
+}
+
+static int http_emit(void *ctx, const struct alert *a) {
+    struct http *h = ctx;
+    char flow[96], body[512], req[1024];
+    uint64_t deadline = monotonic_ms() + ALERT_HTTP_TIMEOUT_MS;
+    const uint8_t *m = a->first.src_mac;
+
+    format_flow(&a->first.flow, flow, sizeof(flow));
+    int body_len = snprintf(body, sizeof(body),
+        "{\"type\":\"%s\",\"flow\":\"%s\",\"src_mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"rule_id\":%u,"
+        "\"flow_alerts\":%u,\"queue\":%u,\"count\":%" PRIu64 ",\"wall_ns\":%" PRIu64 ",\"latency_ns\":%" PRIu64 "}",
+        a->follow_up ? "follow_up" : "threat", flow, m[0], m[1], m[2], m[3], m[4], m[5], a->first.rule_id,
+        a->first.flow_alerts, a->first.queue, a->count, a->first.wall_ns, a->latency_ns);
+    int req_len = snprintf(req, sizeof(req),
+        "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n"
+        "Connection: close\r\n\r\n%s", h->path, h->host, body_len, body);
+
+    int fd = socket(h->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    int ret = -1;
+    if (connect(fd, (struct sockaddr *)&h->addr, h->addr_len) < 0 &&
+        (errno != EINPROGRESS || wait_fd(fd, POLLOUT, deadline) < 0))
+        goto out;
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err)
+        goto out;
+    for (int off = 0; off < req_len;) {
+        ssize_t n = send(fd, req + off, req_len - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EAGAIN && wait_fd(fd, POLLOUT, deadline) == 0)
+            continue;
+        if (n <= 0)
+            goto out;
+        off += n;
+    }
+    // The status line is enough; the stand-in answers and closes
+    char status[16];
+    if (wait_fd(fd, POLLIN, deadline) == 0 && recv(fd, status, sizeof(status), 0) >= 12 &&
+        strncmp(status + 9, "2", 1) == 0)
+        ret = 0;
+out:
+    close(fd);
+    return ret;
+}
+
+static void http_close(void *ctx) {
+    free(ctx);
+}
+
+static const struct alert_sink_ops builtin_sinks[] = {
+    { "syslog", syslog_open, syslog_emit, NULL, syslog_close },
+    { "led", led_open, led_emit, led_tick, led_close },
+    { "http", http_open, http_emit, NULL, http_close },
+};
+
+int alert_register_sink(const struct alert_sink_ops *ops) {
+    if (nb_sink_types == MAX_SINK_TYPES)
+        return -1;
+    sink_types[nb_sink_types++] = ops;
+    return 0;
+}
+
+int alert_add_sinks(const char *spec) {
+    char buf[256];
+    char *save = NULL;
+
+    if (nb_sink_types == 0)
+        for (unsigned i = 0; i < sizeof(builtin_sinks) / sizeof(builtin_sinks[0]); i++)
+            alert_register_sink(&builtin_sinks[i]);
+
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *arg = strchr(tok, ':');
+        if (arg)
+            *arg++ = '\0';
+        const struct alert_sink_ops *ops = NULL;
+        for (unsigned i = 0; i < nb_sink_types && !ops; i++)
+            if (strcmp(sink_types[i]->name, tok) == 0)
+                ops = sink_types[i];
+        if (!ops) {
+            syslog(LOG_ERR, "[ALERT] Unknown sink '%s'", tok);
+            return -1;
+        }
+        if (nb_sinks == ALERT_MAX_SINKS) {
+            syslog(LOG_ERR, "[ALERT] At most %d sinks", ALERT_MAX_SINKS);
+            return -1;
+        }
+        void *ctx = ops->open(arg);
+        if (!ctx)
+            return -1;
+        sinks[nb_sinks++] = (struct sink){ ops, ctx };
+    }
+    return 0;
+}
+
+void alert_set_window(uint32_t ms) {
+    window_ms = ms;
+}
+
+static void dispatch(const struct alert *a) {
+    for (unsigned i = 0; i < nb_sinks; i++)
+        if (sinks[i].ops->emit(sinks[i].ctx, a) < 0)
+            stats.sink_errors++;
+}
+
+static void close_window(struct flow_slot *slot) {
+    if (slot->count > 1) {
+        struct alert a = { .first = slot->first, .count = slot->count, .follow_up = true };
+        dispatch(&a);
+        stats.follow_ups++;
+    }
+    slot->used = false;
+}
+
+// Full 64-bit mix (murmur3 finalizer): addresses are in network byte order,
+// so the bytes that differ between hosts sit in the top bits of the words
+static uint32_t flow_hash(const struct alert_flow *f) {
+    uint64_t h = ((uint64_t)f->src_ip << 32 | f->dst_ip) ^
+                 ((uint64_t)f->src_port << 24 | (uint64_t)f->dst_port << 8 | f->proto) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+static bool same_flow(const struct alert_flow *a, const struct alert_flow *b) {
+    return a->src_ip == b->src_ip && a->dst_ip == b->dst_ip && a->src_port == b->src_port &&
+           a->dst_port == b->dst_port && a->proto == b->proto;
+}
+
+static void handle_event(const struct alert_event *ev, uint64_t now_ms) {
+    struct flow_slot *slot = &flows[flow_hash(&ev->flow) & (ALERT_FLOWS - 1)];
+
+    if (slot->used && same_flow(&slot->first.flow, &ev->flow) && now_ms - slot->opened_ms < window_ms) {
+        slot->count++;
+        stats.coalesced++;
+        return;
+    }
+    if (slot->used)
+        close_window(slot);     // expired, or another flow hashed here
+
+    uint64_t now_tsc = rte_get_tsc_cycles();
+    struct alert a = { .first = *ev, .count = 1, .latency_ns = pkt_latency_ns(ev->detect_tsc, now_tsc) };
+    lhist_record(&pkt_lat_detect_to_alert.hist, a.latency_ns);
+    dispatch(&a);
+    stats.alerts++;
+    *slot = (struct flow_slot){ .used = true, .first = *ev, .opened_ms = now_ms, .count = 1 };
+}
+
+// Close expired windows; returns ms until the next one expires (-1: none open)
+static int expire_windows(uint64_t now_ms, bool all) {
+    int next = -1;
+    for (unsigned i = 0; i < ALERT_FLOWS; i++) {
+        struct flow_slot *slot = &flows[i];
+        if (!slot->used)
+            continue;
+        uint64_t age = now_ms - slot->opened_ms;
+        if (all || age >= window_ms) {
+            close_window(slot);
+            continue;
+        }
+        int left = (int)(window_ms - age);
+        if (next < 0 || left < next)
+            next = left;
+    }
+    return next;
+}
+
+static void *alert_main(void *arg) {
+    struct alert_event events[DRAIN_BURST];
+    int timeout = -1;
+    (void)arg;
+    syslog(LOG_INFO, "[ALERT] Thread running on core %d", sched_getcpu());
+
+    for (;;) {
+        bool running = alert_running;
+        unsigned n = rte_ring_dequeue_burst_elem(alert_ring, events, sizeof(events[0]), DRAIN_BURST, NULL);
+        uint64_t now = monotonic_ms();
+        for (unsigned i = 0; i < n; i++)
+            handle_event(&events[i], now);
+        if (n) {
+            timeout = expire_windows(now, false);
+            continue;
+        }
+        if (!running)
+            break;
+
+        // Tell producers to wake us, then look once more so an event queued
+        // just before the flag was set is not left waiting
+        __atomic_store_n(&consumer_waiting, 1, __ATOMIC_SEQ_CST);
+        if (rte_ring_count(alert_ring) == 0) {
+            struct pollfd p = { .fd = event_fd, .events = POLLIN };
+            int tick = timeout < 0 || timeout > ALERT_LED_HOLD_MS ? ALERT_LED_HOLD_MS : timeout;
+            if (poll(&p, 1, tick) == 1) {
+                uint64_t cnt;
+                if (read(event_fd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN)
+                    syslog(LOG_ERR, "[ALERT] eventfd read failed: %s", strerror(errno));
+            }
+        }
+        __atomic_store_n(&consumer_waiting, 0, __ATOMIC_RELAXED);
+
+        now = monotonic_ms();
+        timeout = expire_windows(now, false);
+        for (unsigned i = 0; i < nb_sinks; i++)
+            if (sinks[i].ops->tick)
+                sinks[i].ops->tick(sinks[i].ctx, now);
+    }
+    expire_windows(monotonic_ms(), true);
+    return NULL;
+}
+
+void alert_raise(const struct alert_event *events, unsigned n) {
+    unsigned sent = rte_ring_enqueue_burst_elem(alert_ring, events, sizeof(events[0]), n, NULL);
+    __atomic_fetch_add(&stats.raised, sent, __ATOMIC_RELAXED);
+    if (sent < n)
+        __atomic_fetch_add(&stats.dropped, n - sent, __ATOMIC_RELAXED);
+    // One write() per burst at most, and only when the thread sleeps
+    if (sent && __atomic_exchange_n(&consumer_waiting, 0, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+        if (write(event_fd, &one, sizeof(one)) == sizeof(one))
+            __atomic_fetch_add(&stats.wakeups, 1, __ATOMIC_RELAXED);
+    }
+}
+
+int alert_start(int core, bool multi_producer) {
+    alert_ring = rte_ring_create_elem("ALERT_RING", sizeof(struct alert_event), ALERT_RING_SIZE,
+                                      SOCKET_ID_ANY, RING_F_SC_DEQ | (multi_producer ? 0 : RING_F_SP_ENQ));
+    if (!alert_ring) {
+        syslog(LOG_ERR, "[ALERT] Failed to create alert ring");
+        return -1;
+    }
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0) {
+        syslog(LOG_ERR, "[ALERT] eventfd failed: %s", strerror(errno));
+        return -1;
+    }
+
+    // Plain SCHED_OTHER thread: it must never compete with the pipeline cores
+    alert_running = true;
+    if (pthread_create(&alert_thread, NULL, alert_main, NULL) != 0) {
+        syslog(LOG_ERR, "[ALERT] Failed to create alert thread");
+        alert_running = false;
+        return -1;
+    }
+    pthread_setname_np(alert_thread, "alert");
+    if (core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(alert_thread, sizeof(set), &set);
+    }
+    return 0;
+}
+
+void alert_stop(void) {
+    if (alert_running) {
+        uint64_t one = 1;
+        alert_running = false;
+        if (write(event_fd, &one, sizeof(one)) < 0)
+            syslog(LOG_ERR, "[ALERT] eventfd write failed: %s", strerror(errno));
+        pthread_join(alert_thread, NULL);
+    }
+    for (unsigned i = 0; i < nb_sinks; i++)
+        sinks[i].ops->close(sinks[i].ctx);
+    nb_sinks = 0;
+    if (event_fd >= 0) {
+        close(event_fd);
+        event_fd = -1;
+    }
+}
+
+void alert_get_stats(struct alert_stats *out) {
+    *out = stats;
+}
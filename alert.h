@@ -0,0 +1,100 @@
+#ifndef ALERT_H_
+#define ALERT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Threat alert channel. DETECT queues one event per THREAT verdict into a
+// ring and, only when the alert thread is asleep, writes its eventfd, so the
+// thread wakes as soon as the burst is classified instead of at the next
+// period of a polling service. The thread coalesces events per flow: the
+// first event of a flow raises an alert at once, further events within
+// the window only count, and a follow-up alert with that count goes out
+// when the window closes. Alerts go to every configured sink:
+//   syslog              one LOG_WARNING line per alert
+//   led[:PATH]          simulated GPIO: writes 1 to a sysfs-style value
+//                       file on an alert, 0 once ALERT_LED_HOLD_MS passed
+//                       without one (default ALERT_LED_FILE)
+//   http:HOST:PORT/PATH POST of the alert as JSON, ALERT_HTTP_TIMEOUT_MS
+//                       at most (alert_receiver.py is a local stand-in)
+// Further sinks register through alert_register_sink().
+
+#define ALERT_RING_SIZE       4096     // events, power of two
+#define ALERT_FLOWS           1024     // coalescing slots, power of two
+#define ALERT_WINDOW_MS       1000
+#define ALERT_MAX_SINKS       4
+#define ALERT_LED_FILE        "/tmp/packet_logger_led"
+#define ALERT_LED_HOLD_MS     2000
+#define ALERT_HTTP_TIMEOUT_MS 200
+
+struct alert_flow {
+    uint32_t src_ip, dst_ip;     // network byte order
+    uint16_t src_port, dst_port; // host byte order
+    uint8_t proto;
+};
+
+// DETECT -> alert thread
+struct alert_event {
+    struct alert_flow flow;
+    uint8_t src_mac[6];
+    uint8_t flow_alerts;         // FLOW_ALERT_* bits
+    uint16_t queue;
+    uint32_t rule_id;
+    uint64_t detect_tsc;
+    uint64_t wall_ns;
+};
+
+// Alert thread -> sinks
+struct alert {
+    struct alert_event first;    // event that opened the window
+    uint64_t count;              // events in the window
+    bool follow_up;              // window closed with count > 1
+    uint64_t latency_ns;         // detect -> alert of the first event
+};
+
+struct alert_sink_ops {
+    const char *name;
+    void *(*open)(const char *arg);                  // arg may be NULL; NULL = failed
+    int (*emit)(void *ctx, const struct alert *a);   // < 0 counts as a sink error
+    void (*tick)(void *ctx, uint64_t now_ms);        // on every wakeup; may be NULL
+    void (*close)(void *ctx);
+};
+
+struct alert_stats {
+    uint64_t raised;             // events queued by DETECT
+    uint64_t dropped;            // ring full
+    uint64_t wakeups;            // eventfd writes
+    uint64_t alerts;             // first alerts sent to the sinks
+    uint64_t follow_ups;
+    uint64_t coalesced;          // events folded into an open window
+    uint64_t sink_errors;
+};
+
+// Add sink types beyond the built-in ones; before alert_add_sinks()
+int alert_register_sink(const struct alert_sink_ops *ops);
+// Comma-separated sinks, e.g. "syslog,led,http:127.0.0.1:9000/alert"
+int alert_add_sinks(const char *spec);
+void alert_set_window(uint32_t window_ms);
+
+// Create the ring (multi-producer when several DETECT queues raise) and the
+// thread, pinned to core (-1 = any)
+int alert_start(int core, bool multi_producer);
+// Drain the ring, flush open windows, close the sinks and join. Only once
+// every DETECT thread has been joined: alert_raise() writes the eventfd
+// this closes.
+void alert_stop(void);
+
+// From DETECT; never blocks, a full ring drops the events
+void alert_raise(const struct alert_event *events, unsigned n);
+
+void alert_get_stats(struct alert_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ALERT_H_
@@ -0,0 +1,39 @@
+import json
+import sys
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+# Local stand-in for the endpoint of the alert http sink (alert.h): accepts
+# the JSON POSTs and prints one line per alert.
+#
+# Usage: python3 alert_receiver.py [port]     (default 9000)
+#   then: packet_logger ... -- --alerts syslog,http:127.0.0.1:9000/alert
+
+
+class AlertHandler(BaseHTTPRequestHandler):
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        try:
+            alert = json.loads(body)
+        except ValueError:
+            self.send_response(400)
+            self.end_headers()
+            return
+        if alert.get("type") == "follow_up":
+            print(f"follow-up {alert['flow']}: {alert['count']} packets in the window", flush=True)
+        else:
+            print(f"THREAT {alert['flow']} from {alert['src_mac']} rule {alert['rule_id']} "
+                  f"queue {alert['queue']}, detect->alert {alert['latency_ns'] / 1000:.1f} us", flush=True)
+        self.send_response(204)
+        self.end_headers()
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 9000
+    HTTPServer(("127.0.0.1", port), AlertHandler).serve_forever()
+
+
+if __name__ == "__main__":
+    main()
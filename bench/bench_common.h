@@ -0,0 +1,34 @@
+// bench_common.h - shared helpers for the offline microbenchmarks
+#ifndef BENCH_COMMON_H_
+#define BENCH_COMMON_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Every benchmark prints CSV rows on stdout so results from different
+// commits can be concatenated and diffed:
+//   benchmark,case,metric,value,unit
+static inline void bench_header(void) {
+    printf("benchmark,case,metric,value,unit\n");
+}
+
+static inline void bench_report(const char *bench, const char *cas,
+                                const char *metric, double value, const char *unit) {
+    printf("%s,%s,%s,%.3f,%s\n", bench, cas, metric, value, unit);
+    fflush(stdout);
+}
+
+// Results are folded in here so the compiler cannot drop the measured work
+static volatile uint64_t bench_sink;
+
+// Small deterministic PRNG so runs are comparable across commits
+static inline uint64_t bench_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+#endif  // BENCH_COMMON_H_
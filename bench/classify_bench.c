@@ -0,0 +1,165 @@
+// classify_bench.c - SIMD burst classifier vs the scalar path on synthetic
+// mbuf bursts of 32 packets.
+//
+// Run from the repo root: sudo ./bench/classify_bench --no-huge -m 512
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_eal.h>
+#include <rte_cycles.h>
+#include <rte_mbuf.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+
+#include "bench_common.h"
+#include "../rules.h"
+#include "../burst_classify.h"
+
+#define NUM_BURSTS 1024
+#define BURST 32
+#define ROUNDS 200
+
+static struct rte_mbuf *bursts[NUM_BURSTS][BURST];
+
+static void fill_packet(struct rte_mbuf *m, uint64_t *seed) {
+    uint64_t r = bench_rand(seed);
+    char *p = rte_pktmbuf_append(m, 64);
+    memset(p, 0, 64);
+
+    struct rte_ether_hdr *eth = (struct rte_ether_hdr *)p;
+    struct rte_ipv4_hdr *ip = (struct rte_ipv4_hdr *)(eth + 1);
+    struct rte_udp_hdr *l4 = (struct rte_udp_hdr *)(ip + 1);
+
+    // ~1 in 16 frames is not IPv4
+    eth->ether_type = rte_cpu_to_be_16(r % 16 ? RTE_ETHER_TYPE_IPV4 : 0x86DD);
+    ip->version_ihl = 0x45;
+    ip->next_proto_id = (uint8_t[]){ IPPROTO_TCP, IPPROTO_UDP, IPPROTO_ICMP, IPPROTO_TCP }[(r >> 8) % 4];
+    ip->src_addr = (uint32_t)bench_rand(seed);
+    ip->dst_addr = rte_cpu_to_be_32(0xC0A80102);
+    l4->src_port = rte_cpu_to_be_16((uint16_t)(r >> 16));
+    // Mostly high ports, sometimes the ports the default rules watch
+    uint16_t dport = (r >> 32) % 8 ? 1024 + (uint16_t)((r >> 40) % 60000)
+                                   : (uint16_t[]){ 22, 23, 445, 8080 }[(r >> 40) % 4];
+    l4->dst_port = rte_cpu_to_be_16(dport);
+}
+
+// Reference: per-packet key extraction and ACL lookup for every IPv4 packet
+static uint64_t run_acl_only(void) {
+    struct rule_key keys[BURST];
+    const struct rule_key *key_ptrs[BURST];
+    uint32_t match[BURST];
+    uint64_t threats = 0;
+
+    for (unsigned b = 0; b < NUM_BURSTS; b++) {
+        unsigned nk = 0;
+        for (unsigned i = 0; i < BURST; i++) {
+            if (rules_extract_key(bursts[b][i], &keys[nk])) {
+                key_ptrs[nk] = &keys[nk];
+                nk++;
+            }
+        }
+        rules_classify(key_ptrs, match, nk);
+        for (unsigned k = 0; k < nk; k++)
+            threats += rules_action(match[k]) == RULE_ACTION_THREAT;
+    }
+    return threats;
+}
+
+// Detect-stage path: gather + burst classifier, ACL only for undecided lanes
+static uint64_t run_burst(void) {
+    struct burst_fields f;
+    struct rule_key keys[BURST];
+    const struct rule_key *key_ptrs[BURST];
+    uint32_t match[BURST], acl_match[BURST], decided;
+    uint64_t threats = 0;
+
+    for (unsigned b = 0; b < NUM_BURSTS; b++) {
+        burst_gather(bursts[b], BURST, &f);
+        uint32_t pending = burst_classify(&f, BURST, &decided, match) & ~decided;
+        for (uint32_t bits = decided; bits; bits &= bits - 1)
+            threats += rules_action(match[__builtin_ctz(bits)]) == RULE_ACTION_THREAT;
+
+        unsigned nk = 0;
+        for (uint32_t bits = pending; bits; bits &= bits - 1) {
+            rules_extract_key(bursts[b][__builtin_ctz(bits)], &keys[nk]);
+            key_ptrs[nk] = &keys[nk];
+            nk++;
+        }
+        rules_classify(key_ptrs, acl_match, nk);
+        for (unsigned k = 0; k < nk; k++)
+            threats += rules_action(acl_match[k]) == RULE_ACTION_THREAT;
+    }
+    return threats;
+}
+
+// Predicate evaluation alone, on pre-gathered fields
+static uint64_t run_predicates(const struct burst_fields *fields) {
+    uint32_t match[BURST], decided;
+    uint64_t acc = 0;
+
+    for (unsigned b = 0; b < NUM_BURSTS; b++)
+        acc += burst_classify(&fields[b], BURST, &decided, match) ^ decided;
+    return acc;
+}
+
+static double ns_per_pkt(uint64_t cycles) {
+    return (double)cycles * 1e9 / rte_get_tsc_hz() / ((double)ROUNDS * NUM_BURSTS * BURST);
+}
+
+int main(int argc, char *argv[]) {
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+    struct rte_mempool *pool = rte_pktmbuf_pool_create("BENCH_POOL", NUM_BURSTS * BURST + 1024, 256, 0,
+                                                       RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    static struct burst_fields fields[NUM_BURSTS];
+    if (!pool || rules_load(RULES_DEFAULT_FILE) < 0)
+        return 1;
+
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    for (unsigned b = 0; b < NUM_BURSTS; b++) {
+        if (rte_pktmbuf_alloc_bulk(pool, bursts[b], BURST) < 0)
+            return 1;
+        for (unsigned i = 0; i < BURST; i++)
+            fill_packet(bursts[b][i], &seed);
+        burst_gather(bursts[b], BURST, &fields[b]);
+    }
+
+    bench_header();
+
+    uint64_t t0 = rte_rdtsc_precise(), ref = 0;
+    for (unsigned r = 0; r < ROUNDS; r++)
+        ref = run_acl_only();
+    bench_report("classify", "acl_only", "latency", ns_per_pkt(rte_rdtsc_precise() - t0), "ns/pkt");
+
+    for (enum burst_impl impl = BURST_IMPL_SCALAR; impl <= BURST_IMPL_AVX2; impl++) {
+        if (burst_classify_init(impl) != impl)
+            continue;   // not supported by this CPU
+        const char *name = burst_impl_name(impl);
+        uint64_t threats = 0;
+
+        t0 = rte_rdtsc_precise();
+        for (unsigned r = 0; r < ROUNDS; r++)
+            threats = run_burst();
+        bench_report("classify", name, "latency", ns_per_pkt(rte_rdtsc_precise() - t0), "ns/pkt");
+
+        uint64_t acc = 0;
+        t0 = rte_rdtsc_precise();
+        for (unsigned r = 0; r < ROUNDS; r++)
+            acc += run_predicates(fields);
+        bench_report("classify", name, "predicates_only", ns_per_pkt(rte_rdtsc_precise() - t0), "ns/pkt");
+
+        if (threats != ref)
+            fprintf(stderr, "%s: verdict mismatch (%lu vs %lu threats)\n", name,
+                    (unsigned long)threats, (unsigned long)ref);
+        bench_sink += acc;
+    }
+
+    rules_free();
+    rte_eal_cleanup();
+    return 0;
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Compare two benchmark CSVs from bench/run_all.sh.
+
+Usage: ./bench/compare.py BASE.csv NEW.csv [--threshold PCT]
+
+Prints every metric present in both files with its relative change. A
+change worse than the threshold (default 5%) in a metric with a known
+direction is flagged, and the exit status is 1 if any was found.
+"""
+import argparse
+import csv
+import sys
+
+# Units where a larger value is better; time/cost units are lower-is-better.
+# Counts, sizes and anything else are shown but never flagged.
+HIGHER_UNITS = {"Mpps", "pps", "Mops/s", "records/s"}
+LOWER_UNITS = {"ns/pkt", "ns/record", "cycles/obj", "us", "us/s", "us/screen", "ms"}
+HIGHER_METRICS = ("hit", "recall")
+LOWER_METRICS = ("cpu_util",)
+
+
+def direction(metric, unit):
+    if unit in HIGHER_UNITS or any(m in metric for m in HIGHER_METRICS):
+        return 1
+    if unit in LOWER_UNITS or any(m in metric for m in LOWER_METRICS):
+        return -1
+    return 0
+
+
+def load(path):
+    rows = {}
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            try:
+                value = float(row["value"])
+            except (TypeError, ValueError):
+                continue
+            rows[(row["benchmark"], row["case"], row["metric"])] = (value, row["unit"])
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two benchmark result files")
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=5.0, help="regression threshold in percent")
+    args = parser.parse_args()
+
+    base, new = load(args.base), load(args.new)
+    regressions = 0
+    print(f"{'benchmark':<10} {'case':<24} {'metric':<22} {'base':>12} {'new':>12} {'change':>8}  unit")
+    for key in sorted(base.keys() & new.keys()):
+        (old, unit), (cur, _) = base[key], new[key]
+        change = (cur - old) / abs(old) * 100 if old else 0.0
+        worse = -change * direction(key[2], unit)
+        flag = ""
+        if direction(key[2], unit) and worse > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{key[0]:<10} {key[1]:<24} {key[2]:<22} {old:>12.3f} {cur:>12.3f} {change:>+7.1f}%  {unit}{flag}")
+
+    for key in sorted(base.keys() - new.keys()):
+        print(f"missing in {args.new}: {','.join(key)}")
+    for key in sorted(new.keys() - base.keys()):
+        print(f"new in {args.new}: {','.join(key)}")
+
+    if regressions:
+        print(f"\n{regressions} regression(s) beyond {args.threshold:.1f}%")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
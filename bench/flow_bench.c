@@ -0,0 +1,90 @@
+// flow_bench.c - insert/lookup throughput and memory per flow of the
+// detect-stage flow table at several load factors.
+//
+// Run: sudo ./bench/flow_bench --no-huge -m 512
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <rte_eal.h>
+#include <rte_cycles.h>
+
+#include "bench_common.h"
+#include "../flow_table.h"
+
+#define LOOKUP_ROUNDS 8
+
+static double mops(uint64_t ops, uint64_t cycles) {
+    return (double)ops / ((double)cycles / rte_get_tsc_hz()) / 1e6;
+}
+
+static void run(const char *cas, unsigned load_pct, const struct flow_limits *limits) {
+    static unsigned instance = 0;
+    char name[32];
+    snprintf(name, sizeof(name), "BENCH_FLOWS_%u", instance++);
+
+    struct flow_table *t = flow_table_create(name, FLOW_TABLE_SIZE, limits, rte_socket_id());
+    unsigned n = (unsigned)((uint64_t)FLOW_TABLE_SIZE * load_pct / 100);
+    struct flow_key *keys = calloc(n, sizeof(*keys));
+    if (!t || !keys) {
+        fprintf(stderr, "allocation failed\n");
+        exit(1);
+    }
+
+    uint64_t seed = 0x1234567887654321ULL;
+    for (unsigned i = 0; i < n; i++) {
+        uint64_t r = bench_rand(&seed);
+        keys[i].src_ip = (uint32_t)r;
+        keys[i].dst_ip = 0x0201A8C0;
+        keys[i].src_port = (uint16_t)(r >> 32);
+        keys[i].dst_port = (uint16_t)(r >> 48);
+        keys[i].proto = 6;
+    }
+
+    uint64_t now = rte_get_tsc_cycles();
+    uint64_t t0 = rte_rdtsc_precise();
+    for (unsigned i = 0; i < n; i++)
+        flow_table_update(t, &keys[i], 64, 0x10, now);
+    uint64_t insert_cycles = rte_rdtsc_precise() - t0;
+
+    // Random-order hits on existing flows
+    t0 = rte_rdtsc_precise();
+    for (unsigned r = 0; r < LOOKUP_ROUNDS; r++)
+        for (unsigned i = 0; i < n; i++)
+            flow_table_update(t, &keys[bench_rand(&seed) % n], 64, 0x10, now);
+    uint64_t lookup_cycles = rte_rdtsc_precise() - t0;
+
+    struct flow_table_stats st;
+    flow_table_get_stats(t, &st);
+    size_t mem = flow_table_memory(t);
+
+    char c[64];
+    snprintf(c, sizeof(c), "%s_load%u", cas, load_pct);
+    bench_report("flow_table", c, "insert_rate", mops(n, insert_cycles), "Mops/s");
+    bench_report("flow_table", c, "lookup_rate", mops((uint64_t)n * LOOKUP_ROUNDS, lookup_cycles), "Mops/s");
+    bench_report("flow_table", c, "insert_failures", (double)st.insert_failures, "count");
+    bench_report("flow_table", c, "memory_per_slot", (double)mem / st.capacity, "bytes");
+    bench_report("flow_table", c, "memory_per_active_flow", st.active ? (double)mem / st.active : 0, "bytes");
+
+    flow_table_free(t);
+    free(keys);
+}
+
+int main(int argc, char *argv[]) {
+    static const unsigned loads[] = { 25, 50, 75, 90 };
+    const struct flow_limits plain = { .idle_timeout_s = 30 };
+    const struct flow_limits detect = { .pps = 1000, .syn_ps = 200, .new_flows_ps = 100, .idle_timeout_s = 30 };
+
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+
+    bench_header();
+    for (size_t i = 0; i < sizeof(loads) / sizeof(loads[0]); i++)
+        run("flows_only", loads[i], &plain);
+    // With limits on, every new flow also updates its host-pair aggregate
+    run("with_limits", 50, &detect);
+
+    rte_eal_cleanup();
+    return 0;
+}
@@ -0,0 +1,198 @@
+// idle_bench.c - wake-up latency vs CPU usage of an RX polling loop under the
+// idle policies of idle_poll.h, across offered loads.
+//
+// Packets are timestamped and enqueued at a fixed rate into the RX ring of a
+// net_ring port; a receiver pinned to RECV_CORE polls the port like
+// rx_service() and records how long each packet waited in the ring.
+// Run from the repo root: sudo ./bench/idle_bench -l 0-1 --no-huge -m 512
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+#include <rte_eth_ring.h>
+#include <rte_cycles.h>
+#include <rte_mbuf.h>
+#include <rte_ring.h>
+
+#include "bench_common.h"
+#include "../idle_poll.h"
+#include "../latency_hist.h"
+
+#define RUN_MS      1000
+#define RECV_CORE   1
+#define RING_SIZE   4096
+#define BURST       32
+#define NUM_MBUFS   8191
+
+static struct rte_mempool *pool;
+static struct rte_ring *rx_ring;
+static uint16_t port;
+
+struct receiver {
+    struct idle_policy policy;
+    struct idle_stats idle;
+    struct latency_hist hist;
+    volatile bool running;
+    uint64_t packets;
+    double cpu_s, wall_s;
+};
+
+static double now_s(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *receive(void *arg) {
+    struct receiver *r = arg;
+    struct rte_mbuf *mbufs[BURST];
+    struct idle_poll idle;
+    uint64_t hz = rte_get_tsc_hz();
+
+    idle_poll_init(&idle, &r->policy, &r->idle);
+    idle_poll_watch_rx(&idle, port, 0);
+
+    double w0 = now_s(CLOCK_MONOTONIC), c0 = now_s(CLOCK_THREAD_CPUTIME_ID);
+    while (r->running) {
+        uint16_t n = rte_eth_rx_burst(port, 0, mbufs, BURST);
+        idle_poll_update(&idle, n);
+        if (n == 0)
+            continue;
+        uint64_t now = rte_get_tsc_cycles();
+        for (uint16_t i = 0; i < n; i++) {
+            uint64_t sent = *rte_pktmbuf_mtod(mbufs[i], uint64_t *);
+            lhist_record(&r->hist, (now - sent) * 1000000000ULL / hz);
+        }
+        rte_pktmbuf_free_bulk(mbufs, n);
+        r->packets += n;
+    }
+    r->cpu_s = now_s(CLOCK_THREAD_CPUTIME_ID) - c0;
+    r->wall_s = now_s(CLOCK_MONOTONIC) - w0;
+    return NULL;
+}
+
+// Paced single-packet arrivals, the worst case for a backed-off poller
+static uint64_t offer(unsigned pps) {
+    uint64_t hz = rte_get_tsc_hz(), start = rte_get_tsc_cycles();
+    uint64_t end = start + hz * RUN_MS / 1000, dropped = 0;
+
+    if (pps == 0) {
+        usleep(RUN_MS * 1000);
+        return 0;
+    }
+    uint64_t interval = hz / pps;
+    for (uint64_t next = start; next < end; next += interval) {
+        while (rte_get_tsc_cycles() < next)
+            ;
+        struct rte_mbuf *m = rte_pktmbuf_alloc(pool);
+        if (!m) {
+            dropped++;
+            continue;
+        }
+        rte_pktmbuf_append(m, 64);
+        *rte_pktmbuf_mtod(m, uint64_t *) = rte_get_tsc_cycles();
+        if (rte_ring_enqueue(rx_ring, m) < 0) {
+            rte_pktmbuf_free(m);
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+static void run(const char *mode, const struct idle_policy *policy, unsigned pps) {
+    static struct receiver r;
+    pthread_t thread;
+    pthread_attr_t attr;
+    cpu_set_t cpus;
+    char cas[64];
+
+    memset(&r, 0, sizeof(r));
+    r.policy = *policy;
+    r.running = true;
+    lhist_reset(&r.hist);
+    CPU_ZERO(&cpus);
+    CPU_SET(RECV_CORE, &cpus);
+    pthread_attr_init(&attr);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    if (pthread_create(&thread, &attr, receive, &r) != 0)
+        exit(1);
+    pthread_attr_destroy(&attr);
+
+    usleep(50000);      // let an idle receiver reach its deepest state
+    uint64_t dropped = offer(pps);
+    usleep(10000);
+    r.running = false;
+    pthread_join(thread, NULL);
+
+    snprintf(cas, sizeof(cas), "%s_%upps", mode, pps);
+    bench_report("idle", cas, "cpu_util", 100.0 * r.cpu_s / r.wall_s, "%");
+    bench_report("idle", cas, "packets", (double)r.packets, "count");
+    bench_report("idle", cas, "dropped", (double)dropped, "count");
+    if (r.hist.count) {
+        bench_report("idle", cas, "latency_p50", lhist_percentile(&r.hist, 50) / 1e3, "us");
+        bench_report("idle", cas, "latency_p99", lhist_percentile(&r.hist, 99) / 1e3, "us");
+        bench_report("idle", cas, "latency_max", r.hist.max / 1e3, "us");
+    }
+    bench_report("idle", cas, "power_waits", (double)r.idle.power_waits, "count");
+    bench_report("idle", cas, "umwait_waits", (double)r.idle.monitor_waits, "count");
+    bench_report("idle", cas, "sleeps", (double)r.idle.sleeps, "count");
+}
+
+static int setup_port(void) {
+    struct rte_eth_conf conf;
+    struct rte_ring *tx_ring;
+
+    pool = rte_pktmbuf_pool_create("IDLE_POOL", NUM_MBUFS, 256, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    rx_ring = rte_ring_create("IDLE_RX", RING_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    tx_ring = rte_ring_create("IDLE_TX", RING_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    if (!pool || !rx_ring || !tx_ring)
+        return -1;
+
+    int p = rte_eth_from_rings("net_ring_idle", &rx_ring, 1, &tx_ring, 1, rte_socket_id());
+    if (p < 0)
+        return -1;
+    port = (uint16_t)p;
+
+    memset(&conf, 0, sizeof(conf));
+    if (rte_eth_dev_configure(port, 1, 1, &conf) < 0 ||
+        rte_eth_rx_queue_setup(port, 0, RING_SIZE, rte_socket_id(), NULL, pool) < 0 ||
+        rte_eth_tx_queue_setup(port, 0, RING_SIZE, rte_socket_id(), NULL) < 0)
+        return -1;
+    return rte_eth_dev_start(port);
+}
+
+int main(int argc, char *argv[]) {
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+    if (setup_port() < 0) {
+        fprintf(stderr, "Cannot set up net_ring port\n");
+        return 1;
+    }
+
+    struct idle_policy busy, pause_only, adaptive;
+    idle_policy_parse("busy", &busy);
+    idle_policy_parse("adaptive", &adaptive);
+    // Never leaves the rte_pause() stage
+    idle_policy_parse("adaptive", &pause_only);
+    pause_only.pause_polls = UINT32_MAX - pause_only.spin_polls;
+
+    static const unsigned rates[] = { 0, 1000, 10000, 100000, 1000000 };
+    bench_header();
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        run("busy", &busy, rates[i]);
+        run("pause", &pause_only, rates[i]);
+        run("adaptive", &adaptive, rates[i]);
+    }
+    rte_eal_cleanup();
+    return 0;
+}
@@ -0,0 +1,202 @@
+// lcore_bench.c - what running a pipeline stage on an EAL lcore buys over a
+// plain pinned pthread (the Sequencer's thread backend): mbuf pool cache hit
+// rate and RX throughput.
+//
+// A generator allocates mbuf bursts into the RX ring of a net_ring port and a
+// receiver drains the port and frees them, both on the same kind of thread:
+//   pthread     pinned pthreads, no lcore id, so every get/put hits the pool ring
+//   lcore       rte_eal_remote_launch() on worker lcores
+//   registered  pinned pthreads that call rte_thread_register()
+// Run from the repo root: sudo ./bench/lcore_bench -l 0-2 --no-huge -m 512
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+#include <rte_eth_ring.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
+
+#include "bench_common.h"
+
+#define RUN_MS      1000
+#define GEN_CORE    1
+#define RECV_CORE   2
+#define RING_SIZE   4096
+#define BURST       32
+#define NUM_MBUFS   16383
+#define POOL_CACHE  250
+
+static struct rte_mempool *pool;
+static struct rte_ring *rx_ring;
+static uint16_t port;
+static volatile bool running;
+
+struct worker {
+    int (*fn)(void *);
+    bool do_register;
+    uint64_t ops, cache_hits, packets;
+};
+
+// A get is served from the cache when it holds the whole burst, a put when
+// the burst fits under the flush threshold
+static bool cache_serves_get(unsigned n) {
+    struct rte_mempool_cache *c = rte_mempool_default_cache(pool, rte_lcore_id());
+    return c && c->len >= n;
+}
+
+static bool cache_serves_put(unsigned n) {
+    struct rte_mempool_cache *c = rte_mempool_default_cache(pool, rte_lcore_id());
+    return c && c->len + n <= c->flushthresh;
+}
+
+static int generate(void *arg) {
+    struct worker *w = arg;
+    struct rte_mbuf *mbufs[BURST];
+
+    while (running) {
+        bool hit = cache_serves_get(BURST);
+        if (rte_pktmbuf_alloc_bulk(pool, mbufs, BURST) < 0)
+            continue;
+        w->ops++;
+        w->cache_hits += hit;
+        for (unsigned i = 0; i < BURST; i++)
+            rte_pktmbuf_append(mbufs[i], 64);
+        unsigned sent = rte_ring_enqueue_burst(rx_ring, (void **)mbufs, BURST, NULL);
+        w->packets += sent;
+        if (sent < BURST)
+            rte_pktmbuf_free_bulk(mbufs + sent, BURST - sent);
+    }
+    return 0;
+}
+
+static int receive(void *arg) {
+    struct worker *w = arg;
+    struct rte_mbuf *mbufs[BURST];
+
+    while (running) {
+        uint16_t n = rte_eth_rx_burst(port, 0, mbufs, BURST);
+        if (n == 0)
+            continue;
+        bool hit = cache_serves_put(n);
+        rte_pktmbuf_free_bulk(mbufs, n);
+        w->ops++;
+        w->cache_hits += hit;
+        w->packets += n;
+    }
+    return 0;
+}
+
+static void *thread_main(void *arg) {
+    struct worker *w = arg;
+    if (w->do_register && rte_thread_register() < 0)
+        fprintf(stderr, "rte_thread_register failed\n");
+    w->fn(w);
+    if (w->do_register)
+        rte_thread_unregister();
+    return NULL;
+}
+
+static void start_thread(pthread_t *thread, struct worker *w, unsigned core) {
+    pthread_attr_t attr;
+    cpu_set_t cpus;
+
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    pthread_attr_init(&attr);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    if (pthread_create(thread, &attr, thread_main, w) != 0)
+        exit(1);
+    pthread_attr_destroy(&attr);
+}
+
+static void run(const char *cas) {
+    struct worker gen = { .fn = generate }, recv = { .fn = receive };
+    pthread_t threads[2];
+    bool lcores = strcmp(cas, "lcore") == 0;
+
+    gen.do_register = recv.do_register = strcmp(cas, "registered") == 0;
+    running = true;
+    if (lcores) {
+        rte_eal_remote_launch(receive, &recv, RECV_CORE);
+        rte_eal_remote_launch(generate, &gen, GEN_CORE);
+    } else {
+        start_thread(&threads[0], &recv, RECV_CORE);
+        start_thread(&threads[1], &gen, GEN_CORE);
+    }
+
+    usleep(RUN_MS * 1000);
+    running = false;
+    if (lcores) {
+        rte_eal_wait_lcore(GEN_CORE);
+        rte_eal_wait_lcore(RECV_CORE);
+    } else {
+        pthread_join(threads[1], NULL);
+        pthread_join(threads[0], NULL);
+    }
+
+    // Drain what the receiver left behind so every case starts from a full pool
+    struct rte_mbuf *mbufs[BURST];
+    uint16_t n;
+    while ((n = rte_eth_rx_burst(port, 0, mbufs, BURST)) > 0)
+        rte_pktmbuf_free_bulk(mbufs, n);
+
+    bench_report("lcore", cas, "rx_throughput", recv.packets / (RUN_MS / 1000.0) / 1e6, "Mpps");
+    bench_report("lcore", cas, "alloc_cache_hit", gen.ops ? 100.0 * gen.cache_hits / gen.ops : 0, "%");
+    bench_report("lcore", cas, "free_cache_hit", recv.ops ? 100.0 * recv.cache_hits / recv.ops : 0, "%");
+}
+
+static int setup_port(void) {
+    struct rte_eth_conf conf;
+    struct rte_ring *tx_ring;
+
+    pool = rte_pktmbuf_pool_create("LCORE_POOL", NUM_MBUFS, POOL_CACHE, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    rx_ring = rte_ring_create("LCORE_RX", RING_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    tx_ring = rte_ring_create("LCORE_TX", RING_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    if (!pool || !rx_ring || !tx_ring)
+        return -1;
+
+    int p = rte_eth_from_rings("net_ring_lcore", &rx_ring, 1, &tx_ring, 1, rte_socket_id());
+    if (p < 0)
+        return -1;
+    port = (uint16_t)p;
+
+    memset(&conf, 0, sizeof(conf));
+    if (rte_eth_dev_configure(port, 1, 1, &conf) < 0 ||
+        rte_eth_rx_queue_setup(port, 0, RING_SIZE, rte_socket_id(), NULL, pool) < 0 ||
+        rte_eth_tx_queue_setup(port, 0, RING_SIZE, rte_socket_id(), NULL) < 0)
+        return -1;
+    return rte_eth_dev_start(port);
+}
+
+int main(int argc, char *argv[]) {
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+    if (!rte_lcore_is_enabled(GEN_CORE) || !rte_lcore_is_enabled(RECV_CORE)) {
+        fprintf(stderr, "Needs worker lcores %d and %d (e.g. -l 0-2)\n", GEN_CORE, RECV_CORE);
+        return 1;
+    }
+    if (setup_port() < 0) {
+        fprintf(stderr, "Cannot set up net_ring port\n");
+        return 1;
+    }
+
+    bench_header();
+    run("pthread");
+    run("lcore");
+    run("registered");
+
+    rte_eal_cleanup();
+    return 0;
+}
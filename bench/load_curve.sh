@@ -0,0 +1,48 @@
+#!/bin/bash
+# Throughput / loss curve: drives packet_logger with traffic_gen over a veth
+# pair at increasing offered rates and reports what it received and detected.
+# packet_logger listens on veth1 (net_af_packet), traffic_gen sends on veth0.
+#
+# Usage: sudo ./bench/load_curve.sh [seconds-per-rate] [mix] [rates...]
+#   e.g. sudo ./bench/load_curve.sh 5 burst 10000 50000 100000 200000 500000
+# Output: CSV on stdout (benchmark,case,metric,value,unit)
+
+DURATION=${1:-5}
+MIX=${2:-mixed}
+shift $(($# < 2 ? $# : 2))
+RATES=${*:-10000 50000 100000 200000 500000 1000000}
+BIN=${BIN:-./packet_logger}
+GEN=${GEN:-./traffic_gen}
+
+if ! ip link show veth0 >/dev/null 2>&1; then
+    ip link add veth0 type veth peer name veth1 || exit 1
+fi
+ip link set veth0 up
+ip link set veth1 up
+
+echo "benchmark,case,metric,value,unit"
+for rate in $RATES; do
+    log=$(mktemp)
+    # packet_logger outlives the generator so its queues drain before the stats
+    TERM=${TERM:-xterm} "$BIN" -l 0-3 --no-huge -m 1024 --file-prefix lc_dut \
+        --vdev net_af_packet0,iface=veth1 -- --duration $((DURATION + 2)) >/dev/null 2>"$log" &
+    dut=$!
+    sleep 1
+    gen=$("$GEN" -l 4 --no-huge -m 512 --file-prefix lc_gen --vdev net_af_packet1,iface=veth0 \
+              -- --mix "$MIX" --rate "$rate" --duration "$DURATION" 2>/dev/null)
+    wait $dut
+
+    sent=$(echo "$gen" | awk -F, '$3 == "tx_rate" { print $4 }')
+    rx=$(sed -n 's/.*Packets RX: \([0-9]*\).*/\1/p' "$log")
+    missed=$(sed -n 's/.*Packets dropped RX: \([0-9]*\).*/\1/p' "$log")
+    det=$(sed -n 's/.*DETECT rate: \([0-9]*\) pps.*/\1/p' "$log")
+    rm -f "$log"
+
+    echo "load_curve,${MIX}_${rate}pps,offered_rate,$rate,pps"
+    echo "load_curve,${MIX}_${rate}pps,tx_rate,${sent:-0},pps"
+    echo "load_curve,${MIX}_${rate}pps,rx_rate,$(awk -v n="${rx:-0}" -v d="$DURATION" 'BEGIN { printf "%.0f", n / d }'),pps"
+    echo "load_curve,${MIX}_${rate}pps,detect_rate,${det:-0},pps"
+    echo "load_curve,${MIX}_${rate}pps,rx_missed,${missed:-0},pkts"
+    echo "load_curve,${MIX}_${rate}pps,loss,$(awk -v s="${sent:-0}" -v d="$DURATION" -v n="${rx:-0}" \
+        'BEGIN { t = s * d; printf "%.2f", t > 0 && n < t ? 100 * (t - n) / t : 0 }'),%"
+done
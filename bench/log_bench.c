@@ -0,0 +1,266 @@
+// log_bench.c - sustained log throughput and producer (logger core) CPU cost:
+// the old per-packet format + fprintf + fflush path vs binary records pushed
+// to the asynchronous writer, plus the cost of formatting the screen history
+// and the logger release WCET with the screen drawn inline vs on the
+// dashboard thread.
+//
+// Run from the repo root: sudo ./bench/log_bench --no-huge -m 512
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ncurses.h>
+
+#include <rte_eal.h>
+#include <rte_ether.h>
+
+#include "bench_common.h"
+#include "../dashboard.h"
+#include "../latency_hist.h"
+#include "../log_writer.h"
+
+#define NUM_RECORDS 2000000
+#define BURST 32
+
+static double now_s(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill_record(struct log_record *rec, uint64_t *seed) {
+    uint64_t r = bench_rand(seed);
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memset(rec, 0, sizeof(*rec));
+    rec->wall_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    memcpy(rec->src_mac, &r, 6);
+    memcpy(rec->dst_mac, (const uint8_t[]){ 0x02, 0, 0, 0, 0, 1 }, 6);
+    rec->detect_delay_ns = r % 50000;
+    rec->log_delay_ns = (r >> 20) % 500000;
+    rec->verdict = (r >> 40) % 8 == 0 ? LOG_VERDICT_THREAT : LOG_VERDICT_SAFE;
+}
+
+static void report(const char *cas, double wall, double cpu) {
+    bench_report("log", cas, "throughput", NUM_RECORDS / wall, "records/s");
+    bench_report("log", cas, "producer_cpu", cpu * 1e9 / NUM_RECORDS, "ns/record");
+    bench_report("log", cas, "producer_cpu_util", 100.0 * cpu / wall, "%");
+}
+
+// What logger_service did per packet before the binary log
+static void run_fprintf(void) {
+    FILE *f = fopen("bench_log.csv", "w");
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    struct log_record rec;
+    if (!f)
+        exit(1);
+
+    double w0 = now_s(CLOCK_MONOTONIC), c0 = now_s(CLOCK_THREAD_CPUTIME_ID);
+    for (unsigned i = 0; i < NUM_RECORDS; i++) {
+        fill_record(&rec, &seed);
+        struct rte_ether_addr src, dst;
+        char src_mac[32], dst_mac[32], timestamp[32];
+        memcpy(&src, rec.src_mac, 6);
+        memcpy(&dst, rec.dst_mac, 6);
+        rte_ether_format_addr(src_mac, sizeof(src_mac), &src);
+        rte_ether_format_addr(dst_mac, sizeof(dst_mac), &dst);
+        time_t now_sec = time(NULL);
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now_sec));
+        fprintf(f, "%s,%s,%s,%s,%ldms,%ldms\n", timestamp, src_mac, dst_mac,
+                rec.verdict == LOG_VERDICT_THREAT ? "THREAT" : "SAFE",
+                (long)(rec.detect_delay_ns / 1000000), (long)(rec.log_delay_ns / 1000000));
+        fflush(f);
+    }
+    double cpu = now_s(CLOCK_THREAD_CPUTIME_ID) - c0;
+    fclose(f);
+    report("fprintf_fflush", now_s(CLOCK_MONOTONIC) - w0, cpu);
+    unlink("bench_log.csv");
+}
+
+// Bursts of binary records into the writer ring. When the writer falls
+// behind the producer sleeps instead of spinning, so its CPU time is only
+// the cost of building and queueing records.
+static void run_binary(void) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    struct log_record recs[BURST];
+    uint64_t backoffs = 0;
+
+    if (log_writer_start("bench_log.bin", -1) < 0)
+        exit(1);
+
+    double w0 = now_s(CLOCK_MONOTONIC), c0 = now_s(CLOCK_THREAD_CPUTIME_ID);
+    for (unsigned i = 0; i < NUM_RECORDS; i += BURST) {
+        for (unsigned j = 0; j < BURST; j++)
+            fill_record(&recs[j], &seed);
+        unsigned sent = 0;
+        while ((sent += log_writer_push(recs + sent, BURST - sent)) < BURST) {
+            usleep(50);
+            backoffs++;
+        }
+    }
+    double cpu = now_s(CLOCK_THREAD_CPUTIME_ID) - c0;
+    log_writer_stop();      // includes draining the ring to disk
+    report("binary_async", now_s(CLOCK_MONOTONIC) - w0, cpu);
+
+    struct log_writer_stats ls;
+    log_writer_get_stats(&ls);
+    bench_report("log", "binary_async", "writes", (double)ls.writes, "calls");
+    bench_report("log", "binary_async", "backoffs", (double)backoffs, "count");
+    unlink("bench_log.bin");
+}
+
+// Text the logger screen builds per history row at refresh, minus ncurses
+static void run_screen_format(void) {
+    enum { HISTORY = 50, ROUNDS = 20000 };
+    struct log_record hist[HISTORY];
+    uint64_t seed = 0x9E3779B97F4A7C15ULL, len = 0;
+    char line[160];
+
+    for (unsigned i = 0; i < HISTORY; i++)
+        fill_record(&hist[i], &seed);
+
+    double c0 = now_s(CLOCK_THREAD_CPUTIME_ID);
+    for (unsigned r = 0; r < ROUNDS; r++) {
+        for (unsigned i = 0; i < HISTORY; i++) {
+            const struct log_record *rec = &hist[i];
+            struct rte_ether_addr addr;
+            char timestamp[32], src_mac[RTE_ETHER_ADDR_FMT_SIZE], dst_mac[RTE_ETHER_ADDR_FMT_SIZE];
+            time_t sec = rec->wall_ns / 1000000000ULL;
+            struct tm tm_info;
+            strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime_r(&sec, &tm_info));
+            memcpy(&addr, rec->src_mac, RTE_ETHER_ADDR_LEN);
+            rte_ether_format_addr(src_mac, sizeof(src_mac), &addr);
+            memcpy(&addr, rec->dst_mac, RTE_ETHER_ADDR_LEN);
+            rte_ether_format_addr(dst_mac, sizeof(dst_mac), &addr);
+            len += snprintf(line, sizeof(line), "%s  %s -> %s     %s         %ldms        %ldms",
+                            timestamp, src_mac, dst_mac,
+                            rec->verdict == LOG_VERDICT_THREAT ? "THREAT" : "SAFE",
+                            (long)(rec->detect_delay_ns / 1000000), (long)(rec->log_delay_ns / 1000000));
+        }
+    }
+    double cpu = now_s(CLOCK_THREAD_CPUTIME_ID) - c0;
+    bench_sink += len;
+    bench_report("log", "screen_format", "format", cpu * 1e9 / ((double)ROUNDS * HISTORY), "ns/record");
+    bench_report("log", "screen_format", "refresh", cpu * 1e6 / ROUNDS, "us/screen");
+}
+
+// One LOGGER release: a burst into the writer, then the screen work of the
+// variant. Inline is what logger_service() did before the dashboard thread:
+// history insert on every release and a full redraw once per SCREEN_EVERY
+// releases (its 1 s refresh at the 5 ms period). Releases are spaced
+// RELEASE_GAP_US apart so the dashboard thread gets to redraw in between.
+enum { RELEASES = 4000, SCREEN_EVERY = 200, HISTORY = 50, RELEASE_GAP_US = 500 };
+
+static void draw_inline(const struct log_record *hist, unsigned count) {
+    erase();
+    mvprintw(0, 0, "Timestamp              SourceMAC           DestinationMAC      Threat   DetectDelay   LogDelay");
+    for (unsigned i = 0; i < count; i++) {
+        const struct log_record *rec = &hist[i];
+        struct rte_ether_addr addr;
+        char timestamp[32], src_mac[RTE_ETHER_ADDR_FMT_SIZE], dst_mac[RTE_ETHER_ADDR_FMT_SIZE];
+        time_t sec = rec->wall_ns / 1000000000ULL;
+        struct tm tm_info;
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime_r(&sec, &tm_info));
+        memcpy(&addr, rec->src_mac, RTE_ETHER_ADDR_LEN);
+        rte_ether_format_addr(src_mac, sizeof(src_mac), &addr);
+        memcpy(&addr, rec->dst_mac, RTE_ETHER_ADDR_LEN);
+        rte_ether_format_addr(dst_mac, sizeof(dst_mac), &addr);
+        bool threat = rec->verdict == LOG_VERDICT_THREAT;
+        attron(COLOR_PAIR(threat ? 1 : 2));
+        mvprintw(i + 1, 0, "%s  %s -> %s     %-7s  %9.1fus  %8.1fus", timestamp, src_mac, dst_mac,
+                 threat ? "THREAT" : "SAFE", rec->detect_delay_ns / 1e3, rec->log_delay_ns / 1e3);
+        attroff(COLOR_PAIR(threat ? 1 : 2));
+    }
+    refresh();
+}
+
+static void bench_counters(struct dashboard_counters *c) {
+    struct log_writer_stats ls;
+    log_writer_get_stats(&ls);
+    c->rx_packets = c->logged = ls.records;
+}
+
+static void run_release(bool inline_screen) {
+    static struct latency_hist exec;
+    static struct log_record hist[HISTORY];
+    const char *cas = inline_screen ? "release_inline_screen" : "release_dashboard";
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    struct log_record recs[BURST];
+    unsigned head = 0, count = 0;
+    FILE *devnull = fopen("/dev/null", "w");
+    SCREEN *screen = NULL;
+
+    if (!devnull || log_writer_start("bench_log.bin", -1) < 0)
+        exit(1);
+    if (inline_screen) {
+        screen = newterm("xterm", devnull, stdin);
+        if (!screen)
+            exit(1);
+        start_color();
+        init_pair(1, COLOR_RED, COLOR_BLACK);
+        init_pair(2, COLOR_GREEN, COLOR_BLACK);
+    } else {
+        const struct dashboard_source src = { .counters = bench_counters };
+        if (dashboard_start(&src, -1, devnull) < 0)
+            exit(1);
+    }
+
+    lhist_reset(&exec);
+    for (unsigned r = 0; r < RELEASES; r++) {
+        for (unsigned j = 0; j < BURST; j++)
+            fill_record(&recs[j], &seed);
+        double t0 = now_s(CLOCK_MONOTONIC);
+        log_writer_push(recs, BURST);
+        if (inline_screen) {
+            for (unsigned j = 0; j < BURST; j++) {
+                hist[head] = recs[j];
+                head = (head + 1) % HISTORY;
+            }
+            count = count + BURST < HISTORY ? count + BURST : HISTORY;
+            if (r % SCREEN_EVERY == SCREEN_EVERY - 1)
+                draw_inline(hist, count);   // rows in insertion order; the cost is what matters
+        } else {
+            dashboard_push(recs, BURST);
+        }
+        lhist_record(&exec, (uint64_t)((now_s(CLOCK_MONOTONIC) - t0) * 1e9));
+        usleep(RELEASE_GAP_US);
+    }
+
+    if (inline_screen) {
+        endwin();
+        delscreen(screen);
+    } else {
+        struct dashboard_stats ds;
+        dashboard_stop();
+        dashboard_get_stats(&ds);
+        bench_report("log", cas, "screen_refreshes", (double)ds.refreshes, "count");
+        bench_report("log", cas, "torn_reads", (double)ds.torn, "count");
+    }
+    log_writer_stop();
+    fclose(devnull);
+    unlink("bench_log.bin");
+
+    bench_report("log", cas, "exec_p50", lhist_percentile(&exec, 50) / 1e3, "us");
+    bench_report("log", cas, "exec_p99", lhist_percentile(&exec, 99) / 1e3, "us");
+    bench_report("log", cas, "exec_max", exec.max / 1e3, "us");
+}
+
+int main(int argc, char *argv[]) {
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+
+    bench_header();
+    run_fprintf();
+    run_binary();
+    run_screen_format();
+    run_release(true);
+    run_release(false);
+
+    rte_eal_cleanup();
+    return 0;
+}
@@ -0,0 +1,237 @@
+// mbuf_release_bench.c - packets lost to mbuf starvation when LOGGER stalls,
+// with the mbuf held until LOGGER (the old pipeline) or freed at DETECT
+// right after the summary is taken (detect_service() now).
+//
+// Lcore 1 plays NIC and RX: it allocates paced 64-byte frames from a pool of
+// NUM_MBUFS, as the PMD refills its descriptors, and counts every frame it
+// cannot allocate as imissed. Lcore 2 is DETECT: burst_gather(), summary
+// fields, then either keeps the mbuf or frees it. The main lcore is LOGGER:
+// one drain every LOGGER_PERIOD_US, plus a STALL_MS hiccup every
+// STALL_EVERY_MS (a slow disk, a long screen redraw). Only in the first case
+// does that backlog pin packet buffers.
+// Run from the repo root:
+//   sudo ./bench/mbuf_release_bench -l 0-2 --no-huge -m 512
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_eal.h>
+#include <rte_cycles.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
+#include <rte_udp.h>
+
+#include "bench_common.h"
+#include "../packet_logger.h"
+#include "../burst_classify.h"
+
+#define RUN_MS           2000
+#define OFFERED_PPS      1000000
+#define LOGGER_PERIOD_US 5000      // logger_service() period
+#define STALL_EVERY_MS   100
+#define STALL_MS         10
+#define RX_LCORE         1
+#define DETECT_LCORE     2
+#define DETECTED_SIZE    16384
+
+static struct rte_mempool *pkt_pool, *desc_pool;
+static struct rte_ring *pkt_ring, *det_ring;
+static volatile bool running;
+static bool release_at_detect;
+
+static struct {
+    uint64_t offered, imissed, rx_drops, detect_drops, no_desc, logged;
+} counts;
+
+static void fill_packet(struct rte_mbuf *m, uint64_t seq) {
+    char *p = rte_pktmbuf_append(m, 64);
+    memset(p, 0, 64);
+
+    struct rte_ether_hdr *eth = (struct rte_ether_hdr *)p;
+    struct rte_ipv4_hdr *ip = (struct rte_ipv4_hdr *)(eth + 1);
+    struct rte_udp_hdr *l4 = (struct rte_udp_hdr *)(ip + 1);
+    eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+    ip->version_ihl = 0x45;
+    ip->next_proto_id = IPPROTO_UDP;
+    ip->src_addr = rte_cpu_to_be_32(0x0A000000 | (uint32_t)(seq & 0xFFFF));
+    ip->dst_addr = rte_cpu_to_be_32(0xC0A80102);
+    l4->src_port = rte_cpu_to_be_16((uint16_t)seq);
+    l4->dst_port = rte_cpu_to_be_16(8080);
+}
+
+// NIC + rx_service(): one burst every BURST_SIZE / OFFERED_PPS seconds
+static int rx_stage_main(void *arg) {
+    struct rte_mbuf *mbufs[BURST_SIZE];
+    struct detection_result *results[BURST_SIZE];
+    uint64_t gap = rte_get_tsc_hz() * BURST_SIZE / OFFERED_PPS, next = rte_get_tsc_cycles(), seq = 0;
+    (void)arg;
+
+    while (running) {
+        while (rte_get_tsc_cycles() < next)
+            rte_pause();
+        next += gap;
+        counts.offered += BURST_SIZE;
+
+        // The NIC has no buffer to DMA into: the frame never reaches RX
+        if (rte_pktmbuf_alloc_bulk(pkt_pool, mbufs, BURST_SIZE) < 0) {
+            counts.imissed += BURST_SIZE;
+            continue;
+        }
+        for (unsigned i = 0; i < BURST_SIZE; i++)
+            fill_packet(mbufs[i], seq++);
+        if (rte_mempool_get_bulk(desc_pool, (void **)results, BURST_SIZE) < 0) {
+            counts.no_desc += BURST_SIZE;
+            rte_pktmbuf_free_bulk(mbufs, BURST_SIZE);
+            continue;
+        }
+        for (unsigned i = 0; i < BURST_SIZE; i++)
+            results[i]->mbuf = mbufs[i];
+        unsigned sent = rte_ring_enqueue_burst(pkt_ring, (void **)results, BURST_SIZE, NULL);
+        if (sent < BURST_SIZE) {
+            counts.rx_drops += BURST_SIZE - sent;
+            rte_pktmbuf_free_bulk(&mbufs[sent], BURST_SIZE - sent);
+            rte_mempool_put_bulk(desc_pool, (void **)&results[sent], BURST_SIZE - sent);
+        }
+    }
+    return 0;
+}
+
+// detect_service() without the rule lookup: gather, summary, optional free
+static int detect_stage_main(void *arg) {
+    struct detection_result *results[BURST_SIZE];
+    struct rte_mbuf *pkts[BURST_SIZE];
+    struct burst_fields fields;
+    (void)arg;
+
+    while (running) {
+        unsigned n = rte_ring_dequeue_burst(pkt_ring, (void **)results, BURST_SIZE, NULL);
+        if (n == 0)
+            continue;
+        for (unsigned i = 0; i < n; i++)
+            pkts[i] = results[i]->mbuf;
+        burst_gather(pkts, n, &fields);
+        for (unsigned i = 0; i < n; i++) {
+            struct detection_result *r = results[i];
+            const struct rte_ether_hdr *eth = rte_pktmbuf_mtod(pkts[i], const struct rte_ether_hdr *);
+            memcpy(r->src_mac, &fields.src_mac[i], RTE_ETHER_ADDR_LEN);
+            memcpy(r->dst_mac, &eth->dst_addr, RTE_ETHER_ADDR_LEN);
+            r->src_ip = fields.src_ip[i];
+            r->dst_ip = fields.dst_ip[i];
+            r->src_port = fields.src_port[i];
+            r->dst_port = fields.dst_port[i];
+            r->proto = fields.proto[i];
+            r->pkt_len = fields.pkt_len[i];
+            if (release_at_detect)
+                r->mbuf = NULL;
+        }
+        if (release_at_detect)
+            rte_pktmbuf_free_bulk(pkts, n);
+
+        unsigned sent = rte_ring_enqueue_burst(det_ring, (void **)results, n, NULL);
+        if (sent < n) {
+            counts.detect_drops += n - sent;
+            for (unsigned i = sent; i < n; i++)
+                rte_pktmbuf_free(results[i]->mbuf);
+            rte_mempool_put_bulk(desc_pool, (void **)&results[sent], n - sent);
+        }
+    }
+    return 0;
+}
+
+// logger_service(): everything queued, once per period, and stalls now and then
+static void logger_stage(void) {
+    struct detection_result *results[BURST_SIZE];
+    struct rte_mbuf *mbufs[BURST_SIZE];
+    uint64_t hz = rte_get_tsc_hz(), start = rte_get_tsc_cycles();
+    uint64_t end = start + hz * RUN_MS / 1000, next_stall = start + hz * STALL_EVERY_MS / 1000;
+
+    while (rte_get_tsc_cycles() < end) {
+        unsigned n;
+        do {
+            n = rte_ring_dequeue_burst(det_ring, (void **)results, BURST_SIZE, NULL);
+            unsigned held = 0;
+            for (unsigned i = 0; i < n; i++)
+                if (results[i]->mbuf)
+                    mbufs[held++] = results[i]->mbuf;
+            rte_pktmbuf_free_bulk(mbufs, held);
+            rte_mempool_put_bulk(desc_pool, (void **)results, n);
+            counts.logged += n;
+        } while (n == BURST_SIZE);
+
+        uint64_t now = rte_get_tsc_cycles();
+        if (now >= next_stall) {
+            rte_delay_us_block(STALL_MS * 1000);
+            next_stall = now + hz * STALL_EVERY_MS / 1000;
+        } else {
+            rte_delay_us_block(LOGGER_PERIOD_US);
+        }
+    }
+}
+
+static void run_case(const char *cas, bool release) {
+    memset(&counts, 0, sizeof(counts));
+    release_at_detect = release;
+
+    running = true;
+    rte_eal_remote_launch(detect_stage_main, NULL, DETECT_LCORE);
+    rte_eal_remote_launch(rx_stage_main, NULL, RX_LCORE);
+    logger_stage();
+    running = false;
+    rte_eal_wait_lcore(RX_LCORE);
+    rte_eal_wait_lcore(DETECT_LCORE);
+
+    // Drain what is still in flight so the next case starts with a full pool
+    struct detection_result *results[BURST_SIZE];
+    struct rte_ring *rings[] = { pkt_ring, det_ring };
+    for (unsigned r = 0; r < 2; r++) {
+        unsigned n;
+        while ((n = rte_ring_dequeue_burst(rings[r], (void **)results, BURST_SIZE, NULL)) > 0) {
+            for (unsigned i = 0; i < n; i++)
+                rte_pktmbuf_free(results[i]->mbuf);
+            rte_mempool_put_bulk(desc_pool, (void **)results, n);
+        }
+    }
+
+    double offered = counts.offered ? (double)counts.offered : 1.0;
+    bench_report("mbuf_release", cas, "imissed", (double)counts.imissed, "count");
+    bench_report("mbuf_release", cas, "imissed_pct", 100.0 * counts.imissed / offered, "%");
+    bench_report("mbuf_release", cas, "ring_drops", (double)(counts.rx_drops + counts.detect_drops), "count");
+    bench_report("mbuf_release", cas, "no_descriptor", (double)counts.no_desc, "count");
+    bench_report("mbuf_release", cas, "throughput", counts.logged / (RUN_MS / 1000.0) / 1e6, "Mpps");
+}
+
+int main(int argc, char *argv[]) {
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+    if (!rte_lcore_is_enabled(RX_LCORE) || !rte_lcore_is_enabled(DETECT_LCORE)) {
+        fprintf(stderr, "Needs lcores %d, %d: -l 0-2\n", RX_LCORE, DETECT_LCORE);
+        return 1;
+    }
+
+    // Same sizes as the application's pools
+    pkt_pool = rte_pktmbuf_pool_create("RELEASE_MBUF_POOL", NUM_MBUFS, MBUF_CACHE_SIZE, 0,
+                                       RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    desc_pool = rte_mempool_create("RELEASE_DESC_POOL", NUM_RESULTS, sizeof(struct detection_result),
+                                   RESULT_CACHE_SIZE, 0, NULL, NULL, NULL, NULL, rte_socket_id(), 0);
+    pkt_ring = rte_ring_create("RELEASE_PACKET", PACKET_RING_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    det_ring = rte_ring_create("RELEASE_DETECTED", DETECTED_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    if (!pkt_pool || !desc_pool || !pkt_ring || !det_ring) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    bench_header();
+    run_case("hold_until_log", false);
+    run_case("release_at_detect", true);
+
+    rte_eal_cleanup();
+    return 0;
+}
@@ -0,0 +1,139 @@
+// release_jitter.cpp - release accuracy of the Sequencer: the absolute-time
+// release table vs the previous sleep_for(1ms) tick loop.
+//
+// For each period the service start times are recorded and reduced to the
+// period-to-period jitter and the drift accumulated over the run; table runs
+// also report the release-to-start (wakeup) latency the Service measured.
+// Run as root so the release and service threads get SCHED_FIFO:
+//   sudo ./bench/release_jitter
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+extern "C" {
+#include "bench_common.h"
+}
+#include "../Sequencer.hpp"
+
+static constexpr int RUN_MS = 2000;
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Start times are mapped onto the ideal grid start[0] + slot * period. The
+// legacy loop queues every release (slot = index); the release table drops
+// releases that would overlap, so its slots are recovered by rounding.
+static void reportRun(const char* cas, const std::vector<uint64_t>& starts, uint32_t periodUs, bool dropsReleases) {
+    if (starts.size() < 3) {
+        fprintf(stderr, "%s: only %zu releases\n", cas, starts.size());
+        return;
+    }
+    double periodNs = periodUs * 1e3;
+    std::vector<double> dev;
+    double prevLate = 0, late = 0;
+    for (size_t i = 1; i < starts.size(); i++) {
+        double since = (double)(starts[i] - starts[0]);
+        double slot = dropsReleases ? std::round(since / periodNs) : (double)i;
+        late = since - slot * periodNs;
+        dev.push_back(std::fabs(late - prevLate) / 1e3);
+        prevLate = late;
+    }
+    std::sort(dev.begin(), dev.end());
+    double mean = 0;
+    for (double d : dev)
+        mean += d;
+
+    bench_report("release", cas, "releases", (double)starts.size(), "count");
+    bench_report("release", cas, "jitter_mean", mean / dev.size(), "us");
+    bench_report("release", cas, "jitter_p99", dev[dev.size() * 99 / 100], "us");
+    bench_report("release", cas, "jitter_max", dev.back(), "us");
+    bench_report("release", cas, "drift", late / 1e3, "us");
+    bench_report("release", cas, "drift_per_s", late / 1e3 * 1000.0 / RUN_MS, "us/s");
+}
+
+// The release loop Sequencer::startServices() used before the release table
+static void runLegacy(uint32_t periodMs) {
+    std::vector<uint64_t> starts;
+    starts.reserve(RUN_MS * 2);
+    std::atomic<bool> running{true};
+    sem_t sem;
+    sem_init(&sem, 0, 0);
+
+    std::jthread worker([&] {
+        while (true) {
+            sem_wait(&sem);
+            if (!running.load())
+                break;
+            starts.push_back(nowNs());
+        }
+    });
+    std::jthread ticker([&] {
+        int tick_ms = 0;
+        while (running.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ++tick_ms;
+            if (tick_ms % periodMs == 0)
+                sem_post(&sem);
+            if (tick_ms >= 1000) tick_ms = 0;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+    running.store(false);
+    ticker.join();
+    sem_post(&sem);
+    worker.join();
+    sem_destroy(&sem);
+
+    std::string cas = "legacy_" + std::to_string(periodMs * 1000) + "us";
+    reportRun(cas.c_str(), starts, periodMs * 1000, false);
+}
+
+static void runTable(uint32_t periodUs) {
+    std::vector<uint64_t> starts;
+    starts.reserve((size_t)RUN_MS * 1000 / periodUs + 16);
+    std::string name = "JITTER_" + std::to_string(periodUs);
+    uint64_t missed;
+    struct latency_hist wakeup;
+    {
+        Sequencer sequencer;
+        // A second, slower service makes the table non-trivial
+        sequencer.addService([&] {
+            if (starts.size() < starts.capacity())
+                starts.push_back(nowNs());
+        }, name, 1, sched_get_priority_max(SCHED_FIFO), periodUs);
+        sequencer.addService([] {}, name + "_SLOW", 1, sched_get_priority_max(SCHED_FIFO) - 1, periodUs * 4);
+        if (!sequencer.startServices())
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+        sequencer.stopServices();
+        missed = sequencer.getMissedReleases();
+        wakeup = sequencer.findService(name)->getReleaseToStart();
+    }
+
+    std::string cas = "table_" + std::to_string(periodUs) + "us";
+    reportRun(cas.c_str(), starts, periodUs, true);
+    bench_report("release", cas.c_str(), "missed", (double)missed, "count");
+    // Scheduled release instant -> service running: timer + semaphore wakeup
+    bench_report("release", cas.c_str(), "wakeup_p50", lhist_percentile(&wakeup, 50) / 1e3, "us");
+    bench_report("release", cas.c_str(), "wakeup_p99", lhist_percentile(&wakeup, 99) / 1e3, "us");
+    bench_report("release", cas.c_str(), "wakeup_max", wakeup.max / 1e3, "us");
+    unlink((name + "_hist.csv").c_str());
+    unlink((name + "_SLOW_hist.csv").c_str());
+}
+
+int main() {
+    bench_header();
+    for (uint32_t ms : {1u, 5u})
+        runLegacy(ms);
+    for (uint32_t us : {250u, 1000u, 5000u})
+        runTable(us);
+    return 0;
+}
@@ -0,0 +1,359 @@
+// ring_bench.c - cost of moving detection descriptors through packet_ring and
+// detected_ring, alone and as an RX -> DETECT -> LOGGER pipeline.
+//
+// Part 1 times enqueue + dequeue on one core per object for the ring flags
+// and burst sizes the pipeline uses. Part 2 feeds synthetic mbufs from a
+// net_null port through rings created like Sequencer.cpp does: RX on lcore
+// 1, DETECT on lcore 2, the sink (LOGGER's dequeue) on the main lcore.
+// Part 3 floods the same pipeline past what a periodic, budgeted LOGGER
+// can log, marks one record in THREAT_EVERY as a threat and measures how
+// long threats wait for LOGGER: behind SAFE records in one FIFO, or in
+// their own lane drained first.
+// Run from the repo root:
+//   sudo ./bench/ring_bench -l 0-2 --no-huge -m 512 --vdev net_null0,size=64
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_eal.h>
+#include <rte_cycles.h>
+#include <rte_ethdev.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
+
+#include "bench_common.h"
+#include "../packet_logger.h"
+#include "../latency_hist.h"
+
+#define RUN_MS        1000
+#define RX_LCORE      1
+#define DETECT_LCORE  2
+#define DETECTED_SIZE 8192
+#define XFER_ROUNDS   200000
+
+#define THREAT_EVERY     64
+#define LANE_SIZE        1024     // THREAT_RING_SIZE
+#define LOGGER_PERIOD_US 5000     // logger_service() period and budget
+#define LOGGER_BUDGET_US 2000
+#define LOG_RECORD_NS    200      // per-record cost of logging, so the flood backs up
+
+static struct rte_mempool *pkt_pool, *desc_pool;
+static struct rte_ring *pkt_ring, *det_ring;
+static uint16_t port;
+static volatile bool running;
+
+struct stage {
+    uint64_t objs, ring_full;
+    struct latency_hist hop;      // previous stage -> this stage, ns
+};
+
+static struct stage rx_stage, detect_stage, sink_stage;
+
+// Part 3
+static struct rte_ring *lane_ring;      // NULL: threats share det_ring
+static struct latency_hist threat_wait; // detect -> logged, THREAT records
+static uint64_t threats_sent, threats_dropped, threats_logged;
+
+static uint64_t cycles_to_ns(uint64_t cycles) {
+    return cycles * 1000000000ULL / rte_get_tsc_hz();
+}
+
+// Part 1: one core, ring half full so neither side runs into the ends
+static void run_transfer(const char *flags_name, unsigned flags, unsigned burst) {
+    void *objs[BURST_SIZE * 2];
+    char cas[48];
+    struct rte_ring *r = rte_ring_create("XFER_RING", PACKET_RING_SIZE, rte_socket_id(), flags);
+    if (!r)
+        exit(1);
+
+    for (unsigned i = 0; i < burst; i++)
+        objs[i] = (void *)(uintptr_t)(i + 1);
+    for (unsigned i = 0; i < PACKET_RING_SIZE / 2; i += burst)
+        rte_ring_enqueue_bulk(r, objs, burst, NULL);
+
+    uint64_t start = rte_rdtsc_precise();
+    for (unsigned i = 0; i < XFER_ROUNDS; i++) {
+        rte_ring_enqueue_burst(r, objs, burst, NULL);
+        rte_ring_dequeue_burst(r, objs, burst, NULL);
+    }
+    uint64_t cycles = rte_rdtsc_precise() - start;
+    rte_ring_free(r);
+
+    snprintf(cas, sizeof(cas), "%s_burst%u", flags_name, burst);
+    bench_report("ring", cas, "enq_deq", (double)cycles / ((uint64_t)XFER_ROUNDS * burst), "cycles/obj");
+}
+
+// Part 2 stages, as in rx_service(), detect_service() and logger_service()
+static int rx_stage_main(void *arg) {
+    struct rte_mbuf *mbufs[BURST_SIZE];
+    struct detection_result *results[BURST_SIZE];
+    (void)arg;
+
+    while (running) {
+        uint16_t n = rte_eth_rx_burst(port, 0, mbufs, BURST_SIZE);
+        if (n == 0)
+            continue;
+        if (rte_mempool_get_bulk(desc_pool, (void **)results, n) < 0) {
+            rte_pktmbuf_free_bulk(mbufs, n);
+            continue;
+        }
+        uint64_t now = rte_get_tsc_cycles();
+        for (uint16_t i = 0; i < n; i++) {
+            results[i]->mbuf = mbufs[i];
+            results[i]->rx_tsc = now;
+        }
+        unsigned sent = rte_ring_enqueue_burst(pkt_ring, (void **)results, n, NULL);
+        rx_stage.objs += sent;
+        if (sent < n) {
+            rx_stage.ring_full += n - sent;
+            for (unsigned i = sent; i < n; i++)
+                rte_pktmbuf_free(results[i]->mbuf);
+            rte_mempool_put_bulk(desc_pool, (void **)&results[sent], n - sent);
+        }
+    }
+    return 0;
+}
+
+static int detect_stage_main(void *arg) {
+    struct detection_result *results[BURST_SIZE];
+    (void)arg;
+
+    while (running) {
+        unsigned n = rte_ring_dequeue_burst(pkt_ring, (void **)results, BURST_SIZE, NULL);
+        if (n == 0)
+            continue;
+        uint64_t now = rte_get_tsc_cycles();
+        for (unsigned i = 0; i < n; i++) {
+            lhist_record(&detect_stage.hop, cycles_to_ns(now - results[i]->rx_tsc));
+            results[i]->detect_tsc = now;
+        }
+        unsigned sent = rte_ring_enqueue_burst(det_ring, (void **)results, n, NULL);
+        detect_stage.objs += sent;
+        if (sent < n) {
+            detect_stage.ring_full += n - sent;
+            for (unsigned i = sent; i < n; i++)
+                rte_pktmbuf_free(results[i]->mbuf);
+            rte_mempool_put_bulk(desc_pool, (void **)&results[sent], n - sent);
+        }
+    }
+    return 0;
+}
+
+static void sink(void) {
+    struct detection_result *results[BURST_SIZE];
+    struct rte_mbuf *mbufs[BURST_SIZE];
+    uint64_t end = rte_get_tsc_cycles() + rte_get_tsc_hz() * RUN_MS / 1000;
+
+    while (rte_get_tsc_cycles() < end) {
+        unsigned n = rte_ring_dequeue_burst(det_ring, (void **)results, BURST_SIZE, NULL);
+        if (n == 0)
+            continue;
+        uint64_t now = rte_get_tsc_cycles();
+        for (unsigned i = 0; i < n; i++) {
+            lhist_record(&sink_stage.hop, cycles_to_ns(now - results[i]->detect_tsc));
+            mbufs[i] = results[i]->mbuf;
+        }
+        rte_pktmbuf_free_bulk(mbufs, n);
+        rte_mempool_put_bulk(desc_pool, (void **)results, n);
+        sink_stage.objs += n;
+    }
+}
+
+// DETECT with verdicts: threats first, into the lane when there is one
+static int mixed_detect_main(void *arg) {
+    struct detection_result *results[BURST_SIZE], *safe[BURST_SIZE];
+    uint64_t seq = 0;
+    (void)arg;
+
+    while (running) {
+        unsigned n = rte_ring_dequeue_burst(pkt_ring, (void **)results, BURST_SIZE, NULL);
+        if (n == 0)
+            continue;
+        uint64_t now = rte_get_tsc_cycles();
+        unsigned t = 0, s = 0;
+        for (unsigned i = 0; i < n; i++) {
+            struct detection_result *r = results[i];
+            r->detect_tsc = now;
+            r->rule_id = seq++ % THREAT_EVERY == 0;
+            rte_pktmbuf_free(r->mbuf);      // released at DETECT, as in detect_service()
+            r->mbuf = NULL;
+            if (r->rule_id)
+                results[t++] = r;
+            else
+                safe[s++] = r;
+        }
+        memcpy(&results[t], safe, s * sizeof(safe[0]));
+        threats_sent += t;
+
+        unsigned in_lane = lane_ring && t ? rte_ring_enqueue_burst(lane_ring, (void **)results, t, NULL) : 0;
+        unsigned sent = rte_ring_enqueue_burst(det_ring, (void **)&results[in_lane], n - in_lane, NULL);
+        for (unsigned i = in_lane + sent; i < n; i++)
+            threats_dropped += results[i]->rule_id;
+        if (in_lane + sent < n)
+            rte_mempool_put_bulk(desc_pool, (void **)&results[in_lane + sent], n - in_lane - sent);
+    }
+    return 0;
+}
+
+static unsigned log_burst(struct rte_ring *r, uint64_t record_cycles) {
+    struct detection_result *results[BURST_SIZE];
+    unsigned n = rte_ring_dequeue_burst(r, (void **)results, BURST_SIZE, NULL);
+    if (n == 0)
+        return 0;
+    uint64_t now = rte_get_tsc_cycles();
+    for (unsigned i = 0; i < n; i++) {
+        if (results[i]->rule_id) {
+            lhist_record(&threat_wait, cycles_to_ns(now - results[i]->detect_tsc));
+            threats_logged++;
+        }
+    }
+    uint64_t until = rte_get_tsc_cycles() + record_cycles * n;
+    while (rte_get_tsc_cycles() < until)
+        rte_pause();
+    rte_mempool_put_bulk(desc_pool, (void **)results, n);
+    return n;
+}
+
+// logger_service(): one budgeted drain per period, the lane emptied before every burst
+static void periodic_sink(void) {
+    uint64_t hz = rte_get_tsc_hz(), start = rte_get_tsc_cycles();
+    uint64_t end = start + hz * RUN_MS / 1000, period = hz / 1000000 * LOGGER_PERIOD_US;
+    uint64_t budget = hz / 1000000 * LOGGER_BUDGET_US, record_cycles = hz / 1000000000.0 * LOG_RECORD_NS;
+
+    for (uint64_t release = start; release < end; release += period) {
+        while (rte_get_tsc_cycles() < release)
+            rte_pause();
+        unsigned n;
+        do {
+            if (lane_ring)
+                while (log_burst(lane_ring, record_cycles) == BURST_SIZE)
+                    ;
+            n = log_burst(det_ring, record_cycles);
+        } while (n == BURST_SIZE && rte_get_tsc_cycles() - release < budget);
+    }
+}
+
+// Whatever a run left in the rings goes back to the pools
+static void drain_rings(void) {
+    struct detection_result *results[BURST_SIZE];
+    struct rte_ring *rings[] = { pkt_ring, det_ring, lane_ring };
+    for (unsigned r = 0; r < 3; r++) {
+        unsigned n;
+        while (rings[r] && (n = rte_ring_dequeue_burst(rings[r], (void **)results, BURST_SIZE, NULL)) > 0) {
+            for (unsigned i = 0; i < n; i++)
+                rte_pktmbuf_free(results[i]->mbuf);
+            rte_mempool_put_bulk(desc_pool, (void **)results, n);
+        }
+    }
+}
+
+static void run_threat_lane(const char *cas, bool lane) {
+    drain_rings();
+    lhist_reset(&threat_wait);
+    threats_sent = threats_dropped = threats_logged = 0;
+    lane_ring = lane ? rte_ring_create("RING_THREAT", LANE_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ)
+                     : NULL;
+    if (lane && !lane_ring)
+        exit(1);
+    if (rte_eth_dev_start(port) < 0)
+        exit(1);
+
+    running = true;
+    rte_eal_remote_launch(mixed_detect_main, NULL, DETECT_LCORE);
+    rte_eal_remote_launch(rx_stage_main, NULL, RX_LCORE);
+    periodic_sink();
+    running = false;
+    rte_eal_wait_lcore(RX_LCORE);
+    rte_eal_wait_lcore(DETECT_LCORE);
+    rte_eth_dev_stop(port);
+
+    drain_rings();
+    rte_ring_free(lane_ring);
+    lane_ring = NULL;
+
+    bench_report("ring", cas, "threat_to_log_p50", lhist_percentile(&threat_wait, 50) / 1e3, "us");
+    bench_report("ring", cas, "threat_to_log_p99", lhist_percentile(&threat_wait, 99) / 1e3, "us");
+    bench_report("ring", cas, "threat_to_log_max", threat_wait.max / 1e3, "us");
+    bench_report("ring", cas, "threats_logged", (double)threats_logged, "count");
+    bench_report("ring", cas, "threats_dropped", (double)threats_dropped, "count");
+}
+
+static void report_hop(const char *cas, const struct latency_hist *h) {
+    bench_report("ring", cas, "latency_p50", lhist_percentile(h, 50) / 1e3, "us");
+    bench_report("ring", cas, "latency_p99", lhist_percentile(h, 99) / 1e3, "us");
+    bench_report("ring", cas, "latency_max", h->max / 1e3, "us");
+}
+
+static int run_pipeline(void) {
+    struct rte_eth_conf conf;
+
+    memset(&conf, 0, sizeof(conf));
+    if (rte_eth_dev_configure(port, 1, 0, &conf) < 0 ||
+        rte_eth_rx_queue_setup(port, 0, RX_RING_SIZE, rte_socket_id(), NULL, pkt_pool) < 0 ||
+        rte_eth_dev_start(port) < 0) {
+        fprintf(stderr, "Cannot start port %u\n", port);
+        return -1;
+    }
+    lhist_reset(&detect_stage.hop);
+    lhist_reset(&sink_stage.hop);
+
+    running = true;
+    rte_eal_remote_launch(detect_stage_main, NULL, DETECT_LCORE);
+    rte_eal_remote_launch(rx_stage_main, NULL, RX_LCORE);
+    sink();
+    running = false;
+    rte_eal_wait_lcore(RX_LCORE);
+    rte_eal_wait_lcore(DETECT_LCORE);
+    rte_eth_dev_stop(port);
+
+    bench_report("ring", "pipeline", "throughput", sink_stage.objs / (RUN_MS / 1000.0) / 1e6, "Mpps");
+    bench_report("ring", "pipeline", "packet_ring_full", (double)rx_stage.ring_full, "count");
+    bench_report("ring", "pipeline", "detected_ring_full", (double)detect_stage.ring_full, "count");
+    report_hop("rx_to_detect", &detect_stage.hop);
+    report_hop("detect_to_logger", &sink_stage.hop);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+    if (rte_eth_dev_count_avail() == 0 || !rte_lcore_is_enabled(RX_LCORE) || !rte_lcore_is_enabled(DETECT_LCORE)) {
+        fprintf(stderr, "Needs a port and lcores %d, %d: -l 0-2 --vdev net_null0,size=64\n",
+                RX_LCORE, DETECT_LCORE);
+        return 1;
+    }
+    port = rte_eth_find_next(0);
+
+    pkt_pool = rte_pktmbuf_pool_create("RING_MBUF_POOL", NUM_MBUFS, MBUF_CACHE_SIZE, 0,
+                                       RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    desc_pool = rte_mempool_create("RING_DESC_POOL", NUM_RESULTS, sizeof(struct detection_result),
+                                   RESULT_CACHE_SIZE, 0, NULL, NULL, NULL, NULL, rte_socket_id(), 0);
+    pkt_ring = rte_ring_create("RING_PACKET", PACKET_RING_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    det_ring = rte_ring_create("RING_DETECTED", DETECTED_SIZE, rte_socket_id(), RING_F_SP_ENQ | RING_F_SC_DEQ);
+    if (!pkt_pool || !desc_pool || !pkt_ring || !det_ring) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    bench_header();
+    // packet_ring is always SP/SC; detected_ring becomes MP/SC with RSS
+    static const unsigned bursts[] = { 1, 8, BURST_SIZE };
+    for (unsigned i = 0; i < sizeof(bursts) / sizeof(bursts[0]); i++) {
+        run_transfer("sp_sc", RING_F_SP_ENQ | RING_F_SC_DEQ, bursts[i]);
+        run_transfer("mp_sc", RING_F_SC_DEQ, bursts[i]);
+    }
+    int ret = run_pipeline();
+    if (ret == 0) {
+        run_threat_lane("threats_fifo", false);
+        run_threat_lane("threats_lane", true);
+    }
+
+    rte_eal_cleanup();
+    return ret < 0;
+}
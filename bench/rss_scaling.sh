@@ -0,0 +1,22 @@
+#!/bin/bash
+# RSS scaling benchmark: runs packet_logger against a net_null vdev (no NIC
+# needed) with 1/2/4/8 RX queues and reports the RX and DETECT rates.
+#
+# Usage: sudo ./bench/rss_scaling.sh [seconds-per-run] [vdev]
+#   e.g. sudo ./bench/rss_scaling.sh 5 net_null0,size=64
+# Output: CSV on stdout (benchmark,case,metric,value,unit)
+
+DURATION=${1:-5}
+VDEV=${2:-net_null0,size=64}
+BIN=${BIN:-./packet_logger}
+
+echo "benchmark,case,metric,value,unit"
+for q in 1 2 4 8; do
+    # ncurses screen goes to /dev/null, syslog (LOG_PERROR) comes back on stderr
+    line=$(TERM=${TERM:-xterm} "$BIN" -l 0 --no-huge -m 1024 --vdev="$VDEV" \
+               -- --rx-queues "$q" --duration "$DURATION" 2>&1 >/dev/null | grep "RX rate:")
+    rx=$(echo "$line" | sed -n 's/.*RX rate: \([0-9]*\) pps.*/\1/p')
+    det=$(echo "$line" | sed -n 's/.*DETECT rate: \([0-9]*\) pps.*/\1/p')
+    echo "rss_scaling,queues=$q,rx_rate,${rx:-0},pps"
+    echo "rss_scaling,queues=$q,detect_rate,${det:-0},pps"
+done
@@ -0,0 +1,113 @@
+// rules_bench.c - classification cost of the rule table (rte_acl) for
+// 10, 1k and 10k rules.
+//
+// Run: sudo ./bench/rules_bench --no-huge -m 512
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_eal.h>
+#include <rte_cycles.h>
+#include <rte_byteorder.h>
+
+#include "bench_common.h"
+#include "../rules.h"
+
+#define NUM_KEYS 65536
+#define ROUNDS 64
+#define BURST 32
+
+static void random_rule(struct rule_spec *s, uint64_t *seed) {
+    static const uint8_t protos[] = { IPPROTO_TCP, IPPROTO_UDP, IPPROTO_ICMP };
+    uint64_t r = bench_rand(seed);
+
+    memset(s, 0, sizeof(*s));
+    s->proto = protos[r % 3];
+    s->proto_mask = 0xff;
+    s->src_ip = (uint32_t)bench_rand(seed);
+    s->src_depth = 8 + r % 25;
+    s->dst_ip = (uint32_t)bench_rand(seed);
+    s->dst_depth = 16 + (r >> 8) % 17;
+    s->sport_hi = UINT16_MAX;
+    s->dport_lo = (uint16_t)(r >> 16);
+    s->dport_hi = s->dport_lo + (uint16_t)((r >> 32) % 1024);
+    if (s->dport_hi < s->dport_lo)
+        s->dport_hi = UINT16_MAX;
+    s->len_hi = UINT16_MAX;
+    if (s->proto == IPPROTO_TCP && (r >> 40) % 4 == 0) {
+        s->tcp_flags = 0x02;
+        s->tcp_flags_mask = 0x12;
+    }
+    s->action = (r >> 48) & 1;
+}
+
+static void random_key(struct rule_key *k, uint64_t *seed) {
+    static const uint8_t protos[] = { IPPROTO_TCP, IPPROTO_UDP, IPPROTO_ICMP };
+    uint64_t r = bench_rand(seed);
+
+    k->proto = protos[r % 3];
+    k->tcp_flags = (uint8_t)(r >> 8);
+    k->pkt_len = rte_cpu_to_be_16(64 + (r >> 16) % 1454);
+    k->src_ip = (uint32_t)bench_rand(seed);
+    k->dst_ip = (uint32_t)bench_rand(seed);
+    k->src_port = (uint16_t)(r >> 32);
+    k->dst_port = (uint16_t)(r >> 48);
+}
+
+int main(int argc, char *argv[]) {
+    static const unsigned rule_counts[] = { 10, 1000, 10000 };
+
+    if (rte_eal_init(argc, argv) < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+
+    struct rule_key *keys = malloc(NUM_KEYS * sizeof(*keys));
+    const struct rule_key **key_ptrs = malloc(NUM_KEYS * sizeof(*key_ptrs));
+    uint32_t *matches = malloc(NUM_KEYS * sizeof(*matches));
+    if (!keys || !key_ptrs || !matches)
+        return 1;
+
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    for (unsigned i = 0; i < NUM_KEYS; i++) {
+        random_key(&keys[i], &seed);
+        key_ptrs[i] = &keys[i];
+    }
+
+    bench_header();
+    for (size_t c = 0; c < sizeof(rule_counts) / sizeof(rule_counts[0]); c++) {
+        unsigned n = rule_counts[c];
+        struct rule_spec *specs = malloc(n * sizeof(*specs));
+        char cas[32];
+
+        for (unsigned i = 0; i < n; i++)
+            random_rule(&specs[i], &seed);
+
+        uint64_t t0 = rte_rdtsc_precise();
+        if (rules_build(specs, n) < 0) {
+            fprintf(stderr, "rule build failed for %u rules\n", n);
+            return 1;
+        }
+        uint64_t build_cycles = rte_rdtsc_precise() - t0;
+
+        t0 = rte_rdtsc_precise();
+        for (unsigned r = 0; r < ROUNDS; r++) {
+            for (unsigned i = 0; i < NUM_KEYS; i += BURST)
+                rules_classify(&key_ptrs[i], &matches[i], BURST);
+        }
+        uint64_t cycles = rte_rdtsc_precise() - t0;
+
+        double ns_per_pkt = (double)cycles * 1e9 / rte_get_tsc_hz() / ((double)ROUNDS * NUM_KEYS);
+        snprintf(cas, sizeof(cas), "rules=%u", n);
+        bench_report("rules_classify", cas, "latency", ns_per_pkt, "ns/pkt");
+        bench_report("rules_classify", cas, "build_time", (double)build_cycles * 1e3 / rte_get_tsc_hz(), "ms");
+        free(specs);
+    }
+
+    rules_free();
+    rte_eal_cleanup();
+    free(keys);
+    free(key_ptrs);
+    free(matches);
+    return 0;
+}
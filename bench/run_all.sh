@@ -0,0 +1,50 @@
+#!/bin/bash
+# Runs every offline benchmark on synthetic traffic (no NIC, no hugepages)
+# and collects their CSV rows into one file named after the commit, so two
+# runs can be compared with bench/compare.py.
+#
+# Usage: sudo ./bench/run_all.sh [out.csv]     (or: sudo make bench)
+# Needs at least 3 cores for the lcore/ring benchmarks. EAL and benchmark
+# diagnostics go to bench/results/<commit>.log.
+
+cd "$(dirname "$0")/.." || exit 1
+REV=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+git diff --quiet HEAD 2>/dev/null || REV="$REV-dirty"
+mkdir -p bench/results
+OUT=${1:-bench/results/$REV.csv}
+LOG=${OUT%.csv}.log
+EAL="--no-huge -m 512 --file-prefix bench"
+
+echo "benchmark,case,metric,value,unit" > "$OUT"
+: > "$LOG"
+
+run() {
+    local bin=$1; shift
+    if [ ! -x "$bin" ]; then
+        echo "skipping $bin: not built" | tee -a "$LOG" >&2
+        return
+    fi
+    echo "running $bin" >&2
+    # Each benchmark prints its own header line first
+    "$bin" "$@" 2>>"$LOG" | tail -n +2 >> "$OUT"
+    [ "${PIPESTATUS[0]}" -eq 0 ] || echo "$bin failed, see $LOG" >&2
+}
+
+run bench/rules_bench    $EAL
+run bench/classify_bench $EAL
+run bench/bpf_bench      $EAL
+run bench/flow_bench     $EAL
+run bench/sketch_bench
+run bench/log_bench      $EAL
+run bench/ring_bench     -l 0-2 $EAL --vdev net_null0,size=64
+run bench/mbuf_release_bench -l 0-2 $EAL
+run bench/idle_bench     -l 0-1 $EAL
+run bench/lcore_bench    -l 0-2 $EAL
+run bench/release_jitter
+
+# Whole application against net_null, only if it has been built
+if [ -x ./packet_logger ]; then
+    run bench/rss_scaling.sh 2
+fi
+
+echo "results in $OUT" >&2
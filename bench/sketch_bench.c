@@ -0,0 +1,125 @@
+// sketch_bench.c - accuracy vs memory of the heavy-hitter tracker on
+// synthetic Zipf traffic (s = 1.1 over one million sources), plus update cost.
+//
+// Run: ./bench/sketch_bench   (no EAL, no hugepages needed)
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "bench_common.h"
+#include "../heavy_hitters.h"
+
+#define NUM_KEYS    1000000
+#define NUM_PKTS    10000000
+#define ZIPF_S      1.1
+#define TOP_CHECK   10
+
+static double *cdf;
+static uint32_t *stream;      // rank of each packet's source
+static uint64_t *exact;       // true count per rank
+
+// Ranks map to scattered keys so the sketch never sees sequential values
+static inline uint64_t rank_key(uint32_t rank) {
+    return ((uint64_t)rank + 1) * 0x9E3779B97F4A7C15ULL;
+}
+
+static uint32_t zipf_sample(uint64_t *seed) {
+    double u = (double)(bench_rand(seed) >> 11) / (double)(1ULL << 53);
+    uint32_t lo = 0, hi = NUM_KEYS - 1;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run(uint32_t width, uint32_t k) {
+    struct hh_tracker *t = hh_create(width, k);
+    if (!t) {
+        fprintf(stderr, "hh_create(%u, %u) failed\n", width, k);
+        exit(1);
+    }
+    char cas[32];
+    snprintf(cas, sizeof(cas), "w%u_k%u", width, k);
+
+    double t0 = now_ns();
+    for (uint32_t i = 0; i < NUM_PKTS; i++)
+        hh_update(t, rank_key(stream[i]));
+    bench_report("sketch", cas, "update", (now_ns() - t0) / NUM_PKTS, "ns/pkt");
+    bench_report("sketch", cas, "memory", (double)hh_memory(t) / 1024, "KiB");
+
+    // Zipf ranks are sorted by expected frequency; with 10M packets the
+    // leading ranks are also the true top talkers
+    struct hh_entry top[HH_TOPK];
+    unsigned n = hh_topk(t, top, TOP_CHECK);
+    unsigned hits = 0;
+    double count_err = 0;
+    for (unsigned i = 0; i < n; i++) {
+        for (uint32_t r = 0; r < TOP_CHECK; r++) {
+            if (top[i].key == rank_key(r)) {
+                hits++;
+                count_err += (double)(top[i].count - exact[r]) / exact[r];
+                break;
+            }
+        }
+    }
+    bench_report("sketch", cas, "top10_recall", 100.0 * hits / TOP_CHECK, "%");
+    bench_report("sketch", cas, "top10_count_error", hits ? 100.0 * count_err / hits : 0, "%");
+
+    // Count-min point queries over the head and the tail of the distribution;
+    // the overcount is absolute, so compare it against the e*N/width bound
+    double head_over = 0, tail_over = 0;
+    unsigned tail_n = 0;
+    for (uint32_t r = 0; r < 1000; r++)
+        head_over += (double)(hh_estimate(t, rank_key(r)) - exact[r]);
+    for (uint32_t r = 1000; r < NUM_KEYS; r += 997) {
+        tail_over += (double)(hh_estimate(t, rank_key(r)) - exact[r]);
+        tail_n++;
+    }
+    bench_report("sketch", cas, "cms_overcount_top1000", head_over / 1000, "pkts");
+    bench_report("sketch", cas, "cms_overcount_tail", tail_over / tail_n, "pkts");
+    bench_report("sketch", cas, "cms_bound", M_E * NUM_PKTS / width, "pkts");
+    hh_free(t);
+}
+
+int main(void) {
+    cdf = malloc(NUM_KEYS * sizeof(*cdf));
+    stream = malloc(NUM_PKTS * sizeof(*stream));
+    exact = calloc(NUM_KEYS, sizeof(*exact));
+    if (!cdf || !stream || !exact)
+        return 1;
+
+    double sum = 0;
+    for (uint32_t r = 0; r < NUM_KEYS; r++)
+        cdf[r] = (sum += 1.0 / pow(r + 1, ZIPF_S));
+    for (uint32_t r = 0; r < NUM_KEYS; r++)
+        cdf[r] /= sum;
+
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    for (uint32_t i = 0; i < NUM_PKTS; i++) {
+        stream[i] = zipf_sample(&seed);
+        exact[stream[i]]++;
+    }
+
+    bench_header();
+    bench_report("sketch", "exact", "memory", (double)NUM_KEYS * 16 / 1024, "KiB");
+    for (uint32_t width = 256; width <= 16384; width *= 4)
+        run(width, HH_TOPK);
+    run(HH_CMS_WIDTH, 16);
+    run(HH_CMS_WIDTH, 128);
+
+    free(cdf);
+    free(stream);
+    free(exact);
+    return 0;
+}
@@ -0,0 +1,43 @@
+// prefilter.c - example DETECT prefilter (see bpf_filter.h)
+//
+// Telnet to the usual botnet ports is a THREAT whatever the rule file says,
+// DNS answers are SAFE without going through the ACL, the rest is left to
+// the rules.
+//
+// Build:   make bpf            (clang -O2 -target bpf -c bpf/prefilter.c -o bpf/prefilter.o)
+// Run:     sudo ./packet_logger <EAL args> -- --bpf bpf/prefilter.o
+// Swap:    edit, make bpf, then kill -HUP $(pidof packet_logger)
+//
+// The argument is the mbuf; the loads below compile to LD_ABS/LD_IND, which
+// rte_bpf bounds-checks against the frame (a short frame returns PASS).
+// Offsets assume Ethernet without VLAN tags.
+
+// enum bpf_verdict in bpf_filter.h
+#define PASS   0
+#define THREAT 1
+#define SAFE   2
+
+#define ETH_HLEN      14
+#define ETH_P_IP      0x0800
+#define IPPROTO_TCP   6
+#define IPPROTO_UDP   17
+
+unsigned long long load_byte(void *skb, unsigned long long off) asm("llvm.bpf.load.byte");
+unsigned long long load_half(void *skb, unsigned long long off) asm("llvm.bpf.load.half");
+
+unsigned long long prefilter(void *mbuf) {
+    if (load_half(mbuf, 12) != ETH_P_IP)
+        return PASS;
+    unsigned long long proto = load_byte(mbuf, ETH_HLEN + 9);
+    unsigned long long l4 = ETH_HLEN + ((load_byte(mbuf, ETH_HLEN) & 0x0F) << 2);
+
+    if (proto == IPPROTO_TCP) {
+        unsigned long long dport = load_half(mbuf, l4 + 2);
+        if (dport == 23 || dport == 2323)
+            return THREAT;
+    } else if (proto == IPPROTO_UDP) {
+        if (load_half(mbuf, l4) == 53)
+            return SAFE;
+    }
+    return PASS;
+}
@@ -0,0 +1,223 @@
+// bpf_filter.c
+#include "bpf_filter.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+
+#include <rte_bpf.h>
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_rcu_qsbr.h>
+
+#define BURST_MAX 32
+
+// Owned by one DETECT lcore each
+struct prog_counters {
+    uint64_t packets, threats, safe, cycles;
+} __rte_cache_aligned;
+
+struct bpf_prog {
+    struct rte_bpf *bpf;            // NULL once retired
+    uint64_t (*jit)(void *);        // NULL: interpreter
+    bool jit_compiled;
+    uint32_t generation;
+    char name[BPF_FILTER_NAME_LEN];
+    struct prog_counters *counters; // one per DETECT queue
+};
+
+static struct rte_rcu_qsbr *qsbr;
+static unsigned nb_queues;
+static struct bpf_prog *active;
+// Program n lives in slot n % BPF_FILTER_HISTORY, so a load reuses the slot
+// of the oldest program, retired (and waited for) swaps ago
+static struct bpf_prog history[BPF_FILTER_HISTORY];
+static uint32_t generation;
+static pthread_mutex_t history_lock = PTHREAD_MUTEX_INITIALIZER;   // against get_stats
+
+int bpf_filter_init(unsigned queues) {
+    size_t size = rte_rcu_qsbr_get_memsize(queues);
+    qsbr = rte_zmalloc("BPF_FILTER_QSBR", size, RTE_CACHE_LINE_SIZE);
+    if (!qsbr || rte_rcu_qsbr_init(qsbr, queues) != 0) {
+        syslog(LOG_ERR, "[BPF] Cannot set up the quiescent-state tracker for %u queues", queues);
+        bpf_filter_free();
+        return -1;
+    }
+    for (unsigned i = 0; i < BPF_FILTER_HISTORY; i++) {
+        history[i].counters = rte_zmalloc("BPF_FILTER_COUNTERS", queues * sizeof(struct prog_counters),
+                                          RTE_CACHE_LINE_SIZE);
+        if (!history[i].counters) {
+            syslog(LOG_ERR, "[BPF] Cannot allocate program counters");
+            bpf_filter_free();
+            return -1;
+        }
+    }
+    nb_queues = queues;
+    return 0;
+}
+
+// Wait until no DETECT lcore can hold the program, then destroy it
+static void retire(struct bpf_prog *p) {
+    if (!p)
+        return;
+    rte_rcu_qsbr_synchronize(qsbr, RTE_QSBR_THRID_INVALID);
+    rte_bpf_destroy(p->bpf);
+    p->bpf = NULL;
+    p->jit = NULL;
+}
+
+int bpf_filter_load(const char *spec) {
+    if (!qsbr)
+        return -1;
+
+    char path[PATH_MAX];
+    const char *section = BPF_FILTER_DEFAULT_SEC;
+    snprintf(path, sizeof(path), "%s", spec);
+    char *colon = strrchr(path, ':');
+    if (colon) {
+        *colon = '\0';
+        section = colon + 1;
+    }
+
+    // The program gets the mbuf, so LD_ABS/LD_IND are available and bounds-checked
+    struct rte_bpf_prm prm = {
+        .prog_arg = {
+            .type = RTE_BPF_ARG_PTR_MBUF,
+            .size = sizeof(struct rte_mbuf),
+            .buf_size = RTE_MBUF_DEFAULT_DATAROOM,
+        },
+    };
+    struct rte_bpf *bpf = rte_bpf_elf_load(&prm, path, section);
+    if (!bpf) {
+        syslog(LOG_ERR, "[BPF] Cannot load section %s of %s: %s", section, path, rte_strerror(rte_errno));
+        return -1;
+    }
+    struct rte_bpf_jit jit;
+    memset(&jit, 0, sizeof(jit));
+    if (rte_bpf_get_jit(bpf, &jit) != 0)
+        jit.func = NULL;
+
+    pthread_mutex_lock(&history_lock);
+    struct bpf_prog *old = active;
+    struct bpf_prog *p = &history[(generation + 1) % BPF_FILTER_HISTORY];
+    p->bpf = bpf;
+    p->jit = jit.func;
+    p->jit_compiled = jit.func != NULL;
+    p->generation = ++generation;
+    // Quotes would break the metrics labels
+    snprintf(p->name, sizeof(p->name), "%s:%s", path, section);
+    for (char *c = p->name; *c; c++)
+        if (*c == '"' || *c == '\\')
+            *c = '_';
+    memset(p->counters, 0, nb_queues * sizeof(p->counters[0]));
+    __atomic_store_n(&active, p, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&history_lock);
+
+    retire(old);
+    syslog(LOG_INFO, "[BPF] %s active as generation %u (%s, %zu bytes of code)", p->name, p->generation,
+           p->jit ? "JIT" : "interpreter", jit.sz);
+    return 0;
+}
+
+void bpf_filter_unload(void) {
+    if (!qsbr)
+        return;
+    pthread_mutex_lock(&history_lock);
+    struct bpf_prog *old = active;
+    __atomic_store_n(&active, NULL, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&history_lock);
+    retire(old);
+}
+
+void bpf_filter_free(void) {
+    bpf_filter_unload();
+    for (unsigned i = 0; i < BPF_FILTER_HISTORY; i++) {
+        rte_free(history[i].counters);
+        history[i].counters = NULL;
+    }
+    rte_free(qsbr);
+    qsbr = NULL;
+}
+
+void bpf_filter_online(uint16_t queue) {
+    if (!qsbr)
+        return;
+    rte_rcu_qsbr_thread_register(qsbr, queue);
+    rte_rcu_qsbr_thread_online(qsbr, queue);
+}
+
+void bpf_filter_offline(uint16_t queue) {
+    if (!qsbr)
+        return;
+    rte_rcu_qsbr_thread_offline(qsbr, queue);
+    rte_rcu_qsbr_thread_unregister(qsbr, queue);
+}
+
+void bpf_filter_quiescent(uint16_t queue) {
+    if (qsbr)
+        rte_rcu_qsbr_quiescent(qsbr, queue);
+}
+
+bool bpf_filter_run(uint16_t queue, struct rte_mbuf *const pkts[], unsigned n,
+                    uint32_t *threat, uint32_t *safe) {
+    const struct bpf_prog *p = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+    if (!p)
+        return false;
+
+    uint64_t rc[BURST_MAX];
+    uint64_t start = rte_rdtsc();
+    if (p->jit) {
+        for (unsigned i = 0; i < n; i++)
+            rc[i] = p->jit(pkts[i]);
+    } else {
+        rte_bpf_exec_burst(p->bpf, (void **)(uintptr_t)pkts, rc, n);
+    }
+    uint64_t cycles = rte_rdtsc() - start;
+
+    uint32_t t = 0, s = 0;
+    for (unsigned i = 0; i < n; i++) {
+        t |= (uint32_t)(rc[i] == BPF_VERDICT_THREAT) << i;
+        s |= (uint32_t)(rc[i] == BPF_VERDICT_SAFE) << i;
+    }
+    struct prog_counters *c = &p->counters[queue];
+    c->packets += n;
+    c->threats += __builtin_popcount(t);
+    c->safe += __builtin_popcount(s);
+    c->cycles += cycles;
+    *threat = t;
+    *safe = s;
+    return true;
+}
+
+unsigned bpf_filter_get_stats(struct bpf_filter_stats *out, unsigned max) {
+    double ns_per_cycle = 1e9 / rte_get_tsc_hz();
+    unsigned count = 0;
+    if (!qsbr)
+        return 0;
+
+    pthread_mutex_lock(&history_lock);
+    uint32_t oldest = generation > BPF_FILTER_HISTORY ? generation - BPF_FILTER_HISTORY + 1 : 1;
+    for (uint32_t gen = generation; gen >= oldest && gen > 0 && count < max; gen--) {
+        const struct bpf_prog *p = &history[gen % BPF_FILTER_HISTORY];
+        struct bpf_filter_stats *s = &out[count++];
+        memset(s, 0, sizeof(*s));
+        snprintf(s->name, sizeof(s->name), "%s", p->name);
+        s->generation = p->generation;
+        s->jit = p->jit_compiled;
+        s->active = p == active;
+        uint64_t cycles = 0;
+        for (unsigned q = 0; q < nb_queues; q++) {
+            s->packets += p->counters[q].packets;
+            s->threats += p->counters[q].threats;
+            s->safe += p->counters[q].safe;
+            cycles += p->counters[q].cycles;
+        }
+        s->ns_per_packet = s->packets ? cycles * ns_per_cycle / s->packets : 0;
+    }
+    pthread_mutex_unlock(&history_lock);
+    return count;
+}
@@ -0,0 +1,83 @@
+#ifndef BPF_FILTER_H_
+#define BPF_FILTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rte_mbuf;
+
+// Programmable prefilter for DETECT. A user-supplied eBPF program (an ELF
+// object built with clang -target bpf, see bpf/prefilter.c) is loaded and
+// verified by rte_bpf, JIT-compiled where DPDK has a JIT (x86-64, arm64) and
+// run by the interpreter otherwise. DETECT runs it over every burst before
+// the quick rules and the ACL. The program gets the mbuf (RTE_BPF_ARG_PTR_MBUF),
+// so it can read packet bytes with the bounds-checked LD_ABS/LD_IND loads;
+// a load past the end of the frame ends the program with BPF_VERDICT_PASS.
+// Its return value is the verdict:
+//   BPF_VERDICT_PASS    no opinion, the built-in rules decide
+//   BPF_VERDICT_THREAT  THREAT, the rules are skipped
+//   BPF_VERDICT_SAFE    SAFE (allow-list), the rules are skipped
+// Flow-rate alerts still apply to every IPv4 packet either way.
+//
+// bpf_filter_load() swaps programs while the pipeline runs: the new one is
+// verified and compiled first, published with one pointer store, and the
+// old one is only destroyed once every DETECT lcore has gone through a
+// quiescent state (rte_rcu_qsbr), i.e. has finished the burst it was in.
+
+enum bpf_verdict {
+    BPF_VERDICT_PASS = 0,
+    BPF_VERDICT_THREAT = 1,
+    BPF_VERDICT_SAFE = 2,
+};
+
+#define BPF_FILTER_RULE_ID     UINT32_MAX  // rule_id of packets the prefilter decided
+#define BPF_FILTER_HISTORY     8           // programs whose statistics outlive a swap
+#define BPF_FILTER_NAME_LEN    96
+#define BPF_FILTER_DEFAULT_SEC ".text"
+
+struct bpf_filter_stats {
+    char name[BPF_FILTER_NAME_LEN];   // FILE:SECTION
+    uint32_t generation;              // 1 for the first program, +1 per swap
+    bool jit;                         // false: interpreter
+    bool active;                      // false once swapped out
+    uint64_t packets;
+    uint64_t threats;
+    uint64_t safe;
+    double ns_per_packet;             // execution time, burst overhead included
+};
+
+// Before the DETECT lcores start: room for nb_queues of them
+int bpf_filter_init(unsigned nb_queues);
+
+// Load "FILE[:SECTION]" (default section BPF_FILTER_DEFAULT_SEC) and make it
+// the active program. Blocks until no DETECT lcore can still be running the
+// previous one. On failure the previous program stays active. Called from
+// one control thread at a time.
+int bpf_filter_load(const char *spec);
+// Deactivate the current program, same grace period as a swap
+void bpf_filter_unload(void);
+void bpf_filter_free(void);
+
+// DETECT lcore side. Between online and offline the lcore must report a
+// quiescent state regularly, or swaps wait for it.
+void bpf_filter_online(uint16_t queue);
+void bpf_filter_offline(uint16_t queue);
+void bpf_filter_quiescent(uint16_t queue);
+
+// Run the active program over n (<= 32) packets. Returns false when no
+// program is loaded; otherwise sets the lanes judged THREAT and SAFE.
+bool bpf_filter_run(uint16_t queue, struct rte_mbuf *const pkts[], unsigned n,
+                    uint32_t *threat, uint32_t *safe);
+
+// Active program first, then the ones it replaced, newest first
+unsigned bpf_filter_get_stats(struct bpf_filter_stats *out, unsigned max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // BPF_FILTER_H_
@@ -0,0 +1,248 @@
+// burst_classify.c
+#define _GNU_SOURCE
+#include "burst_classify.h"
+#include "rules.h"
+
+#include <string.h>
+#include <syslog.h>
+
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+#include <rte_mbuf.h>
+#include <rte_cpuflags.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BURST_HAVE_X86 1
+#endif
+
+typedef uint32_t (*classify_fn)(const struct burst_fields *f, uint32_t lanes,
+                                uint32_t *decided, uint32_t *match);
+
+static struct quick_rule quick[RULES_QUICK_MAX];
+static unsigned num_quick = 0;
+static classify_fn classify_impl;
+
+static inline void assign_matches(uint32_t bits, uint32_t rule_id, uint32_t *match) {
+    while (bits) {
+        unsigned i = __builtin_ctz(bits);
+        match[i] = rule_id;
+        bits &= bits - 1;
+    }
+}
+
+static uint32_t classify_scalar(const struct burst_fields *f, uint32_t lanes,
+                                uint32_t *decided, uint32_t *match) {
+    uint32_t ipv4 = 0, done = 0;
+
+    for (unsigned i = 0; i < CLASSIFY_BURST_MAX; i++) {
+        if (!(lanes & (1u << i)) || f->ether_type[i] != RTE_ETHER_TYPE_IPV4)
+            continue;
+        ipv4 |= 1u << i;
+        for (unsigned r = 0; r < num_quick; r++) {
+            const struct quick_rule *q = &quick[r];
+            if ((f->proto[i] & q->proto_mask) == q->proto &&
+                f->dst_port[i] >= q->dport_lo && f->dst_port[i] <= q->dport_hi) {
+                match[i] = q->rule_id;
+                done |= 1u << i;
+                break;
+            }
+        }
+    }
+    *decided = done;
+    return ipv4;
+}
+
+#ifdef BURST_HAVE_X86
+
+// 16 lanes per call: compare results of two 8x16-bit halves narrowed to bytes
+__attribute__((target("sse4.2")))
+static inline uint32_t sse_mask16(__m128i lo, __m128i hi) {
+    return (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(lo, hi));
+}
+
+__attribute__((target("sse4.2")))
+static inline __m128i sse_in_range16(__m128i v, __m128i lo, __m128i hi) {
+    __m128i ge = _mm_cmpeq_epi16(_mm_max_epu16(v, lo), v);
+    __m128i le = _mm_cmpeq_epi16(_mm_min_epu16(v, hi), v);
+    return _mm_and_si128(ge, le);
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t classify_sse42(const struct burst_fields *f, uint32_t lanes,
+                               uint32_t *decided, uint32_t *match) {
+    const __m128i ipv4_type = _mm_set1_epi16(RTE_ETHER_TYPE_IPV4);
+    uint32_t ipv4 = 0, done = 0;
+
+    for (unsigned base = 0; base < CLASSIFY_BURST_MAX; base += 16) {
+        __m128i et0 = _mm_load_si128((const __m128i *)&f->ether_type[base]);
+        __m128i et1 = _mm_load_si128((const __m128i *)&f->ether_type[base + 8]);
+        __m128i dp0 = _mm_load_si128((const __m128i *)&f->dst_port[base]);
+        __m128i dp1 = _mm_load_si128((const __m128i *)&f->dst_port[base + 8]);
+        __m128i proto = _mm_load_si128((const __m128i *)&f->proto[base]);
+
+        uint32_t v4 = sse_mask16(_mm_cmpeq_epi16(et0, ipv4_type),
+                                 _mm_cmpeq_epi16(et1, ipv4_type)) & (lanes >> base);
+        uint32_t open = v4;
+
+        for (unsigned r = 0; r < num_quick && open; r++) {
+            const struct quick_rule *q = &quick[r];
+            __m128i lo = _mm_set1_epi16((short)q->dport_lo);
+            __m128i hi = _mm_set1_epi16((short)q->dport_hi);
+            __m128i pm = _mm_cmpeq_epi8(_mm_and_si128(proto, _mm_set1_epi8((char)q->proto_mask)),
+                                        _mm_set1_epi8((char)q->proto));
+            uint32_t hit = sse_mask16(sse_in_range16(dp0, lo, hi), sse_in_range16(dp1, lo, hi)) &
+                           (uint32_t)_mm_movemask_epi8(pm) & open;
+            assign_matches(hit << base, q->rule_id, match);
+            open &= ~hit;
+        }
+        ipv4 |= v4 << base;
+        done |= (v4 & ~open) << base;
+    }
+    *decided = done;
+    return ipv4;
+}
+
+// 32 lanes at once; packs works per 128-bit lane, so fix the order afterwards
+__attribute__((target("avx2")))
+static inline uint32_t avx2_mask32(__m256i lo, __m256i hi) {
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+    return (uint32_t)_mm256_movemask_epi8(packed);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_in_range16(__m256i v, __m256i lo, __m256i hi) {
+    __m256i ge = _mm256_cmpeq_epi16(_mm256_max_epu16(v, lo), v);
+    __m256i le = _mm256_cmpeq_epi16(_mm256_min_epu16(v, hi), v);
+    return _mm256_and_si256(ge, le);
+}
+
+__attribute__((target("avx2")))
+static uint32_t classify_avx2(const struct burst_fields *f, uint32_t lanes,
+                              uint32_t *decided, uint32_t *match) {
+    const __m256i ipv4_type = _mm256_set1_epi16(RTE_ETHER_TYPE_IPV4);
+    __m256i et0 = _mm256_load_si256((const __m256i *)&f->ether_type[0]);
+    __m256i et1 = _mm256_load_si256((const __m256i *)&f->ether_type[16]);
+    __m256i dp0 = _mm256_load_si256((const __m256i *)&f->dst_port[0]);
+    __m256i dp1 = _mm256_load_si256((const __m256i *)&f->dst_port[16]);
+    __m256i proto = _mm256_load_si256((const __m256i *)&f->proto[0]);
+
+    uint32_t ipv4 = avx2_mask32(_mm256_cmpeq_epi16(et0, ipv4_type),
+                                _mm256_cmpeq_epi16(et1, ipv4_type)) & lanes;
+    uint32_t open = ipv4;
+
+    for (unsigned r = 0; r < num_quick && open; r++) {
+        const struct quick_rule *q = &quick[r];
+        __m256i lo = _mm256_set1_epi16((short)q->dport_lo);
+        __m256i hi = _mm256_set1_epi16((short)q->dport_hi);
+        __m256i pm = _mm256_cmpeq_epi8(_mm256_and_si256(proto, _mm256_set1_epi8((char)q->proto_mask)),
+                                       _mm256_set1_epi8((char)q->proto));
+        uint32_t hit = avx2_mask32(avx2_in_range16(dp0, lo, hi), avx2_in_range16(dp1, lo, hi)) &
+                       (uint32_t)_mm256_movemask_epi8(pm) & open;
+        assign_matches(hit, q->rule_id, match);
+        open &= ~hit;
+    }
+    *decided = ipv4 & ~open;
+    return ipv4;
+}
+
+#endif  // BURST_HAVE_X86
+
+const char *burst_impl_name(enum burst_impl impl) {
+    switch (impl) {
+    case BURST_IMPL_SCALAR: return "scalar";
+    case BURST_IMPL_SSE42:  return "sse4.2";
+    case BURST_IMPL_AVX2:   return "avx2";
+    default:                return "auto";
+    }
+}
+
+static enum burst_impl best_impl(void) {
+#ifdef BURST_HAVE_X86
+    if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX2) > 0)
+        return BURST_IMPL_AVX2;
+    if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_SSE4_2) > 0)
+        return BURST_IMPL_SSE42;
+#endif
+    return BURST_IMPL_SCALAR;
+}
+
+enum burst_impl burst_classify_init(enum burst_impl impl) {
+    enum burst_impl best = best_impl();
+
+    // Never select more than the CPU can run
+    if (impl == BURST_IMPL_AUTO || impl > best)
+        impl = best;
+
+    switch (impl) {
+#ifdef BURST_HAVE_X86
+    case BURST_IMPL_AVX2:  classify_impl = classify_avx2;  break;
+    case BURST_IMPL_SSE42: classify_impl = classify_sse42; break;
+#endif
+    default:
+        impl = BURST_IMPL_SCALAR;
+        classify_impl = classify_scalar;
+        break;
+    }
+
+    // Wildcard proto is stored as value 0 / mask 0, so (proto & mask) == value holds
+    num_quick = rules_quick_prefix(quick, RULES_QUICK_MAX);
+    syslog(LOG_INFO, "[CLASSIFY] %s burst classifier, %u quick rules", burst_impl_name(impl), num_quick);
+    return impl;
+}
+
+void burst_gather(struct rte_mbuf *const pkts[], unsigned n, struct burst_fields *f) {
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        const struct rte_ether_hdr *eth = rte_pktmbuf_mtod(pkts[i], const struct rte_ether_hdr *);
+        uint16_t type = rte_be_to_cpu_16(eth->ether_type);
+        uint8_t proto = 0, flags = 0;
+        uint16_t sport = 0, dport = 0;
+        uint32_t src = 0, dst = 0;
+        uint64_t mac = 0;
+
+        memcpy(&mac, &eth->src_addr, RTE_ETHER_ADDR_LEN);
+
+        if (type == RTE_ETHER_TYPE_IPV4) {
+            const struct rte_ipv4_hdr *ip = (const struct rte_ipv4_hdr *)(eth + 1);
+            const uint8_t *l4 = (const uint8_t *)ip +
+                                (ip->version_ihl & RTE_IPV4_HDR_IHL_MASK) * RTE_IPV4_IHL_MULTIPLIER;
+            proto = ip->next_proto_id;
+            src = ip->src_addr;
+            dst = ip->dst_addr;
+            if (proto == IPPROTO_TCP || proto == IPPROTO_UDP) {
+                // TCP and UDP both start with src/dst port
+                const struct rte_udp_hdr *ports = (const struct rte_udp_hdr *)l4;
+                sport = rte_be_to_cpu_16(ports->src_port);
+                dport = rte_be_to_cpu_16(ports->dst_port);
+                if (proto == IPPROTO_TCP)
+                    flags = ((const struct rte_tcp_hdr *)l4)->tcp_flags;
+            }
+        }
+        f->ether_type[i] = type;
+        f->proto[i] = proto;
+        f->src_port[i] = sport;
+        f->dst_port[i] = dport;
+        f->src_ip[i] = src;
+        f->dst_ip[i] = dst;
+        f->pkt_len[i] = (uint16_t)pkts[i]->pkt_len;
+        f->tcp_flags[i] = flags;
+        f->src_mac[i] = mac;
+    }
+    // Only the predicate lanes need clearing, the rest is masked by n
+    for (; i < CLASSIFY_BURST_MAX; i++) {
+        f->ether_type[i] = 0;
+        f->proto[i] = 0;
+        f->src_port[i] = 0;
+        f->dst_port[i] = 0;
+    }
+}
+
+uint32_t burst_classify(const struct burst_fields *f, unsigned n,
+                        uint32_t *decided, uint32_t *match) {
+    uint32_t lanes = n >= CLASSIFY_BURST_MAX ? UINT32_MAX : (1u << n) - 1;
+    return classify_impl(f, lanes, decided, match);
+}
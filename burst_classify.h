@@ -0,0 +1,55 @@
+#ifndef BURST_CLASSIFY_H_
+#define BURST_CLASSIFY_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rte_mbuf;
+
+#define CLASSIFY_BURST_MAX 32
+
+enum burst_impl {
+    BURST_IMPL_SCALAR = 0,
+    BURST_IMPL_SSE42,
+    BURST_IMPL_AVX2,
+    BURST_IMPL_AUTO,
+};
+
+// Header fields of one burst in structure-of-arrays form (host byte order),
+// so the predicates can be evaluated 16/32 lanes at a time. Lanes past the
+// burst length are zeroed and never match.
+struct burst_fields {
+    uint16_t ether_type[CLASSIFY_BURST_MAX] __attribute__((aligned(32)));
+    uint16_t src_port[CLASSIFY_BURST_MAX] __attribute__((aligned(32)));
+    uint16_t dst_port[CLASSIFY_BURST_MAX] __attribute__((aligned(32)));
+    uint8_t  proto[CLASSIFY_BURST_MAX] __attribute__((aligned(32)));
+    // Not used by the predicates; gathered in the same pass for the flow table
+    uint32_t src_ip[CLASSIFY_BURST_MAX];     // network byte order
+    uint32_t dst_ip[CLASSIFY_BURST_MAX];     // network byte order
+    uint16_t pkt_len[CLASSIFY_BURST_MAX];
+    uint8_t  tcp_flags[CLASSIFY_BURST_MAX];
+    uint64_t src_mac[CLASSIFY_BURST_MAX];    // 48-bit address in the low bytes
+};
+
+// Pick an implementation (BURST_IMPL_AUTO = best the CPU supports) and load
+// the quick-rule prefix from the current rule table. Call after rules_load().
+enum burst_impl burst_classify_init(enum burst_impl impl);
+const char *burst_impl_name(enum burst_impl impl);
+
+// Gather ethertype, IP protocol and L4 ports of n (<= 32) packets.
+void burst_gather(struct rte_mbuf *const pkts[], unsigned n, struct burst_fields *f);
+
+// Evaluate the quick rules over a gathered burst. Returns the mask of IPv4
+// lanes; *decided gets the lanes resolved by a quick rule, with the rule id
+// stored in match[i]. IPv4 lanes outside *decided still need the ACL.
+uint32_t burst_classify(const struct burst_fields *f, unsigned n,
+                        uint32_t *decided, uint32_t *match);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // BURST_CLASSIFY_H_
@@ -0,0 +1,207 @@
+// dashboard.c
+#define _GNU_SOURCE
+#include "dashboard.h"
+
+#include <inttypes.h>
+#include <ncurses.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert((DASHBOARD_RING_SIZE & (DASHBOARD_RING_SIZE - 1)) == 0, "ring size must be a power of two");
+_Static_assert(DASHBOARD_RING_SIZE >= 2 * DASHBOARD_HISTORY, "reader needs slack behind the writer");
+
+#define POLL_MS 20      // how often the thread checks for stop and keys
+
+struct slot {
+    uint64_t seq;       // index + 1 of the record in the slot, 0 while it is written
+    struct log_record rec;
+};
+
+static struct slot ring[DASHBOARD_RING_SIZE];
+static uint64_t ring_head;      // records ever pushed; written by the producer only
+
+static struct dashboard_source source;
+static FILE *screen_out;
+static pthread_t ui_thread;
+static volatile bool ui_running;
+static struct dashboard_stats stats;
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void dashboard_push(const struct log_record *recs, unsigned n) {
+    uint64_t head = ring_head;
+    unsigned first = n > DASHBOARD_HISTORY ? n - DASHBOARD_HISTORY : 0;
+
+    for (unsigned i = first; i < n; i++, head++) {
+        struct slot *s = &ring[head & (DASHBOARD_RING_SIZE - 1)];
+        __atomic_store_n(&s->seq, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        s->rec = recs[i];
+        __atomic_store_n(&s->seq, head + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&ring_head, head, __ATOMIC_RELEASE);
+    stats.pushed += n - first;
+}
+
+// Newest records, oldest first; returns how many were copied intact
+static unsigned snapshot(struct log_record *out, unsigned max) {
+    uint64_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    uint64_t from = head > max ? head - max : 0;
+    unsigned n = 0;
+
+    for (uint64_t i = from; i < head; i++) {
+        const struct slot *s = &ring[i & (DASHBOARD_RING_SIZE - 1)];
+        uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        out[n] = s->rec;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq != i + 1 || __atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq) {
+            stats.torn++;   // the producer lapped us on this slot
+            continue;
+        }
+        n++;
+    }
+    return n;
+}
+
+static void draw_rates(const struct dashboard_counters *prev, const struct dashboard_counters *cur,
+                       double seconds) {
+    double rx = (cur->rx_packets - prev->rx_packets) / seconds;
+    double threats = (cur->threats - prev->threats) / seconds;
+    double drops = (cur->drops - prev->drops) / seconds;
+    double logged = (cur->logged - prev->logged) / seconds;
+    double offered = rx + drops;
+
+    mvprintw(0, 0, "RX %10.0f pps   threats %8.0f/s   drops %8.0f/s (%5.2f%%)   logged %10.0f pps",
+             rx, threats, drops, offered > 0 ? 100.0 * drops / offered : 0.0, logged);
+    mvprintw(1, 0, "total: %" PRIu64 " pkts, %" PRIu64 " threats, %" PRIu64 " drops",
+             cur->rx_packets, cur->threats, cur->drops);
+}
+
+static int draw_history(int row, int max_rows) {
+    static struct log_record hist[DASHBOARD_HISTORY];
+    unsigned n = snapshot(hist, DASHBOARD_HISTORY);
+    unsigned first = n > (unsigned)max_rows ? n - max_rows : 0;
+
+    mvprintw(row++, 0, "Timestamp              SourceMAC           DestinationMAC      Threat   DetectDelay   LogDelay");
+    for (unsigned i = first; i < n; i++) {
+        const struct log_record *rec = &hist[i];
+        char timestamp[32];
+        time_t sec = rec->wall_ns / 1000000000ULL;
+        struct tm tm_info;
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime_r(&sec, &tm_info));
+        const uint8_t *s = rec->src_mac, *d = rec->dst_mac;
+
+        if (rec->verdict == LOG_VERDICT_SUMMARY) {
+            mvprintw(row++, 0, "%s  SAFE traffic summarized under overload: %" PRIu64 " pkts, %" PRIu64 " bytes",
+                     timestamp, rec->summary_packets, rec->summary_bytes);
+            continue;
+        }
+        bool threat = rec->verdict == LOG_VERDICT_THREAT;
+        attron(COLOR_PAIR(threat ? 1 : 2));
+        mvprintw(row++, 0, "%s  %02X:%02X:%02X:%02X:%02X:%02X -> %02X:%02X:%02X:%02X:%02X:%02X     %-7s  %9.1fus  %8.1fus",
+                 timestamp, s[0], s[1], s[2], s[3], s[4], s[5], d[0], d[1], d[2], d[3], d[4], d[5],
+                 threat ? "THREAT" : rec->verdict == LOG_VERDICT_SAFE ? "SAFE" : "UNKNOWN",
+                 rec->detect_delay_ns / 1e3, rec->log_delay_ns / 1e3);
+        attroff(COLOR_PAIR(threat ? 1 : 2));
+    }
+    return row;
+}
+
+static void *dashboard_main(void *arg) {
+    (void)arg;
+    static char footer[DASHBOARD_FOOTER_MAX];
+    SCREEN *screen = newterm(NULL, screen_out ? screen_out : stdout, stdin);
+    if (!screen) {
+        syslog(LOG_ERR, "[DASHBOARD] Cannot initialize the terminal");
+        return NULL;
+    }
+    set_term(screen);
+    cbreak();
+    noecho();
+    curs_set(FALSE);
+    nodelay(stdscr, TRUE);
+    if (has_colors()) {
+        start_color();
+        init_pair(1, COLOR_RED, COLOR_BLACK);
+        init_pair(2, COLOR_GREEN, COLOR_BLACK);
+    }
+    syslog(LOG_INFO, "[DASHBOARD] Thread running on core %d", sched_getcpu());
+
+    struct dashboard_counters prev = {0}, cur;
+    if (source.counters)
+        source.counters(&prev);
+    uint64_t prev_ms = monotonic_ms(), next_refresh = prev_ms + DASHBOARD_REFRESH_MS;
+
+    while (ui_running) {
+        usleep(POLL_MS * 1000);
+        uint64_t now = monotonic_ms();
+        if (now < next_refresh)
+            continue;
+        next_refresh = now + DASHBOARD_REFRESH_MS;
+
+        memset(&cur, 0, sizeof(cur));
+        if (source.counters)
+            source.counters(&cur);
+
+        erase();
+        draw_rates(&prev, &cur, (now - prev_ms) / 1000.0);
+        int footer_rows = 0;
+        if (source.footer && source.footer(footer, sizeof(footer)) > 0)
+            for (const char *p = footer; *p; p++)
+                footer_rows += *p == '\n';
+        int rows = LINES - 4 - footer_rows - 1;
+        int row = draw_history(3, rows > 0 ? rows : 0);
+        if (footer_rows)
+            mvprintw(row + 1, 0, "%s", footer);
+        refresh();
+
+        prev = cur;
+        prev_ms = now;
+        stats.refreshes++;
+    }
+
+    endwin();
+    delscreen(screen);
+    return NULL;
+}
+
+int dashboard_start(const struct dashboard_source *src, int core, FILE *out) {
+    source = *src;
+    screen_out = out;
+
+    // Plain SCHED_OTHER thread: it must never compete with the pipeline cores
+    ui_running = true;
+    if (pthread_create(&ui_thread, NULL, dashboard_main, NULL) != 0) {
+        syslog(LOG_ERR, "[DASHBOARD] Failed to create dashboard thread");
+        ui_running = false;
+        return -1;
+    }
+    pthread_setname_np(ui_thread, "dashboard");
+    if (core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(ui_thread, sizeof(set), &set);
+    }
+    return 0;
+}
+
+void dashboard_stop(void) {
+    if (!ui_running)
+        return;
+    ui_running = false;
+    pthread_join(ui_thread, NULL);
+}
+
+void dashboard_get_stats(struct dashboard_stats *out) {
+    *out = stats;
+}
@@ -0,0 +1,65 @@
+#ifndef DASHBOARD_H_
+#define DASHBOARD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "log_writer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ncurses dashboard on its own SCHED_OTHER thread. The logger service only
+// copies the newest records of each burst into an overwriting
+// single-producer ring: no lock, no full condition, the oldest entry simply
+// goes. Every DASHBOARD_REFRESH_MS the dashboard thread snapshots the newest
+// DASHBOARD_HISTORY entries (each slot carries a sequence number, so a slot
+// rewritten mid-copy is detected and skipped) and redraws, so no screen work
+// ever runs on the real-time core. Above the history it shows rates from
+// counters it samples itself at refresh time.
+
+#define DASHBOARD_RING_SIZE  256      // records, power of two; slack for the reader
+#define DASHBOARD_HISTORY    50       // rows on the screen
+#define DASHBOARD_REFRESH_MS 250
+#define DASHBOARD_FOOTER_MAX 2048
+
+// Cumulative counters, sampled at each refresh; rates are their deltas
+struct dashboard_counters {
+    uint64_t rx_packets;
+    uint64_t threats;
+    uint64_t drops;         // anywhere in the pipeline, NIC included
+    uint64_t logged;
+};
+
+struct dashboard_source {
+    void (*counters)(struct dashboard_counters *c);
+    // Free-form lines under the history (latency, top talkers); may be NULL
+    int (*footer)(char *buf, size_t len);
+};
+
+struct dashboard_stats {
+    uint64_t pushed;        // records written to the ring
+    uint64_t torn;          // slots overwritten while the screen copied them
+    uint64_t refreshes;
+};
+
+// Start the thread pinned to core (-1 = any), drawing on out (NULL = the
+// terminal on stdout)
+int dashboard_start(const struct dashboard_source *src, int core, FILE *out);
+// Join the thread and restore the terminal
+void dashboard_stop(void);
+
+// Single producer (the logger); never blocks. Only the last
+// DASHBOARD_HISTORY records of a burst are written, the rest could never
+// reach the screen.
+void dashboard_push(const struct log_record *recs, unsigned n);
+
+void dashboard_get_stats(struct dashboard_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DASHBOARD_H_
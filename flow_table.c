@@ -0,0 +1,294 @@
+// flow_table.c
+#define _GNU_SOURCE
+#include "flow_table.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <syslog.h>
+
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_malloc.h>
+#include <rte_hash_crc.h>
+#include <rte_tcp.h>
+
+#define ENTRY_EMPTY    0
+#define ENTRY_USED     1
+#define ENTRY_DELETED  2
+
+// Aggregate pseudo-flows share the table with real flows, told apart by key.pad[0]
+#define KIND_FLOW      0
+#define KIND_HOST_PAIR 1   // src -> dst, counts new flows (port scans)
+#define KIND_SERVICE   2   // * -> dst:dport, counts SYNs (spoofed SYN floods)
+
+#define WHEEL_NIL UINT32_MAX
+
+// Exactly one cache line per flow
+struct flow_entry {
+    struct flow_key key;
+    uint8_t  state;
+    uint8_t  alerted;         // alert bits already counted for this flow
+    uint16_t reserved;
+    uint32_t wheel_next;      // next entry in the same timer wheel slot
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t last_seen;       // TSC
+    uint32_t window_id;       // rate window the win_* counters belong to
+    uint32_t win_pkts;
+    uint32_t prev_pkts;       // previous (complete) window
+    uint16_t win_syns;
+    uint16_t prev_syns;
+} __rte_cache_aligned;
+
+_Static_assert(sizeof(struct flow_entry) == RTE_CACHE_LINE_SIZE, "flow entry must fill one cache line");
+_Static_assert(sizeof(struct flow_key) == 16, "flow key is compared as two 64-bit words");
+
+struct flow_table {
+    struct flow_entry *entries;
+    uint32_t mask;
+    struct flow_limits limits;
+    uint64_t window_cycles;   // 1 s rate windows
+    uint64_t tick_cycles;     // timer wheel tick, 1 s
+    uint64_t timeout_cycles;
+    uint64_t timeout_ticks;
+    uint64_t next_tick;       // first wheel tick not yet expired
+    uint32_t age_list;        // detached slot still being walked
+    uint32_t wheel[FLOW_WHEEL_SLOTS];
+    struct flow_table_stats stats;
+};
+
+static inline uint32_t flow_hash(const struct flow_key *k) {
+    const uint64_t *w = (const uint64_t *)k;
+    return rte_hash_crc_8byte(w[1], rte_hash_crc_8byte(w[0], 0x9e3779b9));
+}
+
+static inline bool key_equal(const struct flow_key *a, const struct flow_key *b) {
+    const uint64_t *x = (const uint64_t *)a, *y = (const uint64_t *)b;
+    return x[0] == y[0] && x[1] == y[1];
+}
+
+static inline void wheel_insert(struct flow_table *t, uint32_t idx, uint64_t tick) {
+    if (tick < t->next_tick)
+        tick = t->next_tick;
+    uint32_t slot = tick % FLOW_WHEEL_SLOTS;
+    t->entries[idx].wheel_next = t->wheel[slot];
+    t->wheel[slot] = idx;
+}
+
+struct flow_table *flow_table_create(const char *name, uint32_t entries,
+                                     const struct flow_limits *limits, int socket_id) {
+    if (!rte_is_power_of_2(entries)) {
+        syslog(LOG_ERR, "[FLOW] Table size %u is not a power of two", entries);
+        return NULL;
+    }
+
+    struct flow_table *t = rte_zmalloc_socket(name, sizeof(*t), RTE_CACHE_LINE_SIZE, socket_id);
+    if (!t)
+        return NULL;
+    t->entries = rte_zmalloc_socket(name, (size_t)entries * sizeof(struct flow_entry),
+                                    RTE_CACHE_LINE_SIZE, socket_id);
+    if (!t->entries) {
+        rte_free(t);
+        syslog(LOG_ERR, "[FLOW] Cannot allocate %u flow entries", entries);
+        return NULL;
+    }
+
+    uint64_t hz = rte_get_tsc_hz();
+    t->mask = entries - 1;
+    t->limits = *limits;
+    t->window_cycles = hz;
+    t->tick_cycles = hz;
+    t->timeout_ticks = RTE_MAX(1u, RTE_MIN(limits->idle_timeout_s, FLOW_WHEEL_SLOTS - 1u));
+    t->timeout_cycles = t->timeout_ticks * hz;
+    t->next_tick = rte_get_tsc_cycles() / t->tick_cycles;
+    t->age_list = WHEEL_NIL;
+    for (unsigned i = 0; i < FLOW_WHEEL_SLOTS; i++)
+        t->wheel[i] = WHEEL_NIL;
+    t->stats.capacity = entries;
+    return t;
+}
+
+void flow_table_free(struct flow_table *t) {
+    if (!t)
+        return;
+    rte_free(t->entries);
+    rte_free(t);
+}
+
+// Linear probing over at most FLOW_MAX_PROBE slots. Deleted slots are reused
+// for inserts, so a full probe window only fails when it holds live flows.
+static struct flow_entry *lookup_or_insert(struct flow_table *t, const struct flow_key *key,
+                                           uint64_t now, bool *is_new) {
+    uint32_t idx = flow_hash(key) & t->mask;
+    struct flow_entry *slot = NULL;
+    uint32_t slot_idx = 0;
+
+    *is_new = false;
+    for (unsigned p = 0; p < FLOW_MAX_PROBE; p++) {
+        uint32_t i = (idx + p) & t->mask;
+        struct flow_entry *e = &t->entries[i];
+
+        if (e->state == ENTRY_USED) {
+            if (key_equal(&e->key, key))
+                return e;
+            continue;
+        }
+        if (!slot) {
+            slot = e;
+            slot_idx = i;
+        }
+        if (e->state == ENTRY_EMPTY)
+            break;
+    }
+    if (!slot) {
+        t->stats.insert_failures++;
+        return NULL;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->key = *key;
+    slot->state = ENTRY_USED;
+    slot->last_seen = now;
+    slot->window_id = (uint32_t)(now / t->window_cycles);
+    wheel_insert(t, slot_idx, now / t->tick_cycles + t->timeout_ticks);
+    t->stats.inserts++;
+    t->stats.active++;
+    *is_new = true;
+    return slot;
+}
+
+// Sliding-window estimate: current window plus the unexpired share of the last one
+static inline uint64_t window_rate(const struct flow_table *t, uint64_t now,
+                                   uint32_t window_id, uint32_t cur, uint32_t prev) {
+    uint64_t into = now - (uint64_t)window_id * t->window_cycles;
+    if (into >= t->window_cycles)
+        into = t->window_cycles;
+    return cur + prev * (t->window_cycles - into) / t->window_cycles;
+}
+
+static inline void account(struct flow_table *t, struct flow_entry *e, uint64_t now,
+                           uint32_t bytes, bool syn) {
+    uint32_t window_id = (uint32_t)(now / t->window_cycles);
+
+    if (window_id != e->window_id) {
+        bool consecutive = window_id == e->window_id + 1;
+        e->prev_pkts = consecutive ? e->win_pkts : 0;
+        e->prev_syns = consecutive ? e->win_syns : 0;
+        e->win_pkts = 0;
+        e->win_syns = 0;
+        e->window_id = window_id;
+    }
+    e->packets++;
+    e->bytes += bytes;
+    e->win_pkts++;
+    if (syn && e->win_syns < UINT16_MAX)
+        e->win_syns++;
+    e->last_seen = now;
+}
+
+static uint8_t update_aggregate(struct flow_table *t, const struct flow_key *key, uint8_t kind,
+                                uint64_t now, bool syn, uint32_t limit, uint8_t alert) {
+    struct flow_key agg = *key;
+    bool is_new;
+
+    agg.src_port = 0;
+    agg.pad[0] = kind;
+    if (kind == KIND_HOST_PAIR) {
+        agg.dst_port = 0;
+        agg.proto = 0;
+    } else {
+        agg.src_ip = 0;
+    }
+
+    struct flow_entry *e = lookup_or_insert(t, &agg, now, &is_new);
+    if (!e)
+        return 0;
+    account(t, e, now, 0, syn);
+
+    uint64_t rate = kind == KIND_HOST_PAIR
+                        ? window_rate(t, now, e->window_id, e->win_pkts, e->prev_pkts)
+                        : window_rate(t, now, e->window_id, e->win_syns, e->prev_syns);
+    if (rate <= limit)
+        return 0;
+    if (!(e->alerted & alert)) {
+        e->alerted |= alert;
+        t->stats.alerts++;
+    }
+    return alert;
+}
+
+uint8_t flow_table_update(struct flow_table *t, const struct flow_key *key,
+                          uint32_t pkt_len, uint8_t tcp_flags, uint64_t now_tsc) {
+    bool syn = (tcp_flags & (RTE_TCP_SYN_FLAG | RTE_TCP_ACK_FLAG)) == RTE_TCP_SYN_FLAG;
+    uint8_t alerts = 0;
+    bool is_new;
+
+    t->stats.lookups++;
+    struct flow_entry *e = lookup_or_insert(t, key, now_tsc, &is_new);
+    if (!e)
+        return 0;
+    account(t, e, now_tsc, pkt_len, syn);
+
+    if (t->limits.pps &&
+        window_rate(t, now_tsc, e->window_id, e->win_pkts, e->prev_pkts) > t->limits.pps)
+        alerts |= FLOW_ALERT_FLOOD;
+    if (t->limits.syn_ps && syn &&
+        window_rate(t, now_tsc, e->window_id, e->win_syns, e->prev_syns) > t->limits.syn_ps)
+        alerts |= FLOW_ALERT_SYN;
+    if (alerts & ~e->alerted) {
+        e->alerted |= alerts;
+        t->stats.alerts++;
+    }
+
+    // A SYN flood from spoofed sources is spread over many one-packet flows,
+    // and a scan over many short flows: track those per destination/host pair
+    if (t->limits.syn_ps && syn)
+        alerts |= update_aggregate(t, key, KIND_SERVICE, now_tsc, true,
+                                   t->limits.syn_ps, FLOW_ALERT_SYN);
+    if (t->limits.new_flows_ps && is_new)
+        alerts |= update_aggregate(t, key, KIND_HOST_PAIR, now_tsc, false,
+                                   t->limits.new_flows_ps, FLOW_ALERT_SCAN);
+    return alerts;
+}
+
+void flow_table_age(struct flow_table *t, uint64_t now_tsc) {
+    uint64_t now_tick = now_tsc / t->tick_cycles;
+    unsigned budget = FLOW_AGE_BUDGET;
+
+    while (budget) {
+        if (t->age_list == WHEEL_NIL) {
+            if (t->next_tick > now_tick)
+                return;
+            uint32_t slot = t->next_tick % FLOW_WHEEL_SLOTS;
+            t->age_list = t->wheel[slot];
+            t->wheel[slot] = WHEEL_NIL;
+            t->next_tick++;
+            continue;
+        }
+
+        uint32_t idx = t->age_list;
+        struct flow_entry *e = &t->entries[idx];
+        t->age_list = e->wheel_next;
+        budget--;
+
+        if (now_tsc - e->last_seen < t->timeout_cycles) {
+            // Still active: re-arm for when it would go idle
+            wheel_insert(t, idx, e->last_seen / t->tick_cycles + t->timeout_ticks);
+            continue;
+        }
+
+        // An empty successor means no probe chain runs through this slot
+        bool next_empty = t->entries[(idx + 1) & t->mask].state == ENTRY_EMPTY;
+        e->state = next_empty ? ENTRY_EMPTY : ENTRY_DELETED;
+        t->stats.evictions++;
+        t->stats.active--;
+    }
+}
+
+void flow_table_get_stats(const struct flow_table *t, struct flow_table_stats *stats) {
+    *stats = t->stats;
+}
+
+size_t flow_table_memory(const struct flow_table *t) {
+    return sizeof(*t) + (size_t)(t->mask + 1) * sizeof(struct flow_entry);
+}
@@ -0,0 +1,71 @@
+#ifndef FLOW_TABLE_H_
+#define FLOW_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-flow state for rate-based detection. A table is owned by exactly one
+// detect lcore, so nothing in here is thread-safe.
+
+#define FLOW_TABLE_SIZE 65536      // entries per detect queue, power of two
+#define FLOW_MAX_PROBE 16          // bounded probe length per lookup
+#define FLOW_WHEEL_SLOTS 64        // timer wheel: one slot per tick
+#define FLOW_AGE_BUDGET 256        // entries examined per aging call
+
+// Alert bits returned by flow_table_update()
+#define FLOW_ALERT_FLOOD    0x01   // packets/s of one flow above limit (e.g. ICMP flood)
+#define FLOW_ALERT_SYN      0x02   // SYNs/s of one flow above limit
+#define FLOW_ALERT_SCAN     0x04   // new flows/s between one host pair above limit
+
+struct flow_key {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t  proto;
+    uint8_t  pad[3];
+};
+
+struct flow_limits {
+    uint32_t pps;              // FLOW_ALERT_FLOOD threshold, 0 = off
+    uint32_t syn_ps;           // FLOW_ALERT_SYN threshold, 0 = off
+    uint32_t new_flows_ps;     // FLOW_ALERT_SCAN threshold, 0 = off
+    uint32_t idle_timeout_s;   // evict flows idle this long (< FLOW_WHEEL_SLOTS)
+};
+
+struct flow_table_stats {
+    uint64_t lookups;
+    uint64_t inserts;
+    uint64_t evictions;
+    uint64_t insert_failures;  // probe limit hit, flow not tracked
+    uint64_t alerts;
+    uint32_t active;
+    uint32_t capacity;
+};
+
+struct flow_table;
+
+struct flow_table *flow_table_create(const char *name, uint32_t entries,
+                                     const struct flow_limits *limits, int socket_id);
+void flow_table_free(struct flow_table *t);
+
+// Account one packet and return the FLOW_ALERT_* bits it triggers.
+uint8_t flow_table_update(struct flow_table *t, const struct flow_key *key,
+                          uint32_t pkt_len, uint8_t tcp_flags, uint64_t now_tsc);
+
+// Advance the timer wheel and evict idle flows. Cheap when no tick is due;
+// never examines more than FLOW_AGE_BUDGET entries per call.
+void flow_table_age(struct flow_table *t, uint64_t now_tsc);
+
+void flow_table_get_stats(const struct flow_table *t, struct flow_table_stats *stats);
+size_t flow_table_memory(const struct flow_table *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FLOW_TABLE_H_
@@ -0,0 +1,362 @@
+// heavy_hitters.c
+#define _GNU_SOURCE
+#include "heavy_hitters.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_hash_crc.h>
+
+#define NIL UINT32_MAX
+
+// Space-saving counters hang off buckets of equal count; buckets form a list
+// sorted by count, so the minimum is always the head bucket (stream-summary).
+struct ss_counter {
+    uint64_t key;
+    uint64_t error;
+    uint32_t bucket;
+    uint32_t prev, next;
+};
+
+struct ss_bucket {
+    uint64_t value;
+    uint32_t first;
+    uint32_t prev, next;
+};
+
+struct hh_tracker {
+    uint32_t width_mask;
+    uint32_t k;
+    uint32_t *cms;                 // HH_CMS_DEPTH rows of width counters
+
+    struct ss_counter *counters;
+    uint32_t used;
+    struct ss_bucket *buckets;
+    uint32_t head;                 // smallest count
+    uint32_t free_buckets;
+
+    uint32_t *index;               // key -> counter + 1, linear probing
+    uint32_t index_mask;
+
+    uint32_t seq;                  // odd while the snapshot is being written
+    uint32_t snap_n;
+    struct hh_entry *snap;
+};
+
+static const uint32_t row_seeds[HH_CMS_DEPTH] = {
+    0x8f1bbcdc, 0xca62c1d6, 0x5a827999, 0x6ed9eba1,
+};
+
+static inline uint32_t index_hash(uint64_t key) {
+    return rte_hash_crc_8byte(key, 0x3c6ef372);
+}
+
+struct hh_tracker *hh_create(uint32_t cms_width, uint32_t k) {
+    if (!rte_is_power_of_2(cms_width) || k == 0)
+        return NULL;
+
+    struct hh_tracker *t = calloc(1, sizeof(*t));
+    if (!t)
+        return NULL;
+    t->width_mask = cms_width - 1;
+    t->k = k;
+    t->index_mask = rte_align32pow2(2 * k) - 1;
+    t->cms = calloc((size_t)HH_CMS_DEPTH * cms_width, sizeof(*t->cms));
+    t->counters = calloc(k, sizeof(*t->counters));
+    t->buckets = calloc(k + 1, sizeof(*t->buckets));
+    t->index = calloc(t->index_mask + 1, sizeof(*t->index));
+    t->snap = calloc(k, sizeof(*t->snap));
+    if (!t->cms || !t->counters || !t->buckets || !t->index || !t->snap) {
+        hh_free(t);
+        return NULL;
+    }
+
+    t->head = NIL;
+    for (uint32_t i = 0; i <= k; i++)
+        t->buckets[i].next = i < k ? i + 1 : NIL;
+    t->free_buckets = 0;
+    return t;
+}
+
+void hh_free(struct hh_tracker *t) {
+    if (!t)
+        return;
+    free(t->cms);
+    free(t->counters);
+    free(t->buckets);
+    free(t->index);
+    free(t->snap);
+    free(t);
+}
+
+// Conservative update: only raise the rows that hold the current minimum.
+// Returns the key's new estimate.
+static uint32_t cms_add(struct hh_tracker *t, uint64_t key) {
+    uint32_t *cell[HH_CMS_DEPTH];
+    uint32_t min = UINT32_MAX;
+
+    for (unsigned r = 0; r < HH_CMS_DEPTH; r++) {
+        uint32_t col = rte_hash_crc_8byte(key, row_seeds[r]) & t->width_mask;
+        cell[r] = &t->cms[(size_t)r * (t->width_mask + 1) + col];
+        if (*cell[r] < min)
+            min = *cell[r];
+    }
+    if (min == UINT32_MAX)
+        return min;
+    for (unsigned r = 0; r < HH_CMS_DEPTH; r++)
+        if (*cell[r] == min)
+            __atomic_store_n(cell[r], min + 1, __ATOMIC_RELAXED);
+    return min + 1;
+}
+
+uint64_t hh_estimate(const struct hh_tracker *t, uint64_t key) {
+    uint32_t min = UINT32_MAX;
+
+    for (unsigned r = 0; r < HH_CMS_DEPTH; r++) {
+        uint32_t col = rte_hash_crc_8byte(key, row_seeds[r]) & t->width_mask;
+        uint32_t v = __atomic_load_n(&t->cms[(size_t)r * (t->width_mask + 1) + col], __ATOMIC_RELAXED);
+        if (v < min)
+            min = v;
+    }
+    return min;
+}
+
+static uint32_t index_find(const struct hh_tracker *t, uint64_t key) {
+    for (uint32_t i = index_hash(key) & t->index_mask;; i = (i + 1) & t->index_mask) {
+        uint32_t c = t->index[i];
+        if (c == 0)
+            return NIL;
+        if (t->counters[c - 1].key == key)
+            return c - 1;
+    }
+}
+
+static void index_insert(struct hh_tracker *t, uint64_t key, uint32_t counter) {
+    uint32_t i = index_hash(key) & t->index_mask;
+    while (t->index[i] != 0)
+        i = (i + 1) & t->index_mask;
+    t->index[i] = counter + 1;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void index_remove(struct hh_tracker *t, uint64_t key) {
+    uint32_t i = index_hash(key) & t->index_mask;
+    while (t->counters[t->index[i] - 1].key != key)
+        i = (i + 1) & t->index_mask;
+
+    for (uint32_t j = (i + 1) & t->index_mask; t->index[j] != 0; j = (j + 1) & t->index_mask) {
+        uint32_t home = index_hash(t->counters[t->index[j] - 1].key) & t->index_mask;
+        // Move j back into the hole unless its home lies cyclically in (i, j]
+        if (((j - home) & t->index_mask) >= ((j - i) & t->index_mask)) {
+            t->index[i] = t->index[j];
+            i = j;
+        }
+    }
+    t->index[i] = 0;
+}
+
+static uint32_t bucket_new(struct hh_tracker *t, uint64_t value, uint32_t prev, uint32_t next) {
+    uint32_t b = t->free_buckets;
+    struct ss_bucket *nb = &t->buckets[b];
+
+    t->free_buckets = nb->next;
+    nb->value = value;
+    nb->first = NIL;
+    nb->prev = prev;
+    nb->next = next;
+    if (prev != NIL)
+        t->buckets[prev].next = b;
+    else
+        t->head = b;
+    if (next != NIL)
+        t->buckets[next].prev = b;
+    return b;
+}
+
+static void bucket_release(struct hh_tracker *t, uint32_t b) {
+    struct ss_bucket *ob = &t->buckets[b];
+
+    if (ob->prev != NIL)
+        t->buckets[ob->prev].next = ob->next;
+    else
+        t->head = ob->next;
+    if (ob->next != NIL)
+        t->buckets[ob->next].prev = ob->prev;
+    ob->next = t->free_buckets;
+    t->free_buckets = b;
+}
+
+static void counter_attach(struct hh_tracker *t, uint32_t c, uint32_t b) {
+    struct ss_counter *sc = &t->counters[c];
+    struct ss_bucket *sb = &t->buckets[b];
+
+    sc->bucket = b;
+    sc->prev = NIL;
+    sc->next = sb->first;
+    if (sb->first != NIL)
+        t->counters[sb->first].prev = c;
+    sb->first = c;
+}
+
+// Returns true when the bucket is left empty
+static bool counter_detach(struct hh_tracker *t, uint32_t c) {
+    struct ss_counter *sc = &t->counters[c];
+    struct ss_bucket *sb = &t->buckets[sc->bucket];
+
+    if (sc->prev != NIL)
+        t->counters[sc->prev].next = sc->next;
+    else
+        sb->first = sc->next;
+    if (sc->next != NIL)
+        t->counters[sc->next].prev = sc->prev;
+    return sb->first == NIL;
+}
+
+static void counter_increment(struct hh_tracker *t, uint32_t c) {
+    uint32_t b = t->counters[c].bucket;
+    struct ss_bucket *sb = &t->buckets[b];
+    uint64_t value = sb->value + 1;
+    uint32_t next = sb->next;
+
+    if (next != NIL && t->buckets[next].value == value) {
+        if (counter_detach(t, c))
+            bucket_release(t, b);
+        counter_attach(t, c, next);
+    } else if (sb->first == c && t->counters[c].next == NIL) {
+        sb->value = value;      // alone in its bucket, order is unchanged
+    } else {
+        counter_detach(t, c);
+        counter_attach(t, c, bucket_new(t, value, b, next));
+    }
+}
+
+void hh_update(struct hh_tracker *t, uint64_t key) {
+    uint32_t estimate = cms_add(t, key);
+
+    uint32_t c = index_find(t, key);
+    if (c != NIL) {
+        counter_increment(t, c);
+        return;
+    }
+
+    if (t->used < t->k) {
+        c = t->used++;
+        t->counters[c].key = key;
+        t->counters[c].error = 0;
+        uint32_t b = t->head;
+        if (b == NIL || t->buckets[b].value != 1)
+            b = bucket_new(t, 1, NIL, b);
+        counter_attach(t, c, b);
+        index_insert(t, key, c);
+        return;
+    }
+
+    // Full: plain space-saving would let every tail key evict the minimum,
+    // which churns out real heavy hitters under a long tail. Admit a key only
+    // once the sketch says it outgrew the minimum; its true count is then at
+    // most min + 1, so the space-saving upper bound still holds.
+    uint64_t min = t->buckets[t->head].value;
+    if (estimate <= min)
+        return;
+
+    // The minimum counter takes over the new key and inherits its count as error
+    c = t->buckets[t->head].first;
+    index_remove(t, t->counters[c].key);
+    t->counters[c].key = key;
+    t->counters[c].error = min;
+    index_insert(t, key, c);
+    counter_increment(t, c);
+}
+
+static void sort_entries(struct hh_entry *e, unsigned n) {
+    for (unsigned i = 1; i < n; i++) {
+        struct hh_entry v = e[i];
+        unsigned j = i;
+        while (j > 0 && e[j - 1].count < v.count) {
+            e[j] = e[j - 1];
+            j--;
+        }
+        e[j] = v;
+    }
+}
+
+unsigned hh_topk(const struct hh_tracker *t, struct hh_entry *out, unsigned max) {
+    struct hh_entry all[t->used ? t->used : 1];
+
+    for (uint32_t c = 0; c < t->used; c++) {
+        const struct ss_counter *sc = &t->counters[c];
+        uint64_t count = t->buckets[sc->bucket].value;
+        uint64_t cms = hh_estimate(t, sc->key);
+        // Both structures overestimate, the smaller bound is the tighter one
+        all[c].key = sc->key;
+        all[c].count = cms < count ? cms : count;
+        all[c].error = sc->error < all[c].count ? sc->error : all[c].count;
+    }
+    sort_entries(all, t->used);
+
+    unsigned n = t->used < max ? t->used : max;
+    memcpy(out, all, n * sizeof(*out));
+    return n;
+}
+
+void hh_publish(struct hh_tracker *t) {
+    __atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    t->snap_n = hh_topk(t, t->snap, t->k);
+    __atomic_store_n(&t->seq, t->seq + 1, __ATOMIC_RELEASE);
+}
+
+unsigned hh_snapshot(const struct hh_tracker *t, struct hh_entry *out, unsigned max) {
+    unsigned n;
+    uint32_t s1, s2;
+
+    do {
+        s1 = __atomic_load_n(&t->seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1)
+            continue;
+        n = t->snap_n < max ? t->snap_n : max;
+        memcpy(out, t->snap, n * sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s2 = __atomic_load_n(&t->seq, __ATOMIC_RELAXED);
+        if (s1 == s2)
+            return n;
+    } while (1);
+}
+
+unsigned hh_merge_snapshots(struct hh_tracker *const trackers[], unsigned n,
+                            struct hh_entry *out, unsigned max) {
+    struct hh_entry merged[n * HH_TOPK + 1], snap[HH_TOPK];
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < n; i++) {
+        if (!trackers[i])
+            continue;
+        unsigned got = hh_snapshot(trackers[i], snap, HH_TOPK);
+        for (unsigned s = 0; s < got; s++) {
+            unsigned m = 0;
+            while (m < count && merged[m].key != snap[s].key)
+                m++;
+            if (m == count) {
+                merged[count++] = snap[s];
+            } else {
+                merged[m].count += snap[s].count;
+                merged[m].error += snap[s].error;
+            }
+        }
+    }
+    sort_entries(merged, count);
+
+    unsigned ret = count < max ? count : max;
+    memcpy(out, merged, ret * sizeof(*out));
+    return ret;
+}
+
+size_t hh_memory(const struct hh_tracker *t) {
+    return sizeof(*t) +
+           (size_t)HH_CMS_DEPTH * (t->width_mask + 1) * sizeof(uint32_t) +
+           (size_t)t->k * (sizeof(struct ss_counter) + sizeof(struct hh_entry)) +
+           (size_t)(t->k + 1) * sizeof(struct ss_bucket) +
+           (size_t)(t->index_mask + 1) * sizeof(uint32_t);
+}
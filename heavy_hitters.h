@@ -0,0 +1,58 @@
+#ifndef HEAVY_HITTERS_H_
+#define HEAVY_HITTERS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bounded-memory heavy-hitter tracking: a count-min sketch for point
+// estimates of any key plus a space-saving top-K (stream-summary) for the
+// heaviest keys, which admits new keys only once the sketch ranks them above
+// the current minimum. Both are O(1) per update and never grow.
+//
+// One tracker has exactly one writer (a detect lcore). Other threads read
+// the top-K through a seqlock-protected snapshot the writer publishes.
+
+#define HH_CMS_DEPTH 4
+#define HH_CMS_WIDTH 2048      // counters per row, power of two
+#define HH_TOPK 32
+
+struct hh_entry {
+    uint64_t key;
+    uint64_t count;            // upper bound on the true count
+    uint64_t error;            // count - error is a lower bound
+};
+
+struct hh_tracker;
+
+struct hh_tracker *hh_create(uint32_t cms_width, uint32_t k);
+void hh_free(struct hh_tracker *t);
+
+// Writer side
+void hh_update(struct hh_tracker *t, uint64_t key);
+void hh_publish(struct hh_tracker *t);
+
+// Count-min estimate; safe from any thread (may lag the writer slightly)
+uint64_t hh_estimate(const struct hh_tracker *t, uint64_t key);
+
+// Live top-K, writer thread only. Sorted by count, highest first.
+unsigned hh_topk(const struct hh_tracker *t, struct hh_entry *out, unsigned max);
+
+// Last published top-K, any thread
+unsigned hh_snapshot(const struct hh_tracker *t, struct hh_entry *out, unsigned max);
+
+// Merge the published top-K of several trackers (e.g. one per RX queue);
+// counts of a key are summed across trackers. Sorted, highest first.
+unsigned hh_merge_snapshots(struct hh_tracker *const trackers[], unsigned n,
+                            struct hh_entry *out, unsigned max);
+
+size_t hh_memory(const struct hh_tracker *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HEAVY_HITTERS_H_
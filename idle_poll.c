@@ -0,0 +1,152 @@
+// idle_poll.c
+#define _GNU_SOURCE
+#include "idle_poll.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+
+#include <rte_cpuflags.h>
+#include <rte_cycles.h>
+#include <rte_ethdev.h>
+#include <rte_lcore.h>
+#include <rte_pause.h>
+#include <rte_power_intrinsics.h>
+#include <rte_ring.h>
+
+enum idle_source {
+    IDLE_SOURCE_NONE = 0,
+    IDLE_SOURCE_RX,
+    IDLE_SOURCE_RING,
+};
+
+int idle_policy_parse(const char *spec, struct idle_policy *policy) {
+    *policy = (struct idle_policy){
+        .mode = IDLE_MODE_ADAPTIVE,
+        .spin_polls = IDLE_SPIN_POLLS,
+        .pause_polls = IDLE_PAUSE_POLLS,
+        .power_polls = IDLE_POWER_POLLS,
+        .power_us = IDLE_POWER_US,
+        .sleep_us = IDLE_SLEEP_US,
+    };
+    if (strcmp(spec, "busy") == 0) {
+        policy->mode = IDLE_MODE_BUSY;
+        return 0;
+    }
+    if (strncmp(spec, "adaptive", 8) != 0)
+        return -1;
+    spec += 8;
+    if (*spec == '\0')
+        return 0;
+    if (*spec != ':')
+        return -1;
+
+    uint32_t *fields[] = { &policy->spin_polls, &policy->pause_polls, &policy->power_polls,
+                           &policy->power_us, &policy->sleep_us };
+    for (unsigned i = 0; i < 5 && *spec == ':'; i++) {
+        int used;
+        if (sscanf(spec + 1, "%u%n", fields[i], &used) != 1)
+            return -1;
+        spec += 1 + used;
+    }
+    return *spec == '\0' ? 0 : -1;
+}
+
+void idle_poll_init(struct idle_poll *ip, const struct idle_policy *policy, struct idle_stats *stats) {
+    struct rte_cpu_intrinsics intr;
+
+    memset(ip, 0, sizeof(*ip));
+    ip->policy = *policy;
+    ip->stats = stats;
+    ip->power_cycles = rte_get_tsc_hz() / 1000000 * policy->power_us;
+    if (rte_cpu_get_intrinsics_support(&intr) == 0) {
+        ip->can_monitor = intr.power_monitor;
+        ip->can_pause = intr.power_pause;
+    }
+    // rte_power_monitor() keys its wake-up state on the lcore id, so on a
+    // plain thread it fails every time; say so instead of counting TPAUSEs
+    if (ip->can_monitor && rte_lcore_id() == LCORE_ID_ANY) {
+        ip->can_monitor = 0;
+        syslog(LOG_INFO, "[IDLE] Thread has no EAL lcore id: no UMWAIT, backing off with %s",
+               ip->can_pause ? "TPAUSE" : "sleeps");
+    }
+}
+
+void idle_poll_watch_rx(struct idle_poll *ip, uint16_t port, uint16_t queue) {
+    struct rte_power_monitor_cond pmc;
+
+    // Not every PMD exposes its descriptor ring (net_ring does not)
+    if (rte_eth_get_monitor_addr(port, queue, &pmc) < 0) {
+        ip->can_monitor = 0;
+        return;
+    }
+    ip->source = IDLE_SOURCE_RX;
+    ip->port = port;
+    ip->queue = queue;
+}
+
+void idle_poll_watch_ring(struct idle_poll *ip, const struct rte_ring *ring) {
+    ip->source = IDLE_SOURCE_RING;
+    ip->ring = ring;
+}
+
+// Keep sleeping while the producer tail still has the value we last saw
+static int ring_tail_unchanged(const uint64_t val, const uint64_t opaque[RTE_POWER_MONITOR_OPAQUE_SZ]) {
+    return val == opaque[0] ? 0 : -1;
+}
+
+static int monitor_cond(const struct idle_poll *ip, struct rte_power_monitor_cond *pmc) {
+    switch (ip->source) {
+    case IDLE_SOURCE_RX:
+        return rte_eth_get_monitor_addr(ip->port, ip->queue, pmc);
+    case IDLE_SOURCE_RING: {
+        volatile uint32_t *tail = (volatile uint32_t *)&ip->ring->prod.tail;
+        memset(pmc, 0, sizeof(*pmc));
+        pmc->addr = tail;
+        pmc->size = sizeof(*tail);
+        pmc->opaque[0] = __atomic_load_n(tail, __ATOMIC_ACQUIRE);
+        pmc->fn = ring_tail_unchanged;
+        return 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+void idle_poll_backoff(struct idle_poll *ip) {
+    const struct idle_policy *p = &ip->policy;
+    uint32_t depth = ip->empty - p->spin_polls;
+
+    if (depth <= p->pause_polls) {
+        rte_pause();
+        ip->stats->pauses++;
+        return;
+    }
+    depth -= p->pause_polls;
+
+    if (depth <= p->power_polls) {
+        struct rte_power_monitor_cond pmc;
+        uint64_t deadline = rte_get_tsc_cycles() + ip->power_cycles;
+        int waited = -1;
+        if (ip->can_monitor && monitor_cond(ip, &pmc) == 0) {
+            waited = rte_power_monitor(&pmc, deadline);
+            if (waited == 0)
+                ip->stats->monitor_waits++;
+        }
+        if (waited != 0 && ip->can_pause)
+            waited = rte_power_pause(deadline);
+        if (waited == 0) {
+            ip->stats->power_waits++;
+            return;
+        }
+        // No WAITPKG: go straight to sleeping
+    }
+
+    struct timespec ts = { .tv_sec = p->sleep_us / 1000000, .tv_nsec = (long)(p->sleep_us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+    ip->stats->sleeps++;
+    // Stay in the sleep phase without letting the counter wrap
+    if (ip->empty == UINT32_MAX)
+        ip->empty--;
+}
@@ -0,0 +1,93 @@
+#ifndef IDLE_POLL_H_
+#define IDLE_POLL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Adaptive idle backoff for busy-polling loops (RX, DETECT). After
+// spin_polls empty polls in a row the loop escalates:
+//   1. rte_pause() for pause_polls polls
+//   2. UMWAIT on the watched RX descriptor / ring tail, or TPAUSE when
+//      there is nothing to watch, for power_polls waits of power_us each
+//      (skipped on CPUs without WAITPKG)
+//   3. nanosleep(sleep_us) between polls
+// and drops straight back to full-speed polling on the first non-empty poll.
+// IDLE_MODE_BUSY keeps the plain spin loop.
+
+enum idle_mode {
+    IDLE_MODE_BUSY = 0,
+    IDLE_MODE_ADAPTIVE,
+};
+
+#define IDLE_SPIN_POLLS   64
+#define IDLE_PAUSE_POLLS  1024
+#define IDLE_POWER_POLLS  200
+#define IDLE_POWER_US     10
+#define IDLE_SLEEP_US     50
+
+struct idle_policy {
+    enum idle_mode mode;
+    uint32_t spin_polls;
+    uint32_t pause_polls;
+    uint32_t power_polls;
+    uint32_t power_us;
+    uint32_t sleep_us;
+};
+
+struct idle_stats {
+    uint64_t pauses;
+    uint64_t power_waits;     // UMWAIT or TPAUSE
+    uint64_t monitor_waits;   // of which UMWAIT
+    uint64_t sleeps;
+    uint64_t wakeups;         // first burst after the loop had backed off
+};
+
+struct rte_ring;
+
+struct idle_poll {
+    struct idle_policy policy;
+    struct idle_stats *stats;
+    uint32_t empty;           // consecutive empty polls
+    uint8_t can_monitor;      // UMWAIT on a known address; needs an EAL lcore id
+    uint8_t can_pause;        // TPAUSE
+    uint16_t port, queue;     // watched RX queue when source is RX
+    uint8_t source;
+    const struct rte_ring *ring;
+    uint64_t power_cycles;
+};
+
+// "busy" or "adaptive[:SPIN:PAUSE:POWER:POWER_US:SLEEP_US]"; omitted fields
+// keep the IDLE_* defaults. Returns 0 on success, -1 on a malformed spec.
+int idle_policy_parse(const char *spec, struct idle_policy *policy);
+
+void idle_poll_init(struct idle_poll *ip, const struct idle_policy *policy, struct idle_stats *stats);
+
+// Address to UMWAIT on while backed off; without one the loop uses TPAUSE
+void idle_poll_watch_rx(struct idle_poll *ip, uint16_t port, uint16_t queue);
+void idle_poll_watch_ring(struct idle_poll *ip, const struct rte_ring *ring);
+
+// Slow path, only reached after spin_polls empty polls
+void idle_poll_backoff(struct idle_poll *ip);
+
+// Call once per poll with the number of objects it returned
+static inline void idle_poll_update(struct idle_poll *ip, unsigned n) {
+    if (n) {
+        if (ip->empty > ip->policy.spin_polls)
+            ip->stats->wakeups++;
+        ip->empty = 0;
+        return;
+    }
+    if (ip->policy.mode == IDLE_MODE_BUSY)
+        return;
+    if (++ip->empty > ip->policy.spin_polls)
+        idle_poll_backoff(ip);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // IDLE_POLL_H_
@@ -0,0 +1,72 @@
+// latency_hist.c
+#define _GNU_SOURCE
+#include "latency_hist.h"
+
+#include <string.h>
+
+_Static_assert(LHIST_SUB_BITS < LHIST_MAX_BITS, "histogram needs at least one log range");
+
+void lhist_reset(struct latency_hist *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void lhist_merge(struct latency_hist *dst, const struct latency_hist *src) {
+    for (unsigned i = 0; i < LHIST_BUCKETS; i++)
+        dst->buckets[i] += src->buckets[i];
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+uint64_t lhist_bucket_low(unsigned idx) {
+    if (idx < 2 * LHIST_SUB)
+        return idx;
+    unsigned shift = idx / LHIST_SUB - 1;
+    return (uint64_t)(LHIST_SUB + idx % LHIST_SUB) << shift;
+}
+
+uint64_t lhist_bucket_high(unsigned idx) {
+    if (idx < 2 * LHIST_SUB)
+        return idx;
+    unsigned shift = idx / LHIST_SUB - 1;
+    return lhist_bucket_low(idx) + (1ULL << shift) - 1;
+}
+
+uint64_t lhist_percentile(const struct latency_hist *h, double p) {
+    if (h->count == 0)
+        return 0;
+
+    // Rank of the sample we want, 1-based; p = 100 is the maximum
+    uint64_t rank = (uint64_t)(p / 100.0 * h->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank >= h->count)
+        return h->max;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LHIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t high = lhist_bucket_high(i);
+            return high < h->max ? high : h->max;
+        }
+    }
+    return h->max;
+}
+
+void lhist_write_csv(const struct latency_hist *h, FILE *f, const char *metric,
+                     double unit, int header) {
+    if (header)
+        fprintf(f, "metric,low,high,count,max\n");
+    for (unsigned i = 0; i < LHIST_BUCKETS; i++) {
+        if (!h->buckets[i])
+            continue;
+        fprintf(f, "%s,%.3f,%.3f,%lu,%.3f\n", metric,
+                lhist_bucket_low(i) / unit, (lhist_bucket_high(i) + 1) / unit,
+                (unsigned long)h->buckets[i], h->max / unit);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef LATENCY_HIST_H_
+#define LATENCY_HIST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fixed-memory log-linear (HDR-style) histogram of non-negative integer
+// samples, e.g. nanoseconds. Each power of two is split into LHIST_SUB
+// linear buckets, so any recorded value is known to within 1/LHIST_SUB
+// (about 3%). Values up to 2^LHIST_MAX_BITS - 1 are kept; larger ones land
+// in the top bucket but still update max.
+//
+// Recording is a few instructions and never allocates. A histogram has one
+// writer; readers on other threads see approximate (possibly torn) counts.
+
+#define LHIST_SUB_BITS 5
+#define LHIST_SUB      (1u << LHIST_SUB_BITS)
+#define LHIST_MAX_BITS 40                     // ~18 minutes in ns
+#define LHIST_BUCKETS  (LHIST_SUB * (LHIST_MAX_BITS - LHIST_SUB_BITS + 1))
+
+struct latency_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[LHIST_BUCKETS];
+};
+
+static inline unsigned lhist_index(uint64_t v) {
+    if (v < 2 * LHIST_SUB)
+        return (unsigned)v;
+    if (v >> LHIST_MAX_BITS)
+        return LHIST_BUCKETS - 1;
+    unsigned k = 63 - __builtin_clzll(v);     // v in [2^k, 2^(k+1))
+    unsigned shift = k - LHIST_SUB_BITS;
+    return LHIST_SUB * (shift + 1) + (unsigned)(v >> shift) - LHIST_SUB;
+}
+
+static inline void lhist_record(struct latency_hist *h, uint64_t v) {
+    h->buckets[lhist_index(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+}
+
+void lhist_reset(struct latency_hist *h);
+void lhist_merge(struct latency_hist *dst, const struct latency_hist *src);
+
+// Value range covered by one bucket
+uint64_t lhist_bucket_low(unsigned idx);
+uint64_t lhist_bucket_high(unsigned idx);
+
+// Upper bound of the bucket holding the p-th percentile (0..100), clamped
+// to the exact max; 0 for an empty histogram
+uint64_t lhist_percentile(const struct latency_hist *h, double p);
+
+// One CSV row per non-empty bucket [low, high): "<metric>,<low>,<high>,<count>,<max>",
+// values divided by unit (e.g. 1000 for ns -> us). Pass header=1 for the
+// first histogram written to a file.
+void lhist_write_csv(const struct latency_hist *h, FILE *f, const char *metric,
+                     double unit, int header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LATENCY_HIST_H_
@@ -0,0 +1,54 @@
+// lcore_backend.c
+#define _GNU_SOURCE
+#include "lcore_backend.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <syslog.h>
+
+#include <rte_errno.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+
+// Set before the launch returns, so a second service on the same core sees
+// it even if the worker has not picked up the first one yet
+static bool launched[RTE_MAX_LCORE];
+
+int lcore_backend_check(unsigned core) {
+    if (core >= RTE_MAX_LCORE || !rte_lcore_is_enabled(core))
+        return -1;
+    return 0;
+}
+
+int lcore_backend_launch(unsigned core, int (*fn)(void *), void *arg) {
+    if (lcore_backend_check(core) < 0)
+        return -EINVAL;
+    if (core == rte_get_main_lcore() || launched[core] || rte_eal_get_lcore_state(core) != WAIT)
+        return -EBUSY;
+
+    int ret = rte_eal_remote_launch(fn, arg, core);
+    if (ret < 0)
+        return ret;
+    launched[core] = true;
+    return 0;
+}
+
+void lcore_backend_wait(unsigned core) {
+    if (core < RTE_MAX_LCORE && launched[core]) {
+        rte_eal_wait_lcore(core);
+        launched[core] = false;
+    }
+}
+
+int lcore_backend_register(void) {
+    if (rte_thread_register() < 0) {
+        syslog(LOG_WARNING, "[LCORE] Cannot register thread: %s", rte_strerror(rte_errno));
+        return -1;
+    }
+    return 0;
+}
+
+void lcore_backend_unregister(void) {
+    if (rte_lcore_id() != LCORE_ID_ANY)
+        rte_thread_unregister();
+}
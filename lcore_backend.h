@@ -0,0 +1,33 @@
+#ifndef LCORE_BACKEND_H_
+#define LCORE_BACKEND_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Running Sequencer services as EAL lcores, so rte_lcore_id() is valid and
+// per-lcore mempool caches are used. A service whose core is an idle EAL
+// worker is started with rte_eal_remote_launch(). Cores can host several
+// services (LED and LOGGER share one), and the main lcore is busy running
+// main(); services there run on a pthread pinned to the core that
+// registers itself with rte_thread_register() instead.
+
+// 0 if core is in the EAL coremask, -1 otherwise
+int lcore_backend_check(unsigned core);
+
+// Start fn(arg) on worker lcore `core`. -EBUSY if it is the main lcore or
+// already runs a service; the caller then falls back to a registered thread.
+int lcore_backend_launch(unsigned core, int (*fn)(void *), void *arg);
+
+// Block until the function launched on core returns
+void lcore_backend_wait(unsigned core);
+
+// From a non-EAL thread: take an lcore id for its lifetime
+int lcore_backend_register(void);
+void lcore_backend_unregister(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LCORE_BACKEND_H_
@@ -0,0 +1,244 @@
+// log_writer.c
+#define _GNU_SOURCE
+#include "log_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <rte_mbuf.h>
+#include <rte_ring.h>
+#include <rte_ring_elem.h>
+
+_Static_assert(sizeof(struct log_record) == 48, "log record layout is shared with logbin2csv.py");
+_Static_assert(sizeof(struct log_file_header) == 16, "log header layout is shared with logbin2csv.py");
+
+#define DRAIN_BURST 256
+#define CAPTURE_BURST 32
+
+// Classic pcap with nanosecond timestamps
+struct pcap_file_header {
+    uint32_t magic;
+    uint16_t version_major, version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs, snaplen, linktype;
+};
+
+struct pcap_rec_header {
+    uint32_t ts_sec, ts_nsec, incl_len, orig_len;
+};
+
+struct capture_elem {
+    struct rte_mbuf *mbuf;
+    uint64_t wall_ns;
+};
+
+static struct rte_ring *log_ring, *capture_ring;
+static pthread_t writer_thread;
+static volatile bool writer_running;
+static int log_fd = -1, capture_fd = -1;
+static struct log_writer_stats stats;
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            syslog(LOG_ERR, "[LOGWRITER] write failed: %s", strerror(errno));
+            return;
+        }
+        buf += n;
+        len -= n;
+        stats.bytes += n;
+    }
+    stats.writes++;
+}
+
+// Write the queued captures in one write(), then give the mbufs back
+static unsigned drain_captures(void) {
+    static char buf[CAPTURE_BURST * (sizeof(struct pcap_rec_header) + LOG_CAPTURE_SNAPLEN)];
+    struct capture_elem elems[CAPTURE_BURST];
+    size_t used = 0;
+
+    if (!capture_ring)
+        return 0;
+    unsigned n = rte_ring_dequeue_burst_elem(capture_ring, elems, sizeof(elems[0]), CAPTURE_BURST, NULL);
+    for (unsigned i = 0; i < n; i++) {
+        struct rte_mbuf *m = elems[i].mbuf;
+        uint32_t len = m->pkt_len < LOG_CAPTURE_SNAPLEN ? m->pkt_len : LOG_CAPTURE_SNAPLEN;
+        struct pcap_rec_header rec = {
+            .ts_sec = (uint32_t)(elems[i].wall_ns / 1000000000ULL),
+            .ts_nsec = (uint32_t)(elems[i].wall_ns % 1000000000ULL),
+            .incl_len = len,
+            .orig_len = m->pkt_len,
+        };
+        memcpy(buf + used, &rec, sizeof(rec));
+        used += sizeof(rec);
+        const void *data = rte_pktmbuf_read(m, 0, len, buf + used);
+        if (data != buf + used)
+            memcpy(buf + used, data, len);
+        used += len;
+        rte_pktmbuf_free(m);
+    }
+    if (used)
+        write_all(capture_fd, buf, used);
+    return n;
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    char *buf = malloc(LOG_WRITE_BATCH);
+    size_t used = 0;
+    uint64_t oldest_ms = 0;     // when the buffer went from empty to non-empty
+
+    if (!buf) {
+        syslog(LOG_ERR, "[LOGWRITER] Cannot allocate write buffer");
+        return NULL;
+    }
+    syslog(LOG_INFO, "[LOGWRITER] Thread running on core %d", sched_getcpu());
+
+    for (;;) {
+        bool running = writer_running;
+        unsigned room = (LOG_WRITE_BATCH - used) / sizeof(struct log_record);
+        unsigned n = rte_ring_dequeue_burst_elem(log_ring, buf + used, sizeof(struct log_record),
+                                                 room < DRAIN_BURST ? room : DRAIN_BURST, NULL);
+        if (n && used == 0)
+            oldest_ms = monotonic_ms();
+        used += n * sizeof(struct log_record);
+
+        // Write once the buffer is full, or when its oldest record has waited long enough
+        bool full = LOG_WRITE_BATCH - used < sizeof(struct log_record);
+        bool stale = used && monotonic_ms() - oldest_ms >= LOG_FLUSH_MS;
+        if (full || stale || (!running && n == 0 && used)) {
+            write_all(log_fd, buf, used);
+            used = 0;
+        }
+
+        n += drain_captures();
+
+        if (n == 0) {
+            if (!running)
+                break;      // stop requested and the rings are drained
+            usleep(1000);
+        }
+    }
+
+    free(buf);
+    return NULL;
+}
+
+int log_writer_start(const char *path, int core) {
+    log_ring = rte_ring_create_elem("LOG_RING", sizeof(struct log_record), LOG_RING_SIZE,
+                                    SOCKET_ID_ANY, RING_F_SP_ENQ | RING_F_SC_DEQ);
+    if (!log_ring) {
+        syslog(LOG_ERR, "[LOGWRITER] Failed to create log ring");
+        return -1;
+    }
+
+    log_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log_fd < 0) {
+        syslog(LOG_ERR, "[LOGWRITER] Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct log_file_header hdr = { .version = LOG_VERSION, .record_size = sizeof(struct log_record) };
+    memcpy(hdr.magic, LOG_MAGIC, sizeof(hdr.magic));
+    write_all(log_fd, (const char *)&hdr, sizeof(hdr));
+
+    // Plain SCHED_OTHER thread: it must never compete with the pipeline cores
+    writer_running = true;
+    if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) {
+        syslog(LOG_ERR, "[LOGWRITER] Failed to create writer thread");
+        close(log_fd);
+        log_fd = -1;
+        return -1;
+    }
+    pthread_setname_np(writer_thread, "log_writer");
+    if (core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(writer_thread, sizeof(set), &set);
+    }
+    return 0;
+}
+
+void log_writer_stop(void) {
+    if (log_fd < 0)
+        return;
+    writer_running = false;
+    pthread_join(writer_thread, NULL);
+    close(log_fd);
+    log_fd = -1;
+    if (capture_fd >= 0) {
+        close(capture_fd);
+        capture_fd = -1;
+    }
+}
+
+int log_writer_capture_open(const char *path) {
+    capture_ring = rte_ring_create_elem("CAPTURE_RING", sizeof(struct capture_elem), LOG_CAPTURE_RING_SIZE,
+                                        SOCKET_ID_ANY, RING_F_SP_ENQ | RING_F_SC_DEQ);
+    if (!capture_ring) {
+        syslog(LOG_ERR, "[LOGWRITER] Failed to create capture ring");
+        return -1;
+    }
+    capture_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (capture_fd < 0) {
+        syslog(LOG_ERR, "[LOGWRITER] Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct pcap_file_header hdr = {
+        .magic = 0xa1b23c4d, .version_major = 2, .version_minor = 4,
+        .snaplen = LOG_CAPTURE_SNAPLEN, .linktype = 1,   // Ethernet
+    };
+    write_all(capture_fd, (const char *)&hdr, sizeof(hdr));
+    return 0;
+}
+
+unsigned log_writer_capture(struct rte_mbuf *const *mbufs, unsigned n, uint64_t wall_ns) {
+    struct capture_elem elems[CAPTURE_BURST];
+    unsigned sent = 0;
+
+    if (capture_ring && writer_running) {
+        while (sent < n) {
+            unsigned chunk = n - sent < CAPTURE_BURST ? n - sent : CAPTURE_BURST;
+            for (unsigned i = 0; i < chunk; i++)
+                elems[i] = (struct capture_elem){ mbufs[sent + i], wall_ns };
+            unsigned got = rte_ring_enqueue_burst_elem(capture_ring, elems, sizeof(elems[0]), chunk, NULL);
+            sent += got;
+            if (got < chunk)
+                break;
+        }
+    }
+    stats.captured += sent;
+    stats.capture_dropped += n - sent;
+    return sent;
+}
+
+unsigned log_writer_push(const struct log_record *recs, unsigned n) {
+    unsigned sent = 0;
+
+    if (log_ring && writer_running)
+        sent = rte_ring_enqueue_burst_elem(log_ring, recs, sizeof(*recs), n, NULL);
+    stats.records += sent;
+    stats.dropped += n - sent;
+    return sent;
+}
+
+void log_writer_get_stats(struct log_writer_stats *out) {
+    *out = stats;
+}
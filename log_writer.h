@@ -0,0 +1,93 @@
+#ifndef LOG_WRITER_H_
+#define LOG_WRITER_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Packet log in fixed-size binary records. The logger service only copies
+// records into a ring; a normal-priority writer thread drains it and issues
+// large batched write()s, so the real-time core never formats text or makes
+// a syscall per packet. logbin2csv.py turns the file into packet_logger.csv.
+
+#define LOG_BIN_FILE    "packet_logger.bin"
+#define LOG_MAGIC       "PKTLOG01"
+#define LOG_VERSION     1
+#define LOG_RING_SIZE   16384              // records, power of two
+#define LOG_WRITE_BATCH (256 * 1024)       // bytes per write()
+#define LOG_FLUSH_MS    100                // max age of buffered records
+
+// Packets DETECT kept their buffers for (--retain), as pcap
+#define LOG_CAPTURE_FILE      "threats.pcap"
+#define LOG_CAPTURE_RING_SIZE 1024         // mbufs waiting for the writer, power of two
+#define LOG_CAPTURE_SNAPLEN   2048
+
+enum log_verdict {
+    LOG_VERDICT_SAFE = 0,
+    LOG_VERDICT_THREAT,
+    LOG_VERDICT_UNKNOWN,
+    LOG_VERDICT_SUMMARY,         // SAFE traffic DETECT shed under overload (overload.h)
+};
+
+// On-disk layout, little endian; keep logbin2csv.py in sync
+struct log_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+struct log_record {
+    uint64_t wall_ns;            // CLOCK_REALTIME when the burst was logged
+    union {
+        struct {
+            uint64_t detect_delay_ns;    // RX -> detect done
+            uint64_t log_delay_ns;       // detect done -> logged
+        };
+        struct {                         // LOG_VERDICT_SUMMARY; MACs and rule are 0
+            uint64_t summary_packets;
+            uint64_t summary_bytes;
+        };
+    };
+    uint32_t rule_id;
+    uint8_t  src_mac[6];
+    uint8_t  dst_mac[6];
+    uint8_t  verdict;            // enum log_verdict
+    uint8_t  flow_alerts;
+    uint8_t  reserved[6];
+};
+
+struct log_writer_stats {
+    uint64_t records;            // accepted into the ring
+    uint64_t dropped;            // ring full
+    uint64_t writes;             // write() calls
+    uint64_t bytes;
+    uint64_t captured;           // packets accepted for the capture file
+    uint64_t capture_dropped;    // capture ring full, freed uncaptured
+};
+
+// Create the ring and start the writer thread pinned to core (-1 = any).
+int log_writer_start(const char *path, int core);
+// Drain the ring, flush and join the writer. Records pushed afterwards are dropped.
+void log_writer_stop(void);
+
+// Single producer. Returns the number of records queued; the rest are counted as dropped.
+unsigned log_writer_push(const struct log_record *recs, unsigned n);
+
+struct rte_mbuf;
+
+// Open the pcap file retained packets go to. Call before log_writer_start().
+int log_writer_capture_open(const char *path);
+// Single producer. Queues packets for the capture file, stamped wall_ns,
+// and takes ownership of the ones it returns as queued: the writer frees
+// them once written. The caller frees the rest.
+unsigned log_writer_capture(struct rte_mbuf *const *mbufs, unsigned n, uint64_t wall_ns);
+
+void log_writer_get_stats(struct log_writer_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LOG_WRITER_H_
@@ -0,0 +1,57 @@
+import struct
+import sys
+import time
+
+# Converts the binary packet log written by log_writer.c into the
+# packet_logger.csv format the logger used to write directly.
+#
+# Usage: python3 logbin2csv.py [packet_logger.bin] [packet_logger.csv]
+
+HEADER = struct.Struct("<8sII")             # struct log_file_header
+RECORD = struct.Struct("<QQQI6s6sBB6x")     # struct log_record
+MAGIC = b"PKTLOG01"
+VERDICTS = {0: "SAFE", 1: "THREAT", 2: "UNKNOWN", 3: "SUMMARY"}
+SUMMARY = 3     # detect/log delay fields hold packets/bytes shed under overload
+
+
+def format_mac(raw):
+    return ":".join(f"{b:02X}" for b in raw)
+
+
+def convert(bin_path, csv_path):
+    with open(bin_path, "rb") as src, open(csv_path, "w") as dst:
+        magic, version, record_size = HEADER.unpack(src.read(HEADER.size))
+        if magic != MAGIC or record_size != RECORD.size:
+            sys.exit(f"{bin_path}: not a version {version} packet log with {RECORD.size}-byte records")
+
+        dst.write("Timestamp,Source MAC,Destination MAC,Threat Status,Detect Delay,Log Delay\n")
+        count = 0
+        last_sec, stamp = None, ""
+        while True:
+            chunk = src.read(RECORD.size * 4096)
+            if not chunk:
+                break
+            usable = len(chunk) - len(chunk) % RECORD.size   # a killed writer may leave a partial record
+            for wall_ns, detect_ns, log_ns, _rule, src_mac, dst_mac, verdict, _alerts in RECORD.iter_unpack(chunk[:usable]):
+                sec = wall_ns // 1_000_000_000
+                if sec != last_sec:
+                    stamp = time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(sec))
+                    last_sec = sec
+                if verdict == SUMMARY:
+                    dst.write(f"{stamp},,,SUMMARY,{detect_ns} pkts,{log_ns} bytes\n")
+                else:
+                    dst.write(f"{stamp},{format_mac(src_mac)},{format_mac(dst_mac)},"
+                              f"{VERDICTS.get(verdict, 'UNKNOWN')},"
+                              f"{detect_ns / 1000:.1f}us,{log_ns / 1000:.1f}us\n")
+                count += 1
+    print(f"Wrote {count} records to {csv_path}")
+
+
+def main():
+    bin_path = sys.argv[1] if len(sys.argv) > 1 else "packet_logger.bin"
+    csv_path = sys.argv[2] if len(sys.argv) > 2 else "packet_logger.csv"
+    convert(bin_path, csv_path)
+
+
+if __name__ == "__main__":
+    main()
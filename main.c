@@ -2,6 +2,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <time.h>
@@ -10,7 +11,6 @@
 #include <string.h>
 #include <unistd.h>
 #include <semaphore.h>
-#include <ncurses.h>
 
 #include <rte_eal.h>
 #include <rte_ether.h>
@@ -18,242 +18,568 @@
 #include <rte_mbuf.h>
 #include <rte_cycles.h>
 #include <rte_ring.h>
+#include <rte_mempool.h>
+#include <rte_prefetch.h>
 #include <syslog.h>
 
 #include "packet_logger.h"
+#include "rules.h"
+#include "burst_classify.h"
+#include "flow_table.h"
+#include "heavy_hitters.h"
+#include "log_writer.h"
+#include "pkt_latency.h"
+#include "dashboard.h"
+#include "overload.h"
+#include "alert.h"
+#include "bpf_filter.h"
 
 
 #define RX_CORE_ID 1
 #define DETECTION_CORE_ID 2
 #define LOGGER_CORE_ID 3
 
-#define MAX_HISTORY 50
+_Static_assert(BURST_SIZE <= CLASSIFY_BURST_MAX, "burst classifier handles at most 32 lanes");
+_Static_assert(MAX_RX_QUEUES <= PKT_LAT_MAX_QUEUES, "one RX -> detect histogram per queue");
 
 volatile bool force_quit = false;
 struct rte_mempool *mbuf_pool;
-struct rte_ring *packet_ring;
+struct rte_ring *packet_rings[MAX_RX_QUEUES];
 struct rte_ring *detected_ring;
-FILE *csv_file;
+struct rte_ring *threat_ring;
+struct rte_mempool *result_pool;
 uint16_t port_id = 0;
 uint64_t total_rx = 0;
-
-volatile bool threat_detected = false;
-
-struct detection_result {
-    struct rte_mbuf *mbuf;
-    char threat_status[16]; // "SAFE" or "THREAT"
-    uint64_t rx_tsc;
-    uint64_t detect_tsc;
+uint16_t nb_rx_queues = 1;
+uint64_t result_pool_exhausted[MAX_RX_QUEUES];
+struct stage_stats rx_stats[MAX_RX_QUEUES], detect_stats[MAX_RX_QUEUES];
+struct stage_stats logger_stats, threat_lane_stats;
+
+struct flow_limits flow_limits = {
+    .pps = 1000,
+    .syn_ps = 200,
+    .new_flows_ps = 100,
+    .idle_timeout_s = 30,
 };
-
-struct log_entry {
-    char timestamp[32];
-    char src_mac[32];
-    char dst_mac[32];
-    char threat_status[16];
-    long detect_delay_ms;
-    long log_delay_ms;
+struct flow_table *flow_tables[MAX_RX_QUEUES];
+struct hh_tracker *top_src_mac[MAX_RX_QUEUES];
+struct hh_tracker *top_src_ip[MAX_RX_QUEUES];
+enum retain_policy retain_policy = RETAIN_NONE;
+struct overload_config overload_config = {
+    .policy = OVERLOAD_NONE,
+    .high_pct = OVERLOAD_HIGH_PCT,
+    .low_pct = OVERLOAD_LOW_PCT,
+    .sample_every = OVERLOAD_SAMPLE_EVERY,
 };
 
 void signal_handler(int signum) {
     if (signum == SIGINT || signum == SIGTERM) {
         force_quit = true;
         syslog(LOG_INFO,"\nSignal %d received, exiting...\n", signum);
-        endwin();
     }
 }
 
-void rx_service() {
+static inline void stage_stats_update(struct stage_stats *s, unsigned n) {
+    s->polls++;
+    if (n) {
+        s->bursts++;
+        s->objs += n;
+    }
+}
+
+void print_stage_stats(const char *name, const struct stage_stats *s) {
+    if (s->polls == 0) {
+        syslog(LOG_INFO, "[%s] burst stats: no polls\n", name);
+        return;
+    }
+    double avg = s->bursts ? (double)s->objs / s->bursts : 0.0;
+    syslog(LOG_INFO, "[%s] bursts: %" PRIu64 " / %" PRIu64 " polls (%.1f%% empty), "
+           "avg occupancy = %.2f/%d (%.1f%%), objs = %" PRIu64 "\n",
+           name, s->bursts, s->polls,
+           100.0 * (s->polls - s->bursts) / s->polls,
+           avg, BURST_SIZE, 100.0 * avg / BURST_SIZE, s->objs);
+    if (s->drops || s->threats)
+        syslog(LOG_INFO, "[%s] dropped on full ring: %" PRIu64 " (%" PRIu64 " THREAT), threats: %" PRIu64
+               " (%" PRIu64 " spilled past the threat lane)\n",
+               name, s->drops, s->threat_drops, s->threats, s->threat_spills);
+    if (s->overloads)
+        syslog(LOG_INFO, "[%s] overload: %" PRIu64 " episodes, %" PRIu64 " SAFE records shed, "
+               "%" PRIu64 " summaries\n", name, s->overloads, s->shed, s->summaries);
+    if (s->backlog_max)
+        syslog(LOG_INFO, "[%s] input ring backlog peak: %" PRIu64 "\n", name, s->backlog_max);
+    const struct idle_stats *idle = &s->idle;
+    if (idle->pauses || idle->power_waits || idle->sleeps)
+        syslog(LOG_INFO, "[%s] idle: %" PRIu64 " pauses, %" PRIu64 " umwait, %" PRIu64 " tpause, %" PRIu64
+               " sleeps, %" PRIu64 " wakeups\n", name, idle->pauses, idle->monitor_waits,
+               idle->power_waits - idle->monitor_waits, idle->sleeps, idle->wakeups);
+}
+
+// EAL lcores and registered threads already have a per-lcore cache of the
+// descriptor pool; a plain pthread gets a private one it must release
+static struct rte_mempool_cache *stage_cache_get(bool *owned) {
+    struct rte_mempool_cache *cache = rte_mempool_default_cache(result_pool, rte_lcore_id());
+    *owned = cache == NULL;
+    return cache ? cache : rte_mempool_cache_create(RESULT_CACHE_SIZE, rte_socket_id());
+}
+
+static void stage_cache_put(struct rte_mempool_cache *cache, bool owned) {
+    if (cache && owned) {
+        rte_mempool_cache_flush(cache, result_pool);
+        rte_mempool_cache_free(cache);
+    }
+}
+
+void rx_service(uint16_t queue_id) {
 
     struct rte_mbuf *mbufs[BURST_SIZE]; 
-    syslog(LOG_INFO, "[%s] Thread running on core %d", __func__, sched_getcpu());
+    struct detection_result *results[BURST_SIZE];
+    bool own_cache;
+    struct rte_mempool_cache *cache = stage_cache_get(&own_cache);
+    struct rte_ring *out_ring = packet_rings[queue_id];
+    struct stage_stats *stats = &rx_stats[queue_id];
+    struct idle_poll idle;
+    idle_poll_init(&idle, service_idle_policy(), &stats->idle);
+    idle_poll_watch_rx(&idle, port_id, queue_id);
+    syslog(LOG_INFO, "[%s] Queue %u thread running on core %d (lcore %d)", __func__, queue_id,
+           sched_getcpu(), (int)rte_lcore_id());
     while(!force_quit){
-    const uint16_t nb_rx = rte_eth_rx_burst(port_id, 0, mbufs, BURST_SIZE);
-    total_rx += nb_rx;
-    
-    for (int i = 0; i < nb_rx; i++) {
-        struct detection_result *result = malloc(sizeof(struct detection_result));
-        if (!result) {
+    const uint16_t nb_rx = rte_eth_rx_burst(port_id, queue_id, mbufs, BURST_SIZE);
+    stage_stats_update(stats, nb_rx);
+    idle_poll_update(&idle, nb_rx);
+    if (nb_rx == 0)
+        continue;
+    pkt_latency_stamp(mbufs, nb_rx, rte_get_tsc_cycles());  // arrival time, before any per-burst work
+
+    if (rte_mempool_generic_get(result_pool, (void **)results, nb_rx, cache) < 0) {
+        // Pool exhausted: drop the whole burst and count it for sizing
+        result_pool_exhausted[queue_id] += nb_rx;
+        for (int i = 0; i < nb_rx; i++)
             rte_pktmbuf_free(mbufs[i]);
-            continue;
-        }
+        continue;
+    }
 
-        result->mbuf = mbufs[i];
-        strncpy(result->threat_status, "UNKNOWN", sizeof(result->threat_status));
-        result->rx_tsc = rte_get_tsc_cycles(); // Save RX time
+    for (int i = 0; i < nb_rx; i++)
+        results[i]->mbuf = mbufs[i];
 
-        if (rte_ring_enqueue(packet_ring, result) < 0) {
-            rte_pktmbuf_free(mbufs[i]);
-            free(result);
-        }
+    unsigned sent = rte_ring_enqueue_burst(out_ring, (void **)results, nb_rx, NULL);
+    if (sent < nb_rx) {
+        stats->drops += nb_rx - sent;
+        for (unsigned i = sent; i < nb_rx; i++)
+            rte_pktmbuf_free(results[i]->mbuf);
+        rte_mempool_generic_put(result_pool, (void **)&results[sent], nb_rx - sent, cache);
     }
 }
+    stage_cache_put(cache, own_cache);
 }
 
 
 
 
-void detect_service() {
-syslog(LOG_INFO, "[%s] Thread running on core %d", __func__, sched_getcpu());
+// Hand the open overload summary to LOGGER as one descriptor without a packet.
+// If the ring or the pool is full it stays open and is retried next burst.
+static void send_overload_summary(struct overload_state *ol, struct stage_stats *stats,
+                                  struct rte_mempool_cache *cache, uint64_t now_tsc) {
+    struct detection_result *sum;
+    if (rte_mempool_generic_get(result_pool, (void **)&sum, 1, cache) < 0)
+        return;
+    memset(sum, 0, sizeof(*sum));
+    sum->verdict = LOG_VERDICT_SUMMARY;
+    sum->rx_tsc = ol->summary_start_tsc;
+    sum->detect_tsc = now_tsc;
+    sum->shed_packets = ol->summary_packets;
+    sum->shed_bytes = ol->summary_bytes;
+    if (rte_ring_enqueue(detected_ring, sum) < 0) {
+        rte_mempool_generic_put(result_pool, (void **)&sum, 1, cache);
+        return;
+    }
+    overload_summary_sent(ol);
+    stats->summaries++;
+}
+
+void detect_service(uint16_t queue_id) {
+bool own_cache;
+struct rte_mempool_cache *cache = stage_cache_get(&own_cache);
+syslog(LOG_INFO, "[%s] Queue %u thread running on core %d (lcore %d)", __func__, queue_id,
+           sched_getcpu(), (int)rte_lcore_id());
+    struct detection_result *results[BURST_SIZE];
+    struct rte_mbuf *pkts[BURST_SIZE];
+    struct burst_fields fields;
+    struct rule_key keys[BURST_SIZE];
+    const struct rule_key *key_ptrs[BURST_SIZE];
+    uint32_t matches[BURST_SIZE];
+    unsigned key_idx[BURST_SIZE];
+    struct rte_ring *in_ring = packet_rings[queue_id];
+    struct stage_stats *stats = &detect_stats[queue_id];
+    struct latency_hist *rx_to_detect = &pkt_lat_rx_to_detect[queue_id].hist;
+    struct idle_poll idle;
+    idle_poll_init(&idle, service_idle_policy(), &stats->idle);
+    idle_poll_watch_ring(&idle, in_ring);
+    struct detection_result *shed[BURST_SIZE];
+    struct alert_event alerts[BURST_SIZE];
+    struct overload_state overload;
+    overload_init(&overload, &overload_config, rte_ring_get_capacity(detected_ring));
+
+    // Flow state is private to this lcore; RSS keeps a flow on one queue
+    char flow_name[32];
+    snprintf(flow_name, sizeof(flow_name), "FLOW_TABLE_%u", queue_id);
+    struct flow_table *flows = flow_table_create(flow_name, FLOW_TABLE_SIZE, &flow_limits, rte_socket_id());
+    flow_tables[queue_id] = flows;
+
+    // Top talkers in fixed memory, however many sources are spoofed
+    struct hh_tracker *macs = hh_create(HH_CMS_WIDTH, HH_TOPK);
+    struct hh_tracker *ips = hh_create(HH_CMS_WIDTH, HH_TOPK);
+    if (!macs || !ips)
+        syslog(LOG_ERR, "[%s] Queue %u: cannot allocate top-talker trackers", __func__, queue_id);
+    top_src_mac[queue_id] = macs;
+    top_src_ip[queue_id] = ips;
+    uint64_t publish_cycles = rte_get_tsc_hz() * TOP_PUBLISH_MS / 1000;
+    uint64_t next_publish = rte_get_tsc_cycles() + publish_cycles;
+
+    // A prefilter swap waits for every DETECT lcore to pass the top of its loop
+    bpf_filter_online(queue_id);
     while(!force_quit){
-    struct detection_result *result = NULL;
-    if (rte_ring_dequeue(packet_ring, (void **)&result) == 0 && result != NULL) {
-        struct rte_ether_hdr *eth_hdr = rte_pktmbuf_mtod(result->mbuf, struct rte_ether_hdr *);
-        void *l3_hdr = (char *)eth_hdr + sizeof(struct rte_ether_hdr);
-        uint8_t ip_proto = *((uint8_t *)l3_hdr + 9);
-        
-        if (ip_proto == 1) {
-            strncpy(result->threat_status, "THREAT", sizeof(result->threat_status));
-            threat_detected = true;
-        } else {
-            strncpy(result->threat_status, "SAFE", sizeof(result->threat_status));
+    bpf_filter_quiescent(queue_id);
+    unsigned avail;
+    unsigned nb = rte_ring_dequeue_burst(in_ring, (void **)results, BURST_SIZE, &avail);
+    stage_stats_update(stats, nb);
+    idle_poll_update(&idle, nb);
+    if (nb == 0) {
+        // Shedding may have ended with the traffic; do not sit on the last summary
+        if (overload.summary_packets) {
+            uint64_t now = rte_get_tsc_cycles();
+            if (overload_summary_due(&overload, now))
+                send_overload_summary(&overload, stats, cache, now);
         }
+        continue;
+    }
+    if (avail + nb > stats->backlog_max)
+        stats->backlog_max = avail + nb;
+
+    // Prefetch every header of the burst before the gather touches them
+    for (unsigned i = 0; i < nb; i++) {
+        pkts[i] = results[i]->mbuf;
+        results[i]->rule_id = 0;
+        results[i]->rx_tsc = pkt_latency_rx_tsc(pkts[i]);  // LOGGER then needs no mbuf metadata
+        rte_prefetch0(rte_pktmbuf_mtod(pkts[i], void *));
+    }
 
-        result->detect_tsc = rte_get_tsc_cycles(); // Save detection completed time
-
-        if (rte_ring_enqueue(detected_ring, result) < 0) {
-            rte_pktmbuf_free(result->mbuf);
-            free(result);
-
+    // SIMD pass: IPv4 lanes and the leading proto/dport rules for the whole burst
+    uint32_t decided;
+    burst_gather(pkts, nb, &fields);
+    uint32_t ipv4 = burst_classify(&fields, nb, &decided, matches);
+
+    // eBPF prefilter, if one is loaded; its verdicts take precedence over the rules
+    uint32_t bpf_threat = 0, bpf_safe = 0;
+    if (bpf_filter_run(queue_id, pkts, nb, &bpf_threat, &bpf_safe)) {
+        for (uint32_t bits = bpf_threat | bpf_safe; bits; bits &= bits - 1)
+            results[__builtin_ctz(bits)]->rule_id = BPF_FILTER_RULE_ID;
+        decided &= ~(bpf_threat | bpf_safe);
+    }
+    for (uint32_t bits = decided; bits; bits &= bits - 1) {
+        unsigned i = __builtin_ctz(bits);
+        results[i]->rule_id = matches[i];
+    }
+    uint32_t pending = ipv4 & ~decided & ~(bpf_threat | bpf_safe);
+
+    // Remaining IPv4 packets go through one ACL lookup
+    unsigned nb_keys = 0;
+    for (uint32_t bits = pending; bits; bits &= bits - 1) {
+        unsigned i = __builtin_ctz(bits);
+        rules_extract_key(pkts[i], &keys[nb_keys]);
+        key_ptrs[nb_keys] = &keys[nb_keys];
+        key_idx[nb_keys++] = i;
+    }
+    rules_classify(key_ptrs, matches, nb_keys);
+    for (unsigned k = 0; k < nb_keys; k++)
+        results[key_idx[k]]->rule_id = matches[k];
+
+    // Rate-based detection on per-flow state
+    uint64_t now_tsc = rte_get_tsc_cycles();
+    for (unsigned i = 0; i < nb; i++)
+        results[i]->flow_alerts = 0;
+    if (flows) {
+        for (uint32_t bits = ipv4; bits; bits &= bits - 1) {
+            unsigned i = __builtin_ctz(bits);
+            struct flow_key key = {
+                .src_ip = fields.src_ip[i], .dst_ip = fields.dst_ip[i],
+                .src_port = fields.src_port[i], .dst_port = fields.dst_port[i],
+                .proto = fields.proto[i],
+            };
+            results[i]->flow_alerts = flow_table_update(flows, &key, fields.pkt_len[i],
+                                                        fields.tcp_flags[i], now_tsc);
         }
+        flow_table_age(flows, now_tsc);
     }
-}
-//return NULL;
-}
-
 
-FILE *init_csv_file() {
-    FILE *csv_file = fopen("packet_logger.csv", "w");
-    if (!csv_file) {
-        syslog(LOG_ERR, "Failed to open CSV file for writing");
-        exit(EXIT_FAILURE);
+    if (macs && ips) {
+        for (unsigned i = 0; i < nb; i++)
+            hh_update(macs, fields.src_mac[i]);
+        for (uint32_t bits = ipv4; bits; bits &= bits - 1)
+            hh_update(ips, fields.src_ip[__builtin_ctz(bits)]);
+        if (now_tsc >= next_publish) {
+            hh_publish(macs);
+            hh_publish(ips);
+            next_publish = now_tsc + publish_cycles;
+        }
     }
 
-    fprintf(csv_file, "Timestamp,Source MAC,Destination MAC,Threat Status,Detect Delay,Log Delay\n");
-    fflush(csv_file);
-    return csv_file;
-}
-
-
-void logger_service() {
-    static bool initialized = false;
-    static FILE *csv_file = NULL;
-    static uint64_t tsc_hz = 0;
-    static struct log_entry history[MAX_HISTORY];
-    static int history_count = 0;
-    static uint64_t last_refresh_time = 0;
+    // Watermarks on the ring LOGGER drains decide whether SAFE records are shed
+    bool shedding = overload_update(&overload, rte_ring_count(detected_ring));
+
+    now_tsc = rte_get_tsc_cycles(); // Save detection completed time
+    unsigned threats = 0, nb_release = 0, nb_fwd = 0, nb_shed = 0;
+    uint32_t fwd_threat = 0;   // bit n: results[n] after compaction is a THREAT
+    for (unsigned i = 0; i < nb; i++) {
+        struct detection_result *result = results[i];
+        bool threat = (bpf_threat >> i & 1) || rules_action(result->rule_id) == RULE_ACTION_THREAT ||
+                      result->flow_alerts;
+        result->verdict = threat ? LOG_VERDICT_THREAT : LOG_VERDICT_SAFE;
+        threats += threat;
+        result->detect_tsc = now_tsc;
+        lhist_record(rx_to_detect, pkt_latency_ns(result->rx_tsc, now_tsc));
+
+        // Everything downstream needs, from the gathered fields; the header is still in cache
+        const struct rte_ether_hdr *eth = rte_pktmbuf_mtod(pkts[i], const struct rte_ether_hdr *);
+        memcpy(result->src_mac, &fields.src_mac[i], RTE_ETHER_ADDR_LEN);
+        memcpy(result->dst_mac, &eth->dst_addr, RTE_ETHER_ADDR_LEN);
+        result->proto = fields.proto[i];
+        result->pkt_len = fields.pkt_len[i];
+        result->src_port = fields.src_port[i];
+        result->dst_port = fields.dst_port[i];
+        result->src_ip = fields.src_ip[i];
+        result->dst_ip = fields.dst_ip[i];
+        if (threat) {
+            struct alert_event *ev = &alerts[threats - 1];
+            ev->flow = (struct alert_flow){
+                .src_ip = result->src_ip, .dst_ip = result->dst_ip,
+                .src_port = result->src_port, .dst_port = result->dst_port, .proto = result->proto,
+            };
+            memcpy(ev->src_mac, result->src_mac, RTE_ETHER_ADDR_LEN);
+            ev->flow_alerts = result->flow_alerts;
+            ev->queue = queue_id;
+            ev->rule_id = result->rule_id;
+            ev->detect_tsc = now_tsc;
+        }
 
-    if (!initialized) {
-        syslog(LOG_INFO, "[%s] Thread running on core %d", __func__, sched_getcpu());
-        tsc_hz = rte_get_tsc_hz();
-        csv_file = fopen("packet_logger.csv", "w");
-        if (csv_file) {
-            fprintf(csv_file, "Timestamp,Source MAC,Destination MAC,Threat Status,Detect Delay,Log Delay\n");
-            fflush(csv_file);
+        // Both arrays compact in place: nb_fwd + nb_shed == i
+        bool keep = retain_policy == RETAIN_ALL || (threat && retain_policy == RETAIN_THREATS);
+        if (!threat && shedding && overload_shed(&overload, result->pkt_len, now_tsc)) {
+            shed[nb_shed++] = result;
+            keep = false;
+        } else {
+            fwd_threat |= (uint32_t)threat << nb_fwd;
+            results[nb_fwd++] = result;
         }
-        initscr();
-        cbreak();
-        noecho();
-        curs_set(FALSE);
-        nodelay(stdscr, TRUE);
-        start_color();
-        init_pair(1, COLOR_RED, COLOR_BLACK);
-        init_pair(2, COLOR_GREEN, COLOR_BLACK);
-        initialized = true;
+        if (keep)
+            continue;
+        pkts[nb_release++] = pkts[i];   // compacts in place, i >= nb_release
+        result->mbuf = NULL;
+    }
+    // Wake the alert thread before anything else happens to the burst
+    if (threats) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        for (unsigned t = 0; t < threats; t++)
+            alerts[t].wall_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        alert_raise(alerts, threats);
     }
 
-    struct detection_result *result = NULL;
-    if (rte_ring_dequeue(detected_ring, (void **)&result) == 0 && result != NULL) {
-        struct rte_ether_hdr *eth_hdr = rte_pktmbuf_mtod(result->mbuf, struct rte_ether_hdr *);
-        char src_mac[32], dst_mac[32];
-        rte_ether_format_addr(src_mac, sizeof(src_mac), &eth_hdr->src_addr);
-        rte_ether_format_addr(dst_mac, sizeof(dst_mac), &eth_hdr->dst_addr);
-
-        time_t now_sec = time(NULL);
-        struct tm *tm_info = localtime(&now_sec);
-        char timestamp[32];
-        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
+    // Back to the pool now instead of after LOGGER's next release
+    if (nb_release)
+        rte_pktmbuf_free_bulk(pkts, nb_release);
+    if (nb_shed) {
+        rte_mempool_generic_put(result_pool, (void **)shed, nb_shed, cache);
+        stats->shed += nb_shed;
+    }
 
-        uint64_t now_tsc = rte_get_tsc_cycles();
-        uint64_t detect_delay_cycles = result->detect_tsc - result->rx_tsc;
-        uint64_t log_delay_cycles = now_tsc - result->detect_tsc;
+    stats->threats += threats;
+    stats->overloads = overload.episodes;
+
+    // THREAT verdicts first, in order, into the lane LOGGER drains before
+    // anything else. Whatever the lane cannot take stays at the front of the
+    // detected_ring batch, so a full ring drops SAFE records first.
+    unsigned nb_lane = 0, nb_fwd_threats = __builtin_popcount(fwd_threat);
+    if (nb_fwd_threats) {
+        struct detection_result *safe[BURST_SIZE];
+        unsigned t = 0, s = 0;
+        for (unsigned i = 0; i < nb_fwd; i++) {
+            if (fwd_threat >> i & 1)
+                results[t++] = results[i];
+            else
+                safe[s++] = results[i];
+        }
+        memcpy(&results[t], safe, s * sizeof(safe[0]));
+        nb_lane = rte_ring_enqueue_burst(threat_ring, (void **)results, t, NULL);
+        stats->threat_spills += t - nb_lane;
+    }
+    unsigned nb_fifo = nb_fwd - nb_lane;
+    unsigned sent = rte_ring_enqueue_burst(detected_ring, (void **)&results[nb_lane], nb_fifo, NULL);
+    if (sent < nb_fifo) {
+        // THREAT records are the first nb_fwd_threats of the batch
+        unsigned first_drop = nb_lane + sent;
+        stats->drops += nb_fifo - sent;
+        stats->threat_drops += nb_fwd_threats > first_drop ? nb_fwd_threats - first_drop : 0;
+        for (unsigned i = first_drop; i < nb_fwd; i++)
+            rte_pktmbuf_free(results[i]->mbuf);
+        rte_mempool_generic_put(result_pool, (void **)&results[first_drop], nb_fifo - sent, cache);
+    }
+    if (overload_summary_due(&overload, now_tsc))
+        send_overload_summary(&overload, stats, cache, now_tsc);
+}
+    bpf_filter_offline(queue_id);
+    stage_cache_put(cache, own_cache);
+//return NULL;
+}
 
-        long detect_delay_ms = (detect_delay_cycles * 1000) / tsc_hz;
-        long log_delay_ms = (log_delay_cycles * 1000) / tsc_hz;
 
-        if (history_count >= MAX_HISTORY) {
-            memmove(&history[0], &history[1], sizeof(struct log_entry) * (MAX_HISTORY - 1));
-            history_count = MAX_HISTORY - 1;
-        }
+int format_top_talkers(char *buf, size_t len, unsigned n) {
+    struct hh_entry top[HH_TOPK];
+    int off = 0;
+
+    if (n > HH_TOPK)
+        n = HH_TOPK;
+    unsigned nm = hh_merge_snapshots(top_src_mac, nb_rx_queues, top, n);
+    off += snprintf(buf + off, len - off, "Top source MACs:\n");
+    for (unsigned i = 0; i < nm && (size_t)off < len; i++) {
+        struct rte_ether_addr addr;
+        char mac[RTE_ETHER_ADDR_FMT_SIZE];
+        memcpy(&addr, &top[i].key, RTE_ETHER_ADDR_LEN);
+        rte_ether_format_addr(mac, sizeof(mac), &addr);
+        off += snprintf(buf + off, len - off, "  %-17s %" PRIu64 " pkts (+/-%" PRIu64 ")\n",
+                        mac, top[i].count, top[i].error);
+    }
 
-        strncpy(history[history_count].timestamp, timestamp, sizeof(timestamp));
-        strncpy(history[history_count].src_mac, src_mac, sizeof(src_mac));
-        strncpy(history[history_count].dst_mac, dst_mac, sizeof(dst_mac));
-        strncpy(history[history_count].threat_status, result->threat_status, sizeof(result->threat_status));
-        history[history_count].detect_delay_ms = detect_delay_ms;
-        history[history_count].log_delay_ms = log_delay_ms;
-        history_count++;
-
-        if (csv_file) {
-            fprintf(csv_file, "%s,%s,%s,%s,%ldms,%ldms\n",
-                    timestamp, src_mac, dst_mac, result->threat_status,
-                    detect_delay_ms, log_delay_ms);
-            fflush(csv_file);
-        }
+    unsigned ni = hh_merge_snapshots(top_src_ip, nb_rx_queues, top, n);
+    if ((size_t)off < len)
+        off += snprintf(buf + off, len - off, "Top source IPs:\n");
+    for (unsigned i = 0; i < ni && (size_t)off < len; i++) {
+        const uint8_t *ip = (const uint8_t *)&top[i].key;   // network byte order
+        off += snprintf(buf + off, len - off, "  %u.%u.%u.%u %" PRIu64 " pkts (+/-%" PRIu64 ")\n",
+                        ip[0], ip[1], ip[2], ip[3], top[i].count, top[i].error);
+    }
+    return (size_t)off < len ? off : (int)len - 1;
+}
 
-        rte_pktmbuf_free(result->mbuf);
-        free(result);
+// Dashboard feed, called on the dashboard thread at each refresh
+static void pipeline_counters(struct dashboard_counters *c) {
+    for (uint16_t q = 0; q < nb_rx_queues; q++) {
+        c->rx_packets += rx_stats[q].objs;
+        c->threats += detect_stats[q].threats;
+        c->drops += rx_stats[q].drops + detect_stats[q].drops + result_pool_exhausted[q];
     }
+    struct rte_eth_stats stats;
+    if (rte_eth_stats_get(port_id, &stats) == 0)
+        c->drops += stats.imissed + stats.rx_nombuf;
+    c->logged = logger_stats.objs + threat_lane_stats.objs;
+}
 
-    // Refresh ncurses screen every 100ms
-    uint64_t now = rte_get_timer_cycles();
-    uint64_t hz = rte_get_timer_hz();
-    if ((now - last_refresh_time) > (hz / 1)) { // 10ms
-        clear();
-        mvprintw(0, 0, "Timestamp              SourceMAC           DestinationMAC      Threat    DetectDelay  LogDelay");
-        for (int i = 0; i < history_count; i++) {
-            if (strcmp(history[i].threat_status, "THREAT") == 0) {
-                attron(COLOR_PAIR(1));
-            } else {
-                attron(COLOR_PAIR(2));
-            }
-            mvprintw(i + 1, 0, "%s  %s -> %s     %s         %ldms        %ldms",
-                     history[i].timestamp,
-                     history[i].src_mac,
-                     history[i].dst_mac,
-                     history[i].threat_status,
-                     history[i].detect_delay_ms,
-                     history[i].log_delay_ms);
-            attroff(COLOR_PAIR(1));
-            attroff(COLOR_PAIR(2));
-        }
-        refresh();
-        last_refresh_time = now;
+static int pipeline_footer(char *buf, size_t len) {
+    int off = 0;
+    for (int s = 0; s < PKT_LAT_STAGES && (size_t)off < len; s++) {
+        struct pkt_latency_summary lat;
+        pkt_latency_summarize(s, &lat);
+        off += snprintf(buf + off, len - off, "%-14s p50 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n",
+                        pkt_latency_stage_name(s), lat.p50 / 1e3, lat.p99 / 1e3, lat.p999 / 1e3, lat.max / 1e3);
     }
+    if ((size_t)off < len)
+        off += format_top_talkers(buf + off, len - off, 3);
+    return (size_t)off < len ? off : (int)len - 1;
 }
 
+const struct dashboard_source pipeline_dashboard = {
+    .counters = pipeline_counters,
+    .footer = pipeline_footer,
+};
 
 
+// Log one burst from ring; returns how many records it took
+static unsigned logger_burst(struct rte_ring *ring, struct stage_stats *stats,
+                             struct rte_mempool_cache *cache) {
+    struct detection_result *results[BURST_SIZE];
+    struct rte_mbuf *retained[BURST_SIZE];
+    struct log_record records[BURST_SIZE];
+    unsigned nb_retained = 0;
+    unsigned nb = rte_ring_dequeue_burst(ring, (void **)results, BURST_SIZE, NULL);
+    stage_stats_update(stats, nb);
+    if (nb == 0)
+        return 0;
+
+    // Raw fields only: text formatting and file I/O happen on the writer thread
+    // (and offline in logbin2csv.py), the screen on the dashboard thread
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t wall_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    uint64_t now_tsc = rte_get_tsc_cycles();
+
+    for (unsigned i = 0; i < nb; i++) {
+        struct detection_result *result = results[i];
+        struct log_record *rec = &records[i];
+
+        // The summary is all there is: DETECT has usually freed the packet
+        memcpy(rec->src_mac, result->src_mac, RTE_ETHER_ADDR_LEN);
+        memcpy(rec->dst_mac, result->dst_mac, RTE_ETHER_ADDR_LEN);
+        rec->wall_ns = wall_ns;
+        rec->rule_id = result->rule_id;
+        rec->flow_alerts = result->flow_alerts;
+        rec->verdict = result->verdict;
+        memset(rec->reserved, 0, sizeof(rec->reserved));
+        if (rec->verdict == LOG_VERDICT_SUMMARY) {
+            rec->summary_packets = result->shed_packets;
+            rec->summary_bytes = result->shed_bytes;
+            continue;   // no packet, no latency
+        }
+        rec->detect_delay_ns = pkt_latency_ns(result->rx_tsc, result->detect_tsc);
+        rec->log_delay_ns = pkt_latency_ns(result->detect_tsc, now_tsc);
+        lhist_record(&pkt_lat_detect_to_log.hist, rec->log_delay_ns);
+        lhist_record(&pkt_lat_end_to_end.hist, pkt_latency_ns(result->rx_tsc, now_tsc));
+        if (rec->verdict == LOG_VERDICT_THREAT)
+            lhist_record(&pkt_lat_threat_to_log.hist, rec->log_delay_ns);
+
+        if (result->mbuf)
+            retained[nb_retained++] = result->mbuf;
+    }
 
+    log_writer_push(records, nb);
+    dashboard_push(records, nb);
+    // Retained packets go to the capture file; whatever it cannot queue is freed here
+    unsigned queued = nb_retained ? log_writer_capture(retained, nb_retained, wall_ns) : 0;
+    if (queued < nb_retained)
+        rte_pktmbuf_free_bulk(retained + queued, nb_retained - queued);
+    rte_mempool_generic_put(result_pool, (void **)results, nb, cache);
+    return nb;
+}
 
-void led_service() {
+void logger_service() {
     static bool initialized = false;
-    static int blink_counter = 0;
-    
+    static struct rte_mempool_cache *cache = NULL;
+    static bool own_cache;
+
     if (!initialized) {
         syslog(LOG_INFO, "[%s] Thread running on core %d", __func__, sched_getcpu());
+        cache = stage_cache_get(&own_cache);
         initialized = true;
-        //printf("[LED] LED service initialized\n");
     }
 
-   if (!threat_detected) {
-        blink_counter++;
-        if (blink_counter >= 10) {
-            blink_counter = 0;
-            //syslog(LOG_INFO, "[%s] Thread running on core %d", __func__, sched_getcpu());
-    } else {
-        //syslog(LOG_INFO, "[%s] Thread running on core %d", __func__, sched_getcpu());
-    }
+    // Drain whole bursts until the ring is empty or the release budget is spent.
+    // Before every burst of detected_ring the threat lane is polled, so an
+    // alert never waits behind SAFE traffic for longer than one burst. Draining
+    // the lane ignores the budget; only the repeat polls are capped, at one
+    // ring's worth of records taken per release, so a THREAT flood cannot hold
+    // the core for the whole period.
+    uint64_t items = 0;
+    unsigned nb, backlog = rte_ring_count(detected_ring);
+    unsigned threats_taken = 0;
+    if (backlog > logger_stats.backlog_max)
+        logger_stats.backlog_max = backlog;
+    do {
+        unsigned nb_threats;
+        do {
+            nb_threats = logger_burst(threat_ring, &threat_lane_stats, cache);
+            items += nb_threats;
+            threats_taken += nb_threats;
+        } while (nb_threats == BURST_SIZE && threats_taken < THREAT_RING_SIZE);
+        nb = logger_burst(detected_ring, &logger_stats, cache);
+        items += nb;
+    } while (nb == BURST_SIZE && service_budget_left());
+    service_report_items(items, rte_ring_count(detected_ring) + rte_ring_count(threat_ring));
 }
-}
-
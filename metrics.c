@@ -0,0 +1,303 @@
+// metrics.c
+#define _GNU_SOURCE
+#include "metrics.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_cycles.h>
+#include <rte_ethdev.h>
+#include <rte_ring.h>
+
+// Totals at the start of the current pps window
+static struct {
+    uint64_t tsc, rx, detect;
+    double rx_pps, detect_pps;
+} window;
+
+void metrics_collect(struct metrics_snapshot *m) {
+    memset(m, 0, sizeof(*m));
+    m->nb_queues = nb_rx_queues;
+    for (uint16_t q = 0; q < nb_rx_queues; q++) {
+        struct metrics_queue *mq = &m->queues[q];
+        mq->rx_packets = rx_stats[q].objs;
+        mq->rx_drops = rx_stats[q].drops;
+        mq->pool_exhausted = result_pool_exhausted[q];
+        mq->detect_packets = detect_stats[q].objs;
+        mq->detect_drops = detect_stats[q].drops;
+        mq->threat_drops = detect_stats[q].threat_drops;
+        mq->shed = detect_stats[q].shed;
+        mq->threats = detect_stats[q].threats;
+        if (packet_rings[q]) {
+            mq->ring_used = rte_ring_count(packet_rings[q]);
+            mq->ring_size = rte_ring_get_capacity(packet_rings[q]);
+        }
+        m->rx_packets += mq->rx_packets;
+        m->detect_packets += mq->detect_packets;
+        m->threats += mq->threats;
+    }
+    m->logged = logger_stats.objs + threat_lane_stats.objs;
+    m->threat_lane_polls = threat_lane_stats.polls;
+    m->threat_lane_bursts = threat_lane_stats.bursts;
+    m->threat_lane_logged = threat_lane_stats.objs;
+
+    // Rates over at least METRICS_RATE_MIN_MS, so back-to-back scrapes do
+    // not divide by a few microseconds
+    uint64_t now = rte_get_tsc_cycles(), hz = rte_get_tsc_hz();
+    if (window.tsc == 0) {
+        window.tsc = now;
+        window.rx = m->rx_packets;
+        window.detect = m->detect_packets;
+    } else if (now - window.tsc >= hz * METRICS_RATE_MIN_MS / 1000) {
+        double s = (double)(now - window.tsc) / hz;
+        window.rx_pps = (m->rx_packets - window.rx) / s;
+        window.detect_pps = (m->detect_packets - window.detect) / s;
+        window.tsc = now;
+        window.rx = m->rx_packets;
+        window.detect = m->detect_packets;
+    }
+    m->rx_pps = window.rx_pps;
+    m->detect_pps = window.detect_pps;
+
+    struct rte_eth_stats stats;
+    if (rte_eth_stats_get(port_id, &stats) == 0) {
+        m->port_ok = 1;
+        m->port_ipackets = stats.ipackets;
+        m->port_imissed = stats.imissed;
+        m->port_ierrors = stats.ierrors;
+        m->port_rx_nombuf = stats.rx_nombuf;
+    }
+    if (detected_ring) {
+        m->detected_used = rte_ring_count(detected_ring);
+        m->detected_size = rte_ring_get_capacity(detected_ring);
+    }
+    if (threat_ring) {
+        m->threat_used = rte_ring_count(threat_ring);
+        m->threat_size = rte_ring_get_capacity(threat_ring);
+    }
+    log_writer_get_stats(&m->log);
+    for (int s = 0; s < PKT_LAT_STAGES; s++)
+        pkt_latency_summarize(s, &m->latency[s]);
+    m->nb_bpf = bpf_filter_get_stats(m->bpf, BPF_FILTER_HISTORY);
+    m->nb_services = service_get_metrics(m->services, METRICS_MAX_SERVICES);
+}
+
+// Bounded appender; output past the end is dropped, the string stays terminated
+struct out {
+    char *buf;
+    size_t len, off;
+};
+
+__attribute__((format(printf, 2, 3)))
+static void put(struct out *o, const char *fmt, ...) {
+    if (o->off + 1 >= o->len)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->off, o->len - o->off, fmt, ap);
+    va_end(ap);
+    if (n > 0)
+        o->off = o->off + n < o->len ? o->off + n : o->len - 1;
+}
+
+static void prom_head(struct out *o, const char *name, const char *type, const char *help) {
+    put(o, "# HELP packet_logger_%s %s\n# TYPE packet_logger_%s %s\n", name, help, name, type);
+}
+
+// One counter per RX queue, picked out of struct metrics_queue by offset
+static void prom_per_queue(struct out *o, const struct metrics_snapshot *m, const char *name,
+                           const char *help, size_t field) {
+    prom_head(o, name, "counter", help);
+    for (uint16_t q = 0; q < m->nb_queues; q++)
+        put(o, "packet_logger_%s{queue=\"%u\"} %" PRIu64 "\n", name, q,
+            *(const uint64_t *)((const char *)&m->queues[q] + field));
+}
+
+size_t metrics_format_prometheus(const struct metrics_snapshot *m, char *buf, size_t len) {
+    struct out o = { buf, len, 0 };
+    if (len)
+        buf[0] = '\0';
+
+    prom_per_queue(&o, m, "rx_packets_total", "Packets received per RX queue",
+                   offsetof(struct metrics_queue, rx_packets));
+    prom_per_queue(&o, m, "rx_ring_full_drops_total", "Packets dropped by RX because the packet ring was full",
+                   offsetof(struct metrics_queue, rx_drops));
+    prom_per_queue(&o, m, "descriptor_pool_exhausted_total", "Packets dropped by RX for lack of a descriptor",
+                   offsetof(struct metrics_queue, pool_exhausted));
+    prom_per_queue(&o, m, "detect_packets_total", "Packets classified per detect queue",
+                   offsetof(struct metrics_queue, detect_packets));
+    prom_per_queue(&o, m, "detect_ring_full_drops_total", "Packets dropped by DETECT because the detected ring was full",
+                   offsetof(struct metrics_queue, detect_drops));
+    prom_per_queue(&o, m, "detect_ring_full_threat_drops_total", "THREAT records among the detected ring drops",
+                   offsetof(struct metrics_queue, threat_drops));
+    prom_per_queue(&o, m, "overload_shed_total", "SAFE records shed by DETECT under overload",
+                   offsetof(struct metrics_queue, shed));
+    prom_per_queue(&o, m, "threats_total", "Packets judged THREAT",
+                   offsetof(struct metrics_queue, threats));
+
+    prom_head(&o, "rx_pps", "gauge", "RX rate over the last window, all queues");
+    put(&o, "packet_logger_rx_pps %.0f\n", m->rx_pps);
+    prom_head(&o, "detect_pps", "gauge", "DETECT rate over the last window, all queues");
+    put(&o, "packet_logger_detect_pps %.0f\n", m->detect_pps);
+    prom_head(&o, "logged_packets_total", "counter", "Packets handed to the log writer");
+    put(&o, "packet_logger_logged_packets_total %" PRIu64 "\n", m->logged);
+    prom_head(&o, "log_dropped_total", "counter", "Log records dropped because the writer ring was full");
+    put(&o, "packet_logger_log_dropped_total %" PRIu64 "\n", m->log.dropped);
+
+    if (m->port_ok) {
+        prom_head(&o, "port_ipackets_total", "counter", "Packets received by the port");
+        put(&o, "packet_logger_port_ipackets_total %" PRIu64 "\n", m->port_ipackets);
+        prom_head(&o, "port_imissed_total", "counter", "Packets the port dropped because the RX queue was full");
+        put(&o, "packet_logger_port_imissed_total %" PRIu64 "\n", m->port_imissed);
+        prom_head(&o, "port_ierrors_total", "counter", "Erroneous packets received by the port");
+        put(&o, "packet_logger_port_ierrors_total %" PRIu64 "\n", m->port_ierrors);
+        prom_head(&o, "port_rx_nombuf_total", "counter", "RX mbuf allocation failures");
+        put(&o, "packet_logger_port_rx_nombuf_total %" PRIu64 "\n", m->port_rx_nombuf);
+    }
+
+    prom_head(&o, "ring_used", "gauge", "Objects waiting in a ring");
+    for (uint16_t q = 0; q < m->nb_queues; q++)
+        put(&o, "packet_logger_ring_used{ring=\"packet_%u\"} %u\n", q, m->queues[q].ring_used);
+    put(&o, "packet_logger_ring_used{ring=\"detected\"} %u\n", m->detected_used);
+    put(&o, "packet_logger_ring_used{ring=\"threat\"} %u\n", m->threat_used);
+    prom_head(&o, "ring_capacity", "gauge", "Ring capacity");
+    for (uint16_t q = 0; q < m->nb_queues; q++)
+        put(&o, "packet_logger_ring_capacity{ring=\"packet_%u\"} %u\n", q, m->queues[q].ring_size);
+    put(&o, "packet_logger_ring_capacity{ring=\"detected\"} %u\n", m->detected_size);
+    put(&o, "packet_logger_ring_capacity{ring=\"threat\"} %u\n", m->threat_size);
+    prom_head(&o, "threat_lane_polls_total", "counter", "LOGGER dequeue attempts on the threat lane");
+    put(&o, "packet_logger_threat_lane_polls_total %" PRIu64 "\n", m->threat_lane_polls);
+    prom_head(&o, "threat_lane_bursts_total", "counter", "Threat lane dequeues that returned records");
+    put(&o, "packet_logger_threat_lane_bursts_total %" PRIu64 "\n", m->threat_lane_bursts);
+    prom_head(&o, "threat_lane_logged_total", "counter", "THREAT records LOGGER took from the threat lane");
+    put(&o, "packet_logger_threat_lane_logged_total %" PRIu64 "\n", m->threat_lane_logged);
+
+    prom_head(&o, "latency_seconds", "summary", "Per-packet latency by pipeline stage");
+    for (int s = 0; s < PKT_LAT_STAGES; s++) {
+        const struct pkt_latency_summary *l = &m->latency[s];
+        const char *stage = pkt_latency_stage_name(s);
+        put(&o, "packet_logger_latency_seconds{stage=\"%s\",quantile=\"0.5\"} %.9f\n", stage, l->p50 / 1e9);
+        put(&o, "packet_logger_latency_seconds{stage=\"%s\",quantile=\"0.99\"} %.9f\n", stage, l->p99 / 1e9);
+        put(&o, "packet_logger_latency_seconds{stage=\"%s\",quantile=\"0.999\"} %.9f\n", stage, l->p999 / 1e9);
+        put(&o, "packet_logger_latency_seconds{stage=\"%s\",quantile=\"1\"} %.9f\n", stage, l->max / 1e9);
+        put(&o, "packet_logger_latency_seconds_sum{stage=\"%s\"} %.9f\n", stage, l->sum / 1e9);
+        put(&o, "packet_logger_latency_seconds_count{stage=\"%s\"} %" PRIu64 "\n", stage, l->count);
+    }
+
+    if (m->nb_bpf) {
+        prom_head(&o, "bpf_packets_total", "counter", "Packets run through an eBPF prefilter program");
+        for (unsigned i = 0; i < m->nb_bpf; i++)
+            put(&o, "packet_logger_bpf_packets_total{program=\"%s\",generation=\"%u\"} %" PRIu64 "\n",
+                m->bpf[i].name, m->bpf[i].generation, m->bpf[i].packets);
+        prom_head(&o, "bpf_verdicts_total", "counter", "Packets an eBPF prefilter program decided");
+        for (unsigned i = 0; i < m->nb_bpf; i++) {
+            const struct bpf_filter_stats *b = &m->bpf[i];
+            put(&o, "packet_logger_bpf_verdicts_total{program=\"%s\",generation=\"%u\",verdict=\"threat\"} %"
+                PRIu64 "\n", b->name, b->generation, b->threats);
+            put(&o, "packet_logger_bpf_verdicts_total{program=\"%s\",generation=\"%u\",verdict=\"safe\"} %"
+                PRIu64 "\n", b->name, b->generation, b->safe);
+        }
+        prom_head(&o, "bpf_ns_per_packet", "gauge", "Mean execution time of an eBPF prefilter program");
+        for (unsigned i = 0; i < m->nb_bpf; i++)
+            put(&o, "packet_logger_bpf_ns_per_packet{program=\"%s\",generation=\"%u\",mode=\"%s\"} %.1f\n",
+                m->bpf[i].name, m->bpf[i].generation, m->bpf[i].jit ? "jit" : "interpreter", m->bpf[i].ns_per_packet);
+        prom_head(&o, "bpf_active", "gauge", "1 for the eBPF prefilter program DETECT runs now");
+        for (unsigned i = 0; i < m->nb_bpf; i++)
+            put(&o, "packet_logger_bpf_active{program=\"%s\",generation=\"%u\"} %d\n",
+                m->bpf[i].name, m->bpf[i].generation, m->bpf[i].active);
+    }
+
+    prom_head(&o, "service_executions_total", "counter", "Completed releases of a periodic service");
+    for (unsigned i = 0; i < m->nb_services; i++)
+        put(&o, "packet_logger_service_executions_total{service=\"%s\"} %" PRIu64 "\n",
+            m->services[i].name, m->services[i].releases);
+    prom_head(&o, "service_missed_releases_total", "counter", "Releases dropped because the previous one had not started");
+    for (unsigned i = 0; i < m->nb_services; i++)
+        put(&o, "packet_logger_service_missed_releases_total{service=\"%s\"} %" PRIu64 "\n",
+            m->services[i].name, m->services[i].missed);
+    prom_head(&o, "service_overruns_total", "counter", "Releases that found the previous execution still running");
+    for (unsigned i = 0; i < m->nb_services; i++)
+        put(&o, "packet_logger_service_overruns_total{service=\"%s\"} %" PRIu64 "\n",
+            m->services[i].name, m->services[i].overruns);
+    prom_head(&o, "service_exec_seconds", "summary", "Execution time per release");
+    for (unsigned i = 0; i < m->nb_services; i++) {
+        const struct service_metrics *sv = &m->services[i];
+        put(&o, "packet_logger_service_exec_seconds{service=\"%s\",quantile=\"0.5\"} %.9f\n", sv->name, sv->exec_p50_ns / 1e9);
+        put(&o, "packet_logger_service_exec_seconds{service=\"%s\",quantile=\"0.99\"} %.9f\n", sv->name, sv->exec_p99_ns / 1e9);
+        put(&o, "packet_logger_service_exec_seconds{service=\"%s\",quantile=\"1\"} %.9f\n", sv->name, sv->exec_max_ns / 1e9);
+        put(&o, "packet_logger_service_exec_seconds_sum{service=\"%s\"} %.9f\n", sv->name, sv->exec_sum_ns / 1e9);
+        put(&o, "packet_logger_service_exec_seconds_count{service=\"%s\"} %" PRIu64 "\n", sv->name, sv->releases);
+    }
+    prom_head(&o, "service_release_jitter_seconds", "summary", "Release to start latency");
+    for (unsigned i = 0; i < m->nb_services; i++) {
+        const struct service_metrics *sv = &m->services[i];
+        put(&o, "packet_logger_service_release_jitter_seconds{service=\"%s\",quantile=\"0.5\"} %.9f\n", sv->name, sv->jitter_p50_ns / 1e9);
+        put(&o, "packet_logger_service_release_jitter_seconds{service=\"%s\",quantile=\"0.99\"} %.9f\n", sv->name, sv->jitter_p99_ns / 1e9);
+        put(&o, "packet_logger_service_release_jitter_seconds{service=\"%s\",quantile=\"1\"} %.9f\n", sv->name, sv->jitter_max_ns / 1e9);
+        put(&o, "packet_logger_service_release_jitter_seconds_sum{service=\"%s\"} %.9f\n", sv->name, sv->jitter_sum_ns / 1e9);
+        put(&o, "packet_logger_service_release_jitter_seconds_count{service=\"%s\"} %" PRIu64 "\n", sv->name, sv->jitter_count);
+    }
+    return o.off;
+}
+
+size_t metrics_format_json(const struct metrics_snapshot *m, char *buf, size_t len) {
+    struct out o = { buf, len, 0 };
+    if (len)
+        buf[0] = '\0';
+
+    put(&o, "{\"rx_packets\":%" PRIu64 ",\"detect_packets\":%" PRIu64 ",\"threats\":%" PRIu64
+        ",\"logged\":%" PRIu64 ",\"rx_pps\":%.0f,\"detect_pps\":%.0f,\"queues\":[",
+        m->rx_packets, m->detect_packets, m->threats, m->logged, m->rx_pps, m->detect_pps);
+    for (uint16_t q = 0; q < m->nb_queues; q++) {
+        const struct metrics_queue *mq = &m->queues[q];
+        put(&o, "%s{\"queue\":%u,\"rx_packets\":%" PRIu64 ",\"rx_ring_full_drops\":%" PRIu64
+            ",\"pool_exhausted\":%" PRIu64 ",\"detect_packets\":%" PRIu64 ",\"detect_ring_full_drops\":%" PRIu64
+            ",\"threat_drops\":%" PRIu64 ",\"overload_shed\":%" PRIu64
+            ",\"threats\":%" PRIu64 ",\"ring_used\":%u,\"ring_capacity\":%u}",
+            q ? "," : "", q, mq->rx_packets, mq->rx_drops, mq->pool_exhausted, mq->detect_packets,
+            mq->detect_drops, mq->threat_drops, mq->shed, mq->threats, mq->ring_used, mq->ring_size);
+    }
+    put(&o, "],\"detected_ring\":{\"used\":%u,\"capacity\":%u}", m->detected_used, m->detected_size);
+    put(&o, ",\"threat_ring\":{\"used\":%u,\"capacity\":%u,\"polls\":%" PRIu64 ",\"bursts\":%" PRIu64
+        ",\"logged\":%" PRIu64 "}", m->threat_used, m->threat_size, m->threat_lane_polls,
+        m->threat_lane_bursts, m->threat_lane_logged);
+    if (m->port_ok)
+        put(&o, ",\"port\":{\"ipackets\":%" PRIu64 ",\"imissed\":%" PRIu64 ",\"ierrors\":%" PRIu64
+            ",\"rx_nombuf\":%" PRIu64 "}", m->port_ipackets, m->port_imissed, m->port_ierrors, m->port_rx_nombuf);
+    put(&o, ",\"log\":{\"records\":%" PRIu64 ",\"dropped\":%" PRIu64 ",\"writes\":%" PRIu64 ",\"bytes\":%" PRIu64 "}",
+        m->log.records, m->log.dropped, m->log.writes, m->log.bytes);
+
+    put(&o, ",\"latency_us\":{");
+    for (int s = 0; s < PKT_LAT_STAGES; s++) {
+        const struct pkt_latency_summary *l = &m->latency[s];
+        put(&o, "%s\"%s\":{\"count\":%" PRIu64 ",\"p50\":%.3f,\"p99\":%.3f,\"p99_9\":%.3f,\"max\":%.3f}",
+            s ? "," : "", pkt_latency_stage_name(s), l->count, l->p50 / 1e3, l->p99 / 1e3,
+            l->p999 / 1e3, l->max / 1e3);
+    }
+
+    put(&o, "},\"bpf\":[");
+    for (unsigned i = 0; i < m->nb_bpf; i++) {
+        const struct bpf_filter_stats *b = &m->bpf[i];
+        put(&o, "%s{\"program\":\"%s\",\"generation\":%u,\"mode\":\"%s\",\"active\":%s,\"packets\":%" PRIu64
+            ",\"threats\":%" PRIu64 ",\"safe\":%" PRIu64 ",\"ns_per_packet\":%.1f}",
+            i ? "," : "", b->name, b->generation, b->jit ? "jit" : "interpreter", b->active ? "true" : "false",
+            b->packets, b->threats, b->safe, b->ns_per_packet);
+    }
+
+    put(&o, "],\"services\":[");
+    for (unsigned i = 0; i < m->nb_services; i++) {
+        const struct service_metrics *sv = &m->services[i];
+        put(&o, "%s{\"name\":\"%s\",\"core\":%u,\"priority\":%u,\"period_us\":%u,\"budget_us\":%u"
+            ",\"executions\":%" PRIu64 ",\"missed\":%" PRIu64 ",\"overruns\":%" PRIu64
+            ",\"exec_us\":{\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}"
+            ",\"release_jitter_us\":{\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}}",
+            i ? "," : "", sv->name, sv->core, sv->priority, sv->period_us, sv->budget_us,
+            sv->releases, sv->missed, sv->overruns,
+            sv->exec_p50_ns / 1e3, sv->exec_p99_ns / 1e3, sv->exec_max_ns / 1e3,
+            sv->jitter_p50_ns / 1e3, sv->jitter_p99_ns / 1e3, sv->jitter_max_ns / 1e3);
+    }
+    put(&o, "]}\n");
+    return o.off;
+}
@@ -0,0 +1,72 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "packet_logger.h"
+#include "log_writer.h"
+#include "pkt_latency.h"
+#include "bpf_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pipeline metrics for the HTTP endpoint of server_service.c. Nothing on the
+// data path changes for a scrape: every counter is owned by one stage
+// (stage_stats, result_pool_exhausted, the latency histograms, the Service
+// statistics) and is only summed and formatted here, at scrape time, by the
+// thread serving the request.
+
+#define METRICS_MAX_SERVICES 16
+#define METRICS_RATE_MIN_MS  1000   // shortest window for the pps gauges
+
+struct metrics_queue {
+    uint64_t rx_packets;
+    uint64_t rx_drops;              // packet ring full
+    uint64_t pool_exhausted;        // no descriptor for the burst
+    uint64_t detect_packets;
+    uint64_t detect_drops;          // detected ring full
+    uint64_t threat_drops;          // THREAT records among detect_drops
+    uint64_t shed;                  // SAFE records shed under overload
+    uint64_t threats;
+    unsigned ring_used, ring_size;  // packet ring
+};
+
+struct metrics_snapshot {
+    uint16_t nb_queues;
+    struct metrics_queue queues[MAX_RX_QUEUES];
+
+    // Totals over all queues, and their rates over the last window
+    uint64_t rx_packets, detect_packets, threats, logged;
+    double rx_pps, detect_pps;
+
+    int port_ok;                    // rte_eth_stats_get() succeeded
+    uint64_t port_ipackets, port_imissed, port_ierrors, port_rx_nombuf;
+
+    unsigned detected_used, detected_size;
+    unsigned threat_used, threat_size;
+    uint64_t threat_lane_polls, threat_lane_bursts, threat_lane_logged;   // LOGGER on threat_ring
+    struct log_writer_stats log;
+    struct pkt_latency_summary latency[PKT_LAT_STAGES];
+    unsigned nb_bpf;                // eBPF prefilter programs, active one first
+    struct bpf_filter_stats bpf[BPF_FILTER_HISTORY];
+
+    unsigned nb_services;
+    struct service_metrics services[METRICS_MAX_SERVICES];
+};
+
+// Gather every counter once. Not reentrant: the pps window is shared, so
+// call it from one thread (the server service).
+void metrics_collect(struct metrics_snapshot *m);
+
+// Format a snapshot; both return the length written (truncated to len - 1)
+size_t metrics_format_prometheus(const struct metrics_snapshot *m, char *buf, size_t len);
+size_t metrics_format_json(const struct metrics_snapshot *m, char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // METRICS_H_
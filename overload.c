@@ -0,0 +1,67 @@
+// overload.c
+#include "overload.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_cycles.h>
+
+static int parse_fields(const char *spec, uint32_t *const fields[], unsigned max) {
+    for (unsigned i = 0; i < max && *spec == ':'; i++) {
+        int used;
+        if (sscanf(spec + 1, "%u%n", fields[i], &used) != 1)
+            return -1;
+        spec += 1 + used;
+    }
+    return *spec == '\0' ? 0 : -1;
+}
+
+int overload_parse(const char *spec, struct overload_config *cfg) {
+    static const char *const names[] = { "none", "sample", "summarize" };
+    *cfg = (struct overload_config){
+        .policy = OVERLOAD_NONE,
+        .high_pct = OVERLOAD_HIGH_PCT,
+        .low_pct = OVERLOAD_LOW_PCT,
+        .sample_every = OVERLOAD_SAMPLE_EVERY,
+    };
+
+    unsigned p;
+    size_t len = 0;
+    for (p = 0; p < sizeof(names) / sizeof(names[0]); p++) {
+        len = strlen(names[p]);
+        if (strncmp(spec, names[p], len) == 0 && (spec[len] == '\0' || spec[len] == ':'))
+            break;
+    }
+    if (p == sizeof(names) / sizeof(names[0]))
+        return -1;
+    cfg->policy = (enum overload_policy)p;
+    spec += len;
+
+    int ret;
+    if (cfg->policy == OVERLOAD_SAMPLE) {
+        uint32_t *const fields[] = { &cfg->sample_every, &cfg->high_pct, &cfg->low_pct };
+        ret = parse_fields(spec, fields, 3);
+    } else {
+        uint32_t *const fields[] = { &cfg->high_pct, &cfg->low_pct };
+        ret = parse_fields(spec, fields, 2);
+    }
+    if (ret < 0 || cfg->sample_every == 0 || cfg->high_pct > 100 || cfg->low_pct >= cfg->high_pct)
+        return -1;
+    return 0;
+}
+
+const char *overload_policy_name(enum overload_policy policy) {
+    switch (policy) {
+    case OVERLOAD_SAMPLE:    return "sample";
+    case OVERLOAD_SUMMARIZE: return "summarize";
+    default:                 return "none";
+    }
+}
+
+void overload_init(struct overload_state *s, const struct overload_config *cfg, unsigned ring_capacity) {
+    memset(s, 0, sizeof(*s));
+    s->cfg = *cfg;
+    s->high = (uint64_t)ring_capacity * cfg->high_pct / 100;
+    s->low = (uint64_t)ring_capacity * cfg->low_pct / 100;
+    s->summary_cycles = rte_get_tsc_hz() / 1000 * OVERLOAD_SUMMARY_MS;
+}
@@ -0,0 +1,104 @@
+#ifndef OVERLOAD_H_
+#define OVERLOAD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Overload shedding for DETECT. Once per burst DETECT compares the
+// occupancy of detected_ring with two watermarks: above high_pct it starts
+// shedding, below low_pct it stops (the gap keeps it from flapping on every
+// burst). While shedding, THREAT records always go through and SAFE records
+// are handled by the policy:
+//   OVERLOAD_NONE       nothing is shed; a full ring drops whatever is left
+//   OVERLOAD_SAMPLE     one SAFE record in sample_every goes through
+//   OVERLOAD_SUMMARIZE  SAFE records are folded into one summary record per
+//                       queue and second (packets, bytes)
+// so LOGGER's backlog is spent on threats rather than on routine traffic.
+
+enum overload_policy {
+    OVERLOAD_NONE = 0,
+    OVERLOAD_SAMPLE,
+    OVERLOAD_SUMMARIZE,
+};
+
+#define OVERLOAD_HIGH_PCT     75
+#define OVERLOAD_LOW_PCT      25
+#define OVERLOAD_SAMPLE_EVERY 16
+#define OVERLOAD_SUMMARY_MS   1000
+
+struct overload_config {
+    enum overload_policy policy;
+    uint32_t high_pct;
+    uint32_t low_pct;
+    uint32_t sample_every;
+};
+
+// One per DETECT queue, owned by its lcore
+struct overload_state {
+    struct overload_config cfg;
+    uint32_t high, low;             // watermarks in ring entries
+    uint32_t sample_ctr;
+    bool shedding;
+    uint64_t episodes;              // times shedding started
+    // Open summary, while OVERLOAD_SUMMARIZE sheds
+    uint64_t summary_packets, summary_bytes;
+    uint64_t summary_start_tsc, summary_cycles;
+};
+
+// "none", "sample[:N]" or "summarize", optionally followed by ":HIGH:LOW"
+// watermarks in percent of the ring ("summarize:80:40", "sample:32:90:50").
+// Omitted fields keep the OVERLOAD_* defaults. Returns 0, or -1 on a
+// malformed spec.
+int overload_parse(const char *spec, struct overload_config *cfg);
+const char *overload_policy_name(enum overload_policy policy);
+
+void overload_init(struct overload_state *s, const struct overload_config *cfg, unsigned ring_capacity);
+
+// Once per burst with the current occupancy of the output ring; returns
+// whether SAFE records are being shed
+static inline bool overload_update(struct overload_state *s, unsigned used) {
+    if (s->cfg.policy == OVERLOAD_NONE)
+        return false;
+    if (!s->shedding && used >= s->high) {
+        s->shedding = true;
+        s->episodes++;
+    } else if (s->shedding && used <= s->low) {
+        s->shedding = false;
+    }
+    return s->shedding;
+}
+
+// For a SAFE record while shedding: true if it must be dropped. Summarized
+// records are counted into the open summary.
+static inline bool overload_shed(struct overload_state *s, uint16_t pkt_len, uint64_t now_tsc) {
+    if (s->cfg.policy == OVERLOAD_SAMPLE)
+        return ++s->sample_ctr % s->cfg.sample_every != 0;
+    if (s->summary_packets == 0)
+        s->summary_start_tsc = now_tsc;
+    s->summary_packets++;
+    s->summary_bytes += pkt_len;
+    return true;
+}
+
+// True once the open summary covers OVERLOAD_SUMMARY_MS, or shedding has
+// stopped with packets still in it. The caller sends it, then calls
+// overload_summary_sent().
+static inline bool overload_summary_due(const struct overload_state *s, uint64_t now_tsc) {
+    return s->summary_packets &&
+           (!s->shedding || now_tsc - s->summary_start_tsc >= s->summary_cycles);
+}
+
+static inline void overload_summary_sent(struct overload_state *s) {
+    s->summary_packets = 0;
+    s->summary_bytes = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // OVERLOAD_H_
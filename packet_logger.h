@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include "server_service.h"
+#include "idle_poll.h"
 #define INFINITE_PERIOD UINT32_MAX
 #ifdef __cplusplus
 extern "C" {
@@ -13,11 +14,77 @@ extern "C" {
 // Shared DPDK globals
 extern volatile bool force_quit;
 extern struct rte_mempool *mbuf_pool;
-extern struct rte_ring *packet_ring;
+extern struct rte_ring *packet_rings[];
 extern struct rte_ring *detected_ring;
-extern FILE *csv_file;
+extern struct rte_ring *threat_ring;
+extern struct rte_mempool *result_pool;
 extern uint16_t port_id;
 extern uint64_t total_rx;
+extern uint16_t nb_rx_queues;
+extern uint64_t result_pool_exhausted[];
+
+// Per-stage burst accounting. Each instance is written only by the stage that
+// owns it and read at shutdown, so it gets its own cache line.
+struct stage_stats {
+    uint64_t polls;   // dequeue/rx attempts
+    uint64_t bursts;  // attempts that returned at least one object
+    uint64_t objs;    // objects moved
+    uint64_t drops;   // objects dropped because the next ring was full
+    uint64_t threats; // DETECT only: packets judged THREAT
+    uint64_t threat_drops;  // DETECT only: THREAT records among the drops
+    uint64_t threat_spills; // DETECT only: THREAT records sent to detected_ring, lane full
+    uint64_t shed;          // DETECT only: SAFE records dropped by the overload policy
+    uint64_t summaries;     // DETECT only: summary records sent in their place
+    uint64_t overloads;     // DETECT only: times shedding started
+    uint64_t backlog_max;   // peak occupancy of the input ring (not tracked for RX)
+    struct idle_stats idle;
+} __attribute__((aligned(64)));
+
+extern struct stage_stats rx_stats[];
+extern struct stage_stats detect_stats[];
+extern struct stage_stats logger_stats;        // LOGGER on detected_ring
+extern struct stage_stats threat_lane_stats;   // LOGGER on threat_ring, mostly empty polls
+
+// Per-packet descriptor handed from RX -> DETECT -> LOGGER through the rings.
+// Allocated from result_pool, never from the heap. DETECT fills in the
+// summary and frees the mbuf unless retain_policy keeps it, so past DETECT
+// only this fixed-size record travels and the mbuf pool only has to cover
+// the RX queues and packet rings.
+struct detection_result {
+    struct rte_mbuf *mbuf;  // NULL once DETECT has released the packet
+    uint32_t rule_id;       // 1-based matching rule, 0 = no rule matched,
+                            // BPF_FILTER_RULE_ID = decided by the eBPF prefilter
+    uint8_t flow_alerts;    // FLOW_ALERT_* bits from the flow table
+    uint8_t verdict;        // enum log_verdict (log_writer.h), set by DETECT
+    // Summary, valid after DETECT; IPs and ports are 0 for non-IPv4
+    uint8_t proto;
+    uint16_t pkt_len;
+    uint8_t src_mac[6];
+    uint8_t dst_mac[6];
+    uint16_t src_port;      // host byte order
+    uint16_t dst_port;
+    uint32_t src_ip;        // network byte order
+    uint32_t dst_ip;
+    uint64_t rx_tsc;        // rte_eth_rx_burst() time, copied from the mbuf by DETECT
+    uint64_t detect_tsc;    // detection done
+    // LOG_VERDICT_SUMMARY: no packet, SAFE traffic the overload policy
+    // folded away on this queue since rx_tsc
+    uint64_t shed_packets;
+    uint64_t shed_bytes;
+};
+
+// Overload shedding at DETECT (overload.h), set from the command line
+struct overload_config;
+extern struct overload_config overload_config;
+
+// Which packets keep their mbuf past DETECT, for the capture file
+// (LOG_CAPTURE_FILE) written by the log writer
+enum retain_policy {
+    RETAIN_NONE = 0,
+    RETAIN_THREATS,
+    RETAIN_ALL,
+};
+extern enum retain_policy retain_policy;
 
 // DPDK constants
 //#define RX_RING_SIZE 1024
@@ -30,12 +97,29 @@ extern uint64_t total_rx;
 #define MBUF_CACHE_SIZE 250
 #define BURST_SIZE 32
 
+// Descriptor pool: sized to cover both rings full plus one burst per stage
+#define NUM_RESULTS 16383
+#define RESULT_CACHE_SIZE 256
+#define RESULT_POOL_NAME "RESULT_POOL"
+
 #define PACKET_RING_NAME "PACKET_RING"
+#define PACKET_RING_SIZE 2048
 #define DETECTED_RING_NAME "DETECTED_RING"
+#define DETECTED_RING_SIZE 8192
+// THREAT verdicts bypass detected_ring through this lane, which LOGGER
+// always drains first; a full lane spills into detected_ring
+#define THREAT_RING_NAME "THREAT_RING"
+#define THREAT_RING_SIZE 1024
 
 #define RX_CORE_ID 1
 #define DETECTION_CORE_ID 2
 #define LOGGER_CORE_ID 3
+#define LOG_WRITER_CORE 0   // shares the main lcore, never a pipeline core
+
+// RSS mode: queue 0 keeps cores 1/2, extra queues take core pairs after the logger
+#define MAX_RX_QUEUES 8
+#define RX_QUEUE_CORE(q)     ((q) == 0 ? RX_CORE_ID        : LOGGER_CORE_ID + 2 * (q) - 1)
+#define DETECT_QUEUE_CORE(q) ((q) == 0 ? DETECTION_CORE_ID : LOGGER_CORE_ID + 2 * (q))
 
 // Semaphores for LED and Logger
 extern sem_t led_sem;
@@ -44,14 +128,54 @@ extern sem_t rx_sem;
 extern sem_t detect_sem;
 
 
-// Shared threat flag
-extern volatile bool threat_detected;
+// Rate-based detection: limits set from the command line, one table per detect queue
+extern struct flow_limits flow_limits;
+extern struct flow_table *flow_tables[];
+
+// Top talkers: one heavy-hitter tracker per detect queue and key type,
+// published every TOP_PUBLISH_MS for readers on other threads
+#define TOP_PUBLISH_MS 100
+extern struct hh_tracker *top_src_mac[];
+extern struct hh_tracker *top_src_ip[];
+// Merged top-N source MACs and IPs as text, one talker per line
+int format_top_talkers(char *buf, size_t len, unsigned n);
+
+// Rates, latency and top talkers for the ncurses dashboard (dashboard.h)
+struct dashboard_source;
+extern const struct dashboard_source pipeline_dashboard;
 
 // Thread prototypes
-void rx_service();
-void detect_service();
+void rx_service(uint16_t queue_id);
+void detect_service(uint16_t queue_id);
 void logger_service();
-void led_service();
+void print_stage_stats(const char *name, const struct stage_stats *s);
+
+// Hooks into the Sequencer service running on the calling thread:
+// budget_left is true while the current release is within its execution
+// budget (always false without one); report_items adds to the per-release
+// items/backlog statistics printed next to the exec times.
+bool service_budget_left(void);
+void service_report_items(uint64_t items, uint64_t backlog);
+// Idle policy of the current service, for loops that poll until force_quit
+const struct idle_policy *service_idle_policy(void);
+
+// Per-release statistics of one periodic service, read while it runs
+struct service_metrics {
+    char name[16];
+    uint8_t core;
+    uint8_t priority;
+    uint32_t period_us;
+    uint32_t budget_us;
+    uint64_t releases;            // executions completed
+    uint64_t missed;              // releases dropped because the previous one had not started
+    uint64_t overruns;            // releases that found the previous one still running
+    uint64_t exec_p50_ns, exec_p99_ns, exec_max_ns, exec_sum_ns;
+    uint64_t jitter_p50_ns, jitter_p99_ns, jitter_max_ns, jitter_sum_ns;   // release to start
+    uint64_t jitter_count;
+};
+// Fills up to max entries for the running sequencer's periodic services;
+// returns how many were written (0 before the services start)
+unsigned service_get_metrics(struct service_metrics *out, unsigned max);
 //void init_all_sems();
 
 
@@ -0,0 +1,112 @@
+// pkt_latency.c
+#define _GNU_SOURCE
+#include "pkt_latency.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <syslog.h>
+
+#include <rte_cycles.h>
+
+struct pkt_latency_slot pkt_lat_rx_to_detect[PKT_LAT_MAX_QUEUES];
+struct pkt_latency_slot pkt_lat_detect_to_log;
+struct pkt_latency_slot pkt_lat_end_to_end;
+struct pkt_latency_slot pkt_lat_threat_to_log;
+struct pkt_latency_slot pkt_lat_detect_to_alert;
+
+int pkt_lat_ts_offset = -1;
+uint64_t pkt_lat_ts_flag;
+uint64_t pkt_lat_ns_mult;
+
+static const char *const stage_names[PKT_LAT_STAGES] = {
+    [PKT_LAT_RX_TO_DETECT]    = "rx_to_detect",
+    [PKT_LAT_DETECT_TO_LOG]   = "detect_to_log",
+    [PKT_LAT_END_TO_END]      = "end_to_end",
+    [PKT_LAT_THREAT_TO_LOG]   = "threat_to_log",
+    [PKT_LAT_DETECT_TO_ALERT] = "detect_to_alert",
+};
+
+int pkt_latency_init(void) {
+    // Shared with drivers that do hardware timestamping; the port never
+    // enables that offload, so the field only ever holds our TSC stamps
+    if (rte_mbuf_dyn_rx_timestamp_register(&pkt_lat_ts_offset, &pkt_lat_ts_flag) < 0) {
+        syslog(LOG_ERR, "[LATENCY] Cannot register the mbuf RX timestamp field");
+        return -1;
+    }
+    pkt_lat_ns_mult = (1000000000ULL << 32) / rte_get_tsc_hz();
+
+    for (unsigned q = 0; q < PKT_LAT_MAX_QUEUES; q++)
+        lhist_reset(&pkt_lat_rx_to_detect[q].hist);
+    lhist_reset(&pkt_lat_detect_to_log.hist);
+    lhist_reset(&pkt_lat_end_to_end.hist);
+    lhist_reset(&pkt_lat_threat_to_log.hist);
+    lhist_reset(&pkt_lat_detect_to_alert.hist);
+    return 0;
+}
+
+const char *pkt_latency_stage_name(enum pkt_latency_stage stage) {
+    return stage < PKT_LAT_STAGES ? stage_names[stage] : "unknown";
+}
+
+// Copy (and for RX -> detect merge) a stage without stopping its writers
+static void snapshot(enum pkt_latency_stage stage, struct latency_hist *out) {
+    switch (stage) {
+    case PKT_LAT_RX_TO_DETECT:
+        lhist_reset(out);
+        for (unsigned q = 0; q < PKT_LAT_MAX_QUEUES; q++)
+            lhist_merge(out, &pkt_lat_rx_to_detect[q].hist);
+        break;
+    case PKT_LAT_DETECT_TO_LOG:
+        memcpy(out, &pkt_lat_detect_to_log.hist, sizeof(*out));
+        break;
+    case PKT_LAT_THREAT_TO_LOG:
+        memcpy(out, &pkt_lat_threat_to_log.hist, sizeof(*out));
+        break;
+    case PKT_LAT_DETECT_TO_ALERT:
+        memcpy(out, &pkt_lat_detect_to_alert.hist, sizeof(*out));
+        break;
+    default:
+        memcpy(out, &pkt_lat_end_to_end.hist, sizeof(*out));
+        break;
+    }
+}
+
+void pkt_latency_summarize(enum pkt_latency_stage stage, struct pkt_latency_summary *out) {
+    static __thread struct latency_hist h;      // ~9 KB, keep it off the stack
+
+    snapshot(stage, &h);
+    out->count = h.count;
+    out->sum = h.sum;
+    out->p50 = lhist_percentile(&h, 50);
+    out->p99 = lhist_percentile(&h, 99);
+    out->p999 = lhist_percentile(&h, 99.9);
+    out->max = h.max;
+}
+
+void pkt_latency_log(void) {
+    for (int s = 0; s < PKT_LAT_STAGES; s++) {
+        struct pkt_latency_summary sum;
+        pkt_latency_summarize(s, &sum);
+        if (sum.count == 0) {
+            syslog(LOG_INFO, "[LATENCY] %-15s no packets\n", stage_names[s]);
+            continue;
+        }
+        syslog(LOG_INFO, "[LATENCY] %-15s p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us (%" PRIu64 " pkts)\n",
+               stage_names[s], sum.p50 / 1e3, sum.p99 / 1e3, sum.p999 / 1e3, sum.max / 1e3, sum.count);
+    }
+}
+
+int pkt_latency_write_csv(const char *path) {
+    static __thread struct latency_hist h;
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        syslog(LOG_ERR, "[LATENCY] Cannot write %s", path);
+        return -1;
+    }
+    for (int s = 0; s < PKT_LAT_STAGES; s++) {
+        snapshot(s, &h);
+        lhist_write_csv(&h, f, stage_names[s], 1000.0, s == 0);
+    }
+    fclose(f);
+    return 0;
+}
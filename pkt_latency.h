@@ -0,0 +1,102 @@
+#ifndef PKT_LATENCY_H_
+#define PKT_LATENCY_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <rte_mbuf.h>
+#include <rte_mbuf_dyn.h>
+
+#include "latency_hist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// End-to-end per-packet latency in TSC cycles. RX stamps every mbuf into the
+// standard RX timestamp dynfield right after rte_eth_rx_burst(); DETECT and
+// LOGGER stamp the descriptor when they are done with it. The stages land
+// in fixed-memory histograms in ns:
+//   RX -> detect     one histogram per detect queue, written by that DETECT
+//   detect -> log    written by LOGGER
+//   end to end       RX -> log, written by LOGGER
+//   threat -> log    detect -> log of THREAT records only: how long an
+//                    alert waits for LOGGER, written by LOGGER
+//   detect -> alert  THREAT verdict to its alert reaching the sinks,
+//                    written by the alert thread (alert.h)
+// Any thread may summarize or dump them while the pipeline runs; counts of
+// live histograms are a close snapshot.
+
+enum pkt_latency_stage {
+    PKT_LAT_RX_TO_DETECT = 0,
+    PKT_LAT_DETECT_TO_LOG,
+    PKT_LAT_END_TO_END,
+    PKT_LAT_THREAT_TO_LOG,
+    PKT_LAT_DETECT_TO_ALERT,
+    PKT_LAT_STAGES,
+};
+
+#define PKT_LAT_MAX_QUEUES 8
+#define PKT_LAT_CSV_FILE   "pkt_latency_hist.csv"
+
+// One writer per histogram, each on its own cache lines
+struct pkt_latency_slot {
+    struct latency_hist hist;
+} __attribute__((aligned(64)));
+
+extern struct pkt_latency_slot pkt_lat_rx_to_detect[PKT_LAT_MAX_QUEUES];
+extern struct pkt_latency_slot pkt_lat_detect_to_log;
+extern struct pkt_latency_slot pkt_lat_end_to_end;
+extern struct pkt_latency_slot pkt_lat_threat_to_log;
+extern struct pkt_latency_slot pkt_lat_detect_to_alert;
+
+extern int pkt_lat_ts_offset;     // RX timestamp dynfield, -1 before init
+extern uint64_t pkt_lat_ts_flag;
+extern uint64_t pkt_lat_ns_mult;  // ns per cycle in 32.32 fixed point
+
+struct pkt_latency_summary {
+    uint64_t count;
+    uint64_t sum;                   // ns
+    uint64_t p50, p99, p999, max;   // ns
+};
+
+// Register the RX timestamp dynfield and reset the histograms. Call before
+// the port starts.
+int pkt_latency_init(void);
+
+// Stamp a received burst with one TSC reading taken at rte_eth_rx_burst()
+static inline void pkt_latency_stamp(struct rte_mbuf **mbufs, uint16_t n, uint64_t tsc) {
+    for (uint16_t i = 0; i < n; i++) {
+        *RTE_MBUF_DYNFIELD(mbufs[i], pkt_lat_ts_offset, uint64_t *) = tsc;
+        mbufs[i]->ol_flags |= pkt_lat_ts_flag;
+    }
+}
+
+static inline uint64_t pkt_latency_rx_tsc(const struct rte_mbuf *m) {
+    return *RTE_MBUF_DYNFIELD(m, pkt_lat_ts_offset, const uint64_t *);
+}
+
+// Cycle delta to ns without a division; later stamps taken on another core
+// may read a few cycles early, which counts as 0
+static inline uint64_t pkt_latency_ns(uint64_t from_tsc, uint64_t to_tsc) {
+    if (to_tsc <= from_tsc)
+        return 0;
+    return (uint64_t)(((unsigned __int128)(to_tsc - from_tsc) * pkt_lat_ns_mult) >> 32);
+}
+
+// Merged over all queues for PKT_LAT_RX_TO_DETECT
+void pkt_latency_summarize(enum pkt_latency_stage stage, struct pkt_latency_summary *out);
+
+const char *pkt_latency_stage_name(enum pkt_latency_stage stage);
+
+// One syslog line per stage with p50/p99/p99.9/max in us
+void pkt_latency_log(void);
+
+// All stages as lhist_write_csv() rows in us; -1 if the file cannot be written
+int pkt_latency_write_csv(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PKT_LATENCY_H_
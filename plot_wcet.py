@@ -3,37 +3,39 @@ import pandas as pd
 import glob
 import os
 
-def plot_histogram(file_path, service_name):
+# Plots the execution-time histograms each periodic Service dumps to
+# <name>_hist.csv at shutdown (or on SIGUSR1). Rows are pre-binned:
+#   metric,low,high,count,max    (values in us, bucket = [low, high))
+
+
+def percentile(buckets, p):
+    # Upper edge of the bucket holding the p-th percentile, like lhist_percentile()
+    total = buckets["count"].sum()
+    rank = max(1, round(p / 100.0 * total))
+    seen = buckets["count"].cumsum()
+    return buckets.loc[seen >= rank, "high"].iloc[0]
+
+
+def plot_histogram(file_path, service_name, metric="exec"):
     if os.stat(file_path).st_size == 0:
         print(f"Skipping empty file: {file_path}")
         return  # File is empty, skip
 
     data = pd.read_csv(file_path)
+    buckets = data[data["metric"] == metric].sort_values("low")
 
     # Sometimes even a non-empty file can have no rows after header
-    if data.empty:
-        print(f"Skipping file with no data rows: {file_path}")
+    if buckets.empty:
+        print(f"Skipping file with no {metric} data: {file_path}")
         return
 
-    times = data.values.flatten()
-
-    # Additional safeguard if times is somehow empty
-    if times.size == 0:
-        print(f"No timing data to plot for {service_name}. Skipping.")
-        return
-
-    max_val = times.max()
-
-    # Decide bin size
-    if max_val > 10000:
-        bins = 100
-    elif max_val > 1000:
-        bins = 50
-    else:
-        bins = 30
+    max_val = buckets["max"].iloc[0]
+    p50, p99, p999 = (percentile(buckets, p) for p in (50, 99, 99.9))
 
-    plt.hist(times, bins=bins, edgecolor='black')
-    plt.title(f"{service_name} Execution Time Histogram\n(WCET = {max_val:.2f} us)")
+    plt.bar(buckets["low"], buckets["count"], width=buckets["high"] - buckets["low"],
+            align="edge", edgecolor='black')
+    plt.title(f"{service_name} Execution Time Histogram\n"
+              f"(p50 = {p50:.2f} us, p99 = {p99:.2f} us, p99.9 = {p999:.2f} us, WCET = {max_val:.2f} us)")
     plt.xlabel("Execution Time (us)")
     plt.ylabel("Frequency")
     plt.grid(True)
@@ -47,13 +49,13 @@ def plot_histogram(file_path, service_name):
     plt.show()
 
 def main():
-    files = glob.glob("*_exec_times.csv")
+    files = glob.glob("*_hist.csv")
     if not files:
-        print("No CSV files found to plot.")
+        print("No histogram files found to plot.")
         return
 
     for file in files:
-        service_name = file.replace("_exec_times.csv", "")
+        service_name = file.replace("_hist.csv", "")
         plot_histogram(file, service_name)
 
 if __name__ == "__main__":
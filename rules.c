@@ -0,0 +1,382 @@
+// rules.c
+#define _GNU_SOURCE
+#include "rules.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stddef.h>
+#include <syslog.h>
+#include <arpa/inet.h>
+
+#include <rte_acl.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+#include <rte_mbuf.h>
+
+enum {
+    FIELD_PROTO,
+    FIELD_TCP_FLAGS,
+    FIELD_PKT_LEN,
+    FIELD_SRC_IP,
+    FIELD_DST_IP,
+    FIELD_SRC_PORT,
+    FIELD_DST_PORT,
+    NUM_FIELDS
+};
+
+RTE_ACL_RULE_DEF(acl_rule, NUM_FIELDS);
+
+static const struct rte_acl_field_def field_defs[NUM_FIELDS] = {
+    { .type = RTE_ACL_FIELD_TYPE_BITMASK, .size = sizeof(uint8_t),
+      .field_index = FIELD_PROTO, .input_index = 0,
+      .offset = offsetof(struct rule_key, proto) },
+    { .type = RTE_ACL_FIELD_TYPE_BITMASK, .size = sizeof(uint8_t),
+      .field_index = FIELD_TCP_FLAGS, .input_index = 0,
+      .offset = offsetof(struct rule_key, tcp_flags) },
+    { .type = RTE_ACL_FIELD_TYPE_RANGE, .size = sizeof(uint16_t),
+      .field_index = FIELD_PKT_LEN, .input_index = 0,
+      .offset = offsetof(struct rule_key, pkt_len) },
+    { .type = RTE_ACL_FIELD_TYPE_MASK, .size = sizeof(uint32_t),
+      .field_index = FIELD_SRC_IP, .input_index = 1,
+      .offset = offsetof(struct rule_key, src_ip) },
+    { .type = RTE_ACL_FIELD_TYPE_MASK, .size = sizeof(uint32_t),
+      .field_index = FIELD_DST_IP, .input_index = 2,
+      .offset = offsetof(struct rule_key, dst_ip) },
+    { .type = RTE_ACL_FIELD_TYPE_RANGE, .size = sizeof(uint16_t),
+      .field_index = FIELD_SRC_PORT, .input_index = 3,
+      .offset = offsetof(struct rule_key, src_port) },
+    { .type = RTE_ACL_FIELD_TYPE_RANGE, .size = sizeof(uint16_t),
+      .field_index = FIELD_DST_PORT, .input_index = 3,
+      .offset = offsetof(struct rule_key, dst_port) },
+};
+
+static struct rte_acl_ctx *acl_ctx = NULL;
+static uint8_t *rule_actions = NULL;   // indexed by 1-based rule number
+static unsigned num_rules = 0;
+static struct quick_rule quick_rules[RULES_QUICK_MAX];
+static unsigned num_quick_rules = 0;
+
+// Used when no rule file is present: the original "ICMP is a threat" check
+static const struct rule_spec default_rules[] = {
+    { .proto = IPPROTO_ICMP, .proto_mask = 0xff, .len_hi = UINT16_MAX,
+      .sport_hi = UINT16_MAX, .dport_hi = UINT16_MAX, .action = RULE_ACTION_THREAT },
+};
+
+static bool is_quick_rule(const struct rule_spec *s) {
+    return s->src_depth == 0 && s->dst_depth == 0 &&
+           s->tcp_flags_mask == 0 &&
+           s->sport_lo == 0 && s->sport_hi == UINT16_MAX &&
+           s->len_lo == 0 && s->len_hi == UINT16_MAX;
+}
+
+int rules_build(const struct rule_spec *specs, unsigned count) {
+    static unsigned generation = 0;
+    char name[RTE_ACL_NAMESIZE];
+
+    if (count == 0 || count > RULES_MAX) {
+        syslog(LOG_ERR, "[RULES] Invalid rule count %u", count);
+        return -1;
+    }
+
+    snprintf(name, sizeof(name), "DETECT_ACL_%u", generation++);
+    struct rte_acl_param param = {
+        .name = name,
+        .socket_id = SOCKET_ID_ANY,
+        .rule_size = RTE_ACL_RULE_SZ(NUM_FIELDS),
+        .max_rule_num = count,
+    };
+    struct rte_acl_ctx *ctx = rte_acl_create(&param);
+    struct acl_rule *acl_rules = calloc(count, sizeof(*acl_rules));
+    uint8_t *actions = calloc(count + 1, sizeof(*actions));
+    if (!ctx || !acl_rules || !actions) {
+        syslog(LOG_ERR, "[RULES] Out of memory building %u rules", count);
+        goto fail;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        const struct rule_spec *s = &specs[i];
+        struct acl_rule *r = &acl_rules[i];
+
+        r->data.category_mask = 1;
+        r->data.priority = RTE_ACL_MAX_PRIORITY - i;   // first rule wins
+        r->data.userdata = i + 1;                      // 0 is "no match"
+
+        r->field[FIELD_PROTO].value.u8 = s->proto;
+        r->field[FIELD_PROTO].mask_range.u8 = s->proto_mask;
+        r->field[FIELD_TCP_FLAGS].value.u8 = s->tcp_flags;
+        r->field[FIELD_TCP_FLAGS].mask_range.u8 = s->tcp_flags_mask;
+        r->field[FIELD_PKT_LEN].value.u16 = s->len_lo;
+        r->field[FIELD_PKT_LEN].mask_range.u16 = s->len_hi;
+        r->field[FIELD_SRC_IP].value.u32 = s->src_ip;
+        r->field[FIELD_SRC_IP].mask_range.u32 = s->src_depth;
+        r->field[FIELD_DST_IP].value.u32 = s->dst_ip;
+        r->field[FIELD_DST_IP].mask_range.u32 = s->dst_depth;
+        r->field[FIELD_SRC_PORT].value.u16 = s->sport_lo;
+        r->field[FIELD_SRC_PORT].mask_range.u16 = s->sport_hi;
+        r->field[FIELD_DST_PORT].value.u16 = s->dport_lo;
+        r->field[FIELD_DST_PORT].mask_range.u16 = s->dport_hi;
+        actions[i + 1] = s->action;
+    }
+
+    if (rte_acl_add_rules(ctx, (const struct rte_acl_rule *)acl_rules, count) < 0) {
+        syslog(LOG_ERR, "[RULES] Failed to add rules to ACL context");
+        goto fail;
+    }
+
+    struct rte_acl_config cfg = {
+        .num_categories = 1,
+        .num_fields = NUM_FIELDS,
+    };
+    memcpy(cfg.defs, field_defs, sizeof(field_defs));
+    if (rte_acl_build(ctx, &cfg) < 0) {
+        syslog(LOG_ERR, "[RULES] Failed to build ACL trie for %u rules", count);
+        goto fail;
+    }
+
+    free(acl_rules);
+    rules_free();
+    acl_ctx = ctx;
+    rule_actions = actions;
+    num_rules = count;
+
+    while (num_quick_rules < RULES_QUICK_MAX && num_quick_rules < count &&
+           is_quick_rule(&specs[num_quick_rules])) {
+        const struct rule_spec *s = &specs[num_quick_rules];
+        quick_rules[num_quick_rules] = (struct quick_rule){
+            .proto = s->proto, .proto_mask = s->proto_mask,
+            .dport_lo = s->dport_lo, .dport_hi = s->dport_hi,
+            .rule_id = num_quick_rules + 1,
+        };
+        num_quick_rules++;
+    }
+    return 0;
+
+fail:
+    rte_acl_free(ctx);
+    free(acl_rules);
+    free(actions);
+    return -1;
+}
+
+static int parse_range(const char *tok, uint16_t *lo, uint16_t *hi) {
+    unsigned long a, b;
+    char *end;
+
+    if (strcmp(tok, "*") == 0) {
+        *lo = 0;
+        *hi = UINT16_MAX;
+        return 0;
+    }
+    a = strtoul(tok, &end, 0);
+    if (*end == ':')
+        b = strtoul(end + 1, &end, 0);
+    else
+        b = a;
+    if (*end != '\0' || a > b || b > UINT16_MAX)
+        return -1;
+    *lo = (uint16_t)a;
+    *hi = (uint16_t)b;
+    return 0;
+}
+
+static int parse_prefix(const char *tok, uint32_t *ip, uint8_t *depth) {
+    char buf[32];
+    struct in_addr addr;
+    unsigned long len = 32;
+
+    if (strcmp(tok, "*") == 0) {
+        *ip = 0;
+        *depth = 0;
+        return 0;
+    }
+    snprintf(buf, sizeof(buf), "%s", tok);
+    char *slash = strchr(buf, '/');
+    if (slash) {
+        char *end;
+        *slash = '\0';
+        len = strtoul(slash + 1, &end, 10);
+        if (*end != '\0' || len > 32)
+            return -1;
+    }
+    if (inet_pton(AF_INET, buf, &addr) != 1)
+        return -1;
+    *ip = ntohl(addr.s_addr);
+    *depth = (uint8_t)len;
+    return 0;
+}
+
+static int parse_proto(const char *tok, uint8_t *proto, uint8_t *mask) {
+    static const struct { const char *name; uint8_t proto; } names[] = {
+        { "icmp", IPPROTO_ICMP }, { "tcp", IPPROTO_TCP }, { "udp", IPPROTO_UDP },
+    };
+    char *end;
+
+    *mask = 0xff;
+    if (strcmp(tok, "*") == 0) {
+        *proto = 0;
+        *mask = 0;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcasecmp(tok, names[i].name) == 0) {
+            *proto = names[i].proto;
+            return 0;
+        }
+    }
+    unsigned long v = strtoul(tok, &end, 0);
+    if (*end != '\0' || v > UINT8_MAX)
+        return -1;
+    *proto = (uint8_t)v;
+    return 0;
+}
+
+static int parse_flags(const char *tok, uint8_t *flags, uint8_t *mask) {
+    char *end;
+
+    if (strcmp(tok, "*") == 0) {
+        *flags = 0;
+        *mask = 0;
+        return 0;
+    }
+    unsigned long v = strtoul(tok, &end, 0), m = 0xff;
+    if (*end == '/')
+        m = strtoul(end + 1, &end, 0);
+    if (*end != '\0' || v > UINT8_MAX || m > UINT8_MAX)
+        return -1;
+    *flags = (uint8_t)v;
+    *mask = (uint8_t)m;
+    return 0;
+}
+
+int rules_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        syslog(LOG_WARNING, "[RULES] %s not found, using built-in ICMP rule", path);
+        return rules_build(default_rules, sizeof(default_rules) / sizeof(default_rules[0]));
+    }
+
+    unsigned cap = 64, count = 0, lineno = 0;
+    struct rule_spec *specs = malloc(cap * sizeof(*specs));
+    char line[256];
+    int ret = -1;
+
+    while (specs && fgets(line, sizeof(line), f)) {
+        char action[16], proto[16], src[32], dst[32], sport[16], dport[16], flags[16], len[16];
+        lineno++;
+
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        int n = sscanf(line, "%15s %15s %31s %31s %15s %15s %15s %15s",
+                       action, proto, src, dst, sport, dport, flags, len);
+        if (n <= 0)
+            continue;   // blank or comment
+
+        if (count == cap) {
+            struct rule_spec *grown = realloc(specs, 2 * cap * sizeof(*specs));
+            if (!grown)
+                break;
+            specs = grown;
+            cap *= 2;
+        }
+        struct rule_spec *s = &specs[count];
+        memset(s, 0, sizeof(*s));
+
+        if (n != 8 ||
+            parse_proto(proto, &s->proto, &s->proto_mask) < 0 ||
+            parse_prefix(src, &s->src_ip, &s->src_depth) < 0 ||
+            parse_prefix(dst, &s->dst_ip, &s->dst_depth) < 0 ||
+            parse_range(sport, &s->sport_lo, &s->sport_hi) < 0 ||
+            parse_range(dport, &s->dport_lo, &s->dport_hi) < 0 ||
+            parse_flags(flags, &s->tcp_flags, &s->tcp_flags_mask) < 0 ||
+            parse_range(len, &s->len_lo, &s->len_hi) < 0) {
+            syslog(LOG_ERR, "[RULES] %s:%u: malformed rule", path, lineno);
+            goto out;
+        }
+        if (strcasecmp(action, "THREAT") == 0) {
+            s->action = RULE_ACTION_THREAT;
+        } else if (strcasecmp(action, "SAFE") == 0) {
+            s->action = RULE_ACTION_SAFE;
+        } else {
+            syslog(LOG_ERR, "[RULES] %s:%u: unknown action '%s'", path, lineno, action);
+            goto out;
+        }
+        count++;
+    }
+
+    if (count == 0)
+        syslog(LOG_ERR, "[RULES] %s contains no rules", path);
+    else
+        ret = rules_build(specs, count);
+    if (ret == 0)
+        syslog(LOG_INFO, "[RULES] Loaded %u rules from %s", count, path);
+
+out:
+    free(specs);
+    fclose(f);
+    return ret;
+}
+
+void rules_free(void) {
+    rte_acl_free(acl_ctx);
+    free(rule_actions);
+    acl_ctx = NULL;
+    rule_actions = NULL;
+    num_rules = 0;
+    num_quick_rules = 0;
+}
+
+unsigned rules_count(void) {
+    return num_rules;
+}
+
+bool rules_extract_key(const struct rte_mbuf *m, struct rule_key *key) {
+    const struct rte_ether_hdr *eth = rte_pktmbuf_mtod(m, const struct rte_ether_hdr *);
+    if (eth->ether_type != rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4))
+        return false;
+
+    const struct rte_ipv4_hdr *ip = (const struct rte_ipv4_hdr *)(eth + 1);
+    const uint8_t *l4 = (const uint8_t *)ip + (ip->version_ihl & RTE_IPV4_HDR_IHL_MASK) * RTE_IPV4_IHL_MULTIPLIER;
+
+    key->proto = ip->next_proto_id;
+    key->tcp_flags = 0;
+    key->pkt_len = rte_cpu_to_be_16((uint16_t)m->pkt_len);
+    key->src_ip = ip->src_addr;
+    key->dst_ip = ip->dst_addr;
+    key->src_port = 0;
+    key->dst_port = 0;
+
+    if (ip->next_proto_id == IPPROTO_TCP) {
+        const struct rte_tcp_hdr *tcp = (const struct rte_tcp_hdr *)l4;
+        key->src_port = tcp->src_port;
+        key->dst_port = tcp->dst_port;
+        key->tcp_flags = tcp->tcp_flags;
+    } else if (ip->next_proto_id == IPPROTO_UDP) {
+        const struct rte_udp_hdr *udp = (const struct rte_udp_hdr *)l4;
+        key->src_port = udp->src_port;
+        key->dst_port = udp->dst_port;
+    }
+    return true;
+}
+
+void rules_classify(const struct rule_key *const keys[], uint32_t *match, unsigned n) {
+    if (n == 0)
+        return;
+    rte_acl_classify(acl_ctx, (const uint8_t **)keys, match, n, 1);
+}
+
+unsigned rules_quick_prefix(struct quick_rule *out, unsigned max) {
+    unsigned n = num_quick_rules < max ? num_quick_rules : max;
+    memcpy(out, quick_rules, n * sizeof(*out));
+    return n;
+}
+
+enum rule_action rules_action(uint32_t match) {
+    if (match == 0 || match > num_rules)
+        return RULE_ACTION_SAFE;
+    return (enum rule_action)rule_actions[match];
+}
@@ -0,0 +1,84 @@
+#ifndef RULES_H_
+#define RULES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rte_mbuf;
+
+#define RULES_DEFAULT_FILE "rules.conf"
+#define RULES_MAX 65536
+
+enum rule_action {
+    RULE_ACTION_SAFE = 0,
+    RULE_ACTION_THREAT = 1,
+};
+
+// One parsed rule. Addresses and ports are host byte order; a wildcard
+// field has a zero mask/depth or a full 0..max range.
+struct rule_spec {
+    uint8_t  proto, proto_mask;
+    uint8_t  tcp_flags, tcp_flags_mask;
+    uint16_t len_lo, len_hi;          // frame length
+    uint32_t src_ip, dst_ip;
+    uint8_t  src_depth, dst_depth;    // prefix lengths
+    uint16_t sport_lo, sport_hi;
+    uint16_t dport_lo, dport_hi;
+    uint8_t  action;                  // enum rule_action
+};
+
+// Classification key fed to rte_acl. Laid out in 4-byte input groups as the
+// ACL library requires, values in network byte order as read off the wire.
+struct rule_key {
+    uint8_t  proto;
+    uint8_t  tcp_flags;
+    uint16_t pkt_len;
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+};
+
+// Leading rule that only tests protocol and destination port. The burst
+// classifier evaluates these with SIMD before falling back to the ACL.
+struct quick_rule {
+    uint8_t  proto, proto_mask;
+    uint16_t dport_lo, dport_hi;
+    uint32_t rule_id;                 // 1-based, same numbering as the ACL
+};
+
+#define RULES_QUICK_MAX 8
+
+// Build the lookup structure from parsed rules. Earlier rules win.
+int rules_build(const struct rule_spec *specs, unsigned count);
+
+// Parse a rule file and build it. Format, one rule per line, '#' comments:
+//   <SAFE|THREAT> <proto> <src/len> <dst/len> <sport> <dport> <flags/mask> <len>
+// Every field accepts '*'. Ports/len are "n" or "lo:hi".
+int rules_load(const char *path);
+
+void rules_free(void);
+unsigned rules_count(void);
+
+// Fill key from an Ethernet/IPv4 frame. Returns false for non-IPv4 frames.
+bool rules_extract_key(const struct rte_mbuf *m, struct rule_key *key);
+
+// Classify n keys. match[i] is the 1-based matching rule index (0 = none).
+void rules_classify(const struct rule_key *const keys[], uint32_t *match, unsigned n);
+
+// Action of a 1-based rule index returned by rules_classify(); SAFE for 0.
+enum rule_action rules_action(uint32_t match);
+
+// Copy the longest prefix of the rule table made of quick rules. Because
+// first match wins, a packet hit by one of these never needs the ACL.
+unsigned rules_quick_prefix(struct quick_rule *out, unsigned max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RULES_H_
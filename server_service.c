@@ -1,85 +1,259 @@
 // server_service.c
-#define _GNU_SOURCE   
+#define _GNU_SOURCE
 #include "packet_logger.h"
+#include "metrics.h"
 
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <fcntl.h>
+#include <errno.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <syslog.h>
 #include <sched.h>
+#include <time.h>
 
+// HTTP endpoint on port 8080, driven one step per release: epoll_wait() with
+// a zero timeout, then accept, read, format and send on non-blocking sockets
+// only, so a slow or stalled client never blocks the core shared with the
+// logger. Formatting is the only real work; after the first response of a
+// release the rest wait while the release budget is spent.
+//   GET /metrics        Prometheus text format
+//   GET /metrics.json   the same counters as JSON (also /metrics?format=json)
+//   GET /top            top talkers
+//   anything else       welcome page
 
-void server_service() {
-    static int server_fd = -1;
-    static bool initialized = false;
+#define SERVER_PORT       8080
+#define SERVER_BACKLOG    64
+#define SERVER_MAX_CONNS  16
+#define SERVER_MAX_EVENTS 32
+#define SERVER_REQ_MAX    1024
+#define SERVER_RESP_MAX   (64 * 1024)
+#define SERVER_IDLE_MS    5000     // a connection that has not finished by then is closed
 
-    if (!initialized) {
-        syslog(LOG_INFO, "[SERVER] Initializing local web server on core %d", sched_getcpu());
+enum conn_state {
+    CONN_FREE = 0,
+    CONN_READ,       // waiting for the end of the request header
+    CONN_PENDING,    // request complete, response not formatted yet
+    CONN_WRITE,
+};
 
-        struct sockaddr_in address;
-        int opt = 1;
-        //int addrlen = sizeof(address);
+struct conn {
+    int fd;
+    enum conn_state state;
+    uint64_t deadline_ms;
+    size_t req_len;
+    char req[SERVER_REQ_MAX];
+    size_t resp_len, resp_off;
+    char resp[SERVER_RESP_MAX];
+};
 
-        // Create socket
-        if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-            syslog(LOG_ERR, "[SERVER] Socket creation failed");
-            exit(EXIT_FAILURE);
-        }
+static struct conn conns[SERVER_MAX_CONNS];
+static int server_fd = -1, epoll_fd = -1;
 
-        // Allow reuse of address/port
-        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
-            syslog(LOG_ERR, "[SERVER] Setsockopt failed");
-            exit(EXIT_FAILURE);
-        }
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-        // Set non-blocking
-        fcntl(server_fd, F_SETFL, O_NONBLOCK);
+static int server_init(void) {
+    struct sockaddr_in address;
+    int opt = 1;
 
-        address.sin_family = AF_INET;
-        address.sin_addr.s_addr = INADDR_ANY;  // 0.0.0.0
-        address.sin_port = htons(8080);         // Port 8080
+    server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server_fd < 0) {
+        syslog(LOG_ERR, "[SERVER] Socket creation failed: %s", strerror(errno));
+        return -1;
+    }
+    // Allow reuse of address/port
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt))) {
+        syslog(LOG_ERR, "[SERVER] Setsockopt failed: %s", strerror(errno));
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;  // 0.0.0.0
+    address.sin_port = htons(SERVER_PORT);
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        syslog(LOG_ERR, "[SERVER] Bind to port %d failed: %s", SERVER_PORT, strerror(errno));
+        return -1;
+    }
+    if (listen(server_fd, SERVER_BACKLOG) < 0) {
+        syslog(LOG_ERR, "[SERVER] Listen failed: %s", strerror(errno));
+        return -1;
+    }
 
-        // Bind
-        if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-            syslog(LOG_ERR, "[SERVER] Bind failed");
-            exit(EXIT_FAILURE);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev) < 0) {
+        syslog(LOG_ERR, "[SERVER] epoll setup failed: %s", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < SERVER_MAX_CONNS; i++)
+        conns[i].fd = -1;
+    return 0;
+}
+
+static void conn_close(struct conn *c) {
+    close(c->fd);           // also drops it from the epoll set
+    c->fd = -1;
+    c->state = CONN_FREE;
+}
+
+// Accept while there is a free slot; the rest stay in the listen backlog
+static void accept_pending(uint64_t now) {
+    for (int i = 0; i < SERVER_MAX_CONNS; i++) {
+        struct conn *c = &conns[i];
+        if (c->state != CONN_FREE)
+            continue;
+        int fd = accept4(server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;         // EAGAIN: nothing pending
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.ptr = c };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
         }
+        c->fd = fd;
+        c->state = CONN_READ;
+        c->req_len = 0;
+        c->deadline_ms = now + SERVER_IDLE_MS;
+    }
+}
 
-        // Listen
-        if (listen(server_fd, 5) < 0) {
-            syslog(LOG_ERR, "[SERVER] Listen failed");
-            exit(EXIT_FAILURE);
+static void conn_read(struct conn *c) {
+    for (;;) {
+        ssize_t got = recv(c->fd, c->req + c->req_len, sizeof(c->req) - 1 - c->req_len, 0);
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (got <= 0) {
+            conn_close(c);
+            return;
+        }
+        c->req_len += got;
+        c->req[c->req_len] = '\0';
+        // Only the request line matters; a header that does not fit is answered anyway
+        if (strstr(c->req, "\r\n\r\n") || strstr(c->req, "\n\n") || c->req_len == sizeof(c->req) - 1) {
+            c->state = CONN_PENDING;
+            break;
         }
+    }
+}
 
-        initialized = true;
+static void conn_write(struct conn *c) {
+    while (c->resp_off < c->resp_len) {
+        ssize_t n = send(c->fd, c->resp + c->resp_off, c->resp_len - c->resp_off, MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct epoll_event ev = { .events = EPOLLOUT | EPOLLRDHUP, .data.ptr = c };
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+            return;         // rest goes out when the socket drains
+        }
+        if (n <= 0)
+            break;
+        c->resp_off += n;
     }
+    shutdown(c->fd, SHUT_WR);
+    conn_close(c);
+}
 
-    // Each time service releases: check if connection is pending
-    struct sockaddr_in client_address;
-    socklen_t client_addrlen = sizeof(client_address);
-    int new_socket = accept(server_fd, (struct sockaddr *)&client_address, &client_addrlen);
+// Format the response for a complete request; the snapshot is collected at
+// most once per release, however many scrapes arrive together
+static void conn_respond(struct conn *c, struct metrics_snapshot *snap, bool *have_snap) {
+    static char body[SERVER_RESP_MAX - 256];
+    const char *type = "text/plain";
+    const char *path = strncmp(c->req, "GET ", 4) == 0 ? c->req + 4 : "";
+    size_t path_len = strcspn(path, " \r\n");
+    bool metrics = path_len >= 8 && strncmp(path, "/metrics", 8) == 0;
+    bool json = metrics && (strncmp(path, "/metrics.json", 13) == 0 ||
+                            memmem(path, path_len, "format=json", 11) != NULL);
+    size_t body_len;
 
-if (new_socket >= 0) {
-    const char *body = "Welcome to Rivian LAN\n";
-    char response[256];
+    if (metrics) {
+        if (!*have_snap) {
+            metrics_collect(snap);
+            *have_snap = true;
+        }
+        if (json) {
+            body_len = metrics_format_json(snap, body, sizeof(body));
+            type = "application/json";
+        } else {
+            body_len = metrics_format_prometheus(snap, body, sizeof(body));
+            type = "text/plain; version=0.0.4";
+        }
+    } else if (path_len >= 4 && strncmp(path, "/top", 4) == 0) {
+        body_len = format_top_talkers(body, sizeof(body), 10);
+    } else {
+        body_len = snprintf(body, sizeof(body), "Welcome to Rivian LAN\n");
+    }
 
-    snprintf(response, sizeof(response),
+    int head = snprintf(c->resp, sizeof(c->resp),
         "HTTP/1.1 200 OK\r\n"
-        "Content-Type: text/plain\r\n"
-        "Content-Length: %ld\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
         "Connection: close\r\n"
-        "\r\n"
-        "%s",
-        strlen(body), body);
-
-    send(new_socket, response, strlen(response), 0);
-    shutdown(new_socket, SHUT_WR);  // ? Optional but cleaner
-    close(new_socket);
+        "\r\n",
+        type, body_len);
+    memcpy(c->resp + head, body, body_len);
+    c->resp_len = head + body_len;
+    c->resp_off = 0;
+    c->state = CONN_WRITE;
+    conn_write(c);
 }
 
-    // else: no pending connections (normal)
+void server_service() {
+    static bool initialized = false, failed = false;
+    static struct metrics_snapshot snap;
+
+    if (failed)
+        return;
+    if (!initialized) {
+        syslog(LOG_INFO, "[SERVER] Initializing local web server on core %d", sched_getcpu());
+        if (server_init() < 0) {
+            // The pipeline runs fine without its endpoint
+            if (server_fd >= 0)
+                close(server_fd);
+            failed = true;
+            return;
+        }
+        initialized = true;
+    }
+
+    // Socket readiness first: new connections and request bytes
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    uint64_t now = now_ms();
+    int n = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, 0);
+    for (int i = 0; i < n; i++) {
+        struct conn *c = events[i].data.ptr;
+        if (!c) {
+            accept_pending(now);
+            continue;
+        }
+        if (c->state == CONN_FREE)
+            continue;       // closed earlier in this batch
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            conn_close(c);
+            continue;
+        }
+        if (c->state == CONN_READ && (events[i].events & (EPOLLIN | EPOLLRDHUP)))
+            conn_read(c);
+        else if (c->state == CONN_WRITE && (events[i].events & EPOLLOUT))
+            conn_write(c);
+    }
+
+    // Then responses: at least one per release, more while the budget lasts
+    bool have_snap = false;
+    unsigned answered = 0;
+    for (int i = 0; i < SERVER_MAX_CONNS; i++) {
+        struct conn *c = &conns[i];
+        if (c->state == CONN_PENDING && (answered == 0 || service_budget_left())) {
+            conn_respond(c, &snap, &have_snap);
+            answered++;
+        } else if (c->state != CONN_FREE && now >= c->deadline_ms) {
+            conn_close(c);
+        }
+    }
 }
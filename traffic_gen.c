@@ -0,0 +1,417 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+// traffic_gen.c - DPDK traffic generator for load testing packet_logger.
+//
+// Builds the SAFE / THREAT / BURST traffic of test_script_packet.py, or
+// replays a pcap file, on an EAL port at a fixed packet rate or at max
+// speed, and reports offered, sent and (with --rx-port) received rates as
+// CSV rows (benchmark,case,metric,value,unit) for throughput/loss curves.
+//
+// Generator capacity, in-process loopback through a net_ring port:
+//   sudo ./traffic_gen -l 0 --no-huge -m 512 --vdev net_ring0 -- --rx-port 0 --rate 1000000
+// Capture file for packet_logger --vdev net_pcap0,rx_pcap=load.pcap:
+//   sudo ./traffic_gen -l 0 --no-huge -m 512 --vdev net_pcap0,tx_pcap=load.pcap -- --mix burst
+// Live into packet_logger over a veth pair (bench/load_curve.sh sweeps rates):
+//   sudo ./traffic_gen -l 0 --no-huge -m 512 --vdev net_af_packet0,iface=veth0 -- --rate 200000
+//
+// Application options (after "--"):
+//   --mix M         safe, threat, mixed (default: 50/50 like the scapy script)
+//                   or burst (mixed, plus trains of 50-100 back-to-back
+//                   packets every second)
+//   --pcap FILE     replay the Ethernet frames of FILE in a loop instead
+//   --rate PPS      offered load, 0 = as fast as the port takes it (default)
+//   --duration S    default 5
+//   --size BYTES    frame size of generated packets, 60..1514 (default 60)
+//   --tx-port N     default 0
+//   --rx-port N     also count what arrives on port N
+//   --dst-mac MAC / --dst-ip A.B.C.D   default: the RPi of the scapy scripts
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rte_byteorder.h>
+#include <rte_cycles.h>
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+#include <rte_ether.h>
+#include <rte_icmp.h>
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+
+#define GEN_BURST        32
+#define GEN_TEMPLATES    1024
+#define GEN_SOURCES      256             // distinct source hosts in generated traffic
+#define GEN_MAX_FRAME    1514
+#define GEN_NUM_MBUFS    8191
+#define GEN_RING_SIZE    1024
+#define TRAIN_PERIOD_MS  1000
+#define TRAIN_MIN        50
+#define TRAIN_MAX        100
+#define DRAIN_MS         100             // keep counting RX after the last TX
+
+#define PCAP_MAGIC_US    0xa1b2c3d4
+#define PCAP_MAGIC_NS    0xa1b23c4d
+#define PCAP_LINK_ETHER  1
+
+enum gen_mix { MIX_SAFE, MIX_THREAT, MIX_MIXED, MIX_BURST };
+
+struct frame {
+    uint16_t len;
+    uint8_t data[GEN_MAX_FRAME];
+};
+
+static struct {
+    enum gen_mix mix;
+    const char *pcap;
+    uint64_t rate;
+    unsigned duration_s;
+    unsigned size;
+    uint16_t tx_port;
+    int rx_port;
+    struct rte_ether_addr dst_mac;
+    uint32_t dst_ip;
+} opts = {
+    .mix = MIX_MIXED,
+    .duration_s = 5,
+    .size = 60,
+    .rx_port = -1,
+    .dst_mac = {{ 0xd8, 0x3a, 0xdd, 0x9c, 0xd8, 0x7e }},
+    .dst_ip = RTE_IPV4(192, 168, 1, 2),
+};
+
+static const char *mix_names[] = { "safe", "threat", "mixed", "burst" };
+
+static struct frame *frames;
+static unsigned nb_frames;
+static volatile bool quit;
+
+static uint64_t gen_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void on_signal(int signum) {
+    (void)signum;
+    quit = true;
+}
+
+// One SAFE (TCP/UDP to a high port) or THREAT (ICMP echo) frame
+static void build_frame(struct frame *f, bool threat, uint64_t *seed) {
+    uint64_t r = gen_rand(seed);
+    unsigned src = r % GEN_SOURCES;
+    memset(f->data, 0, opts.size);
+    f->len = (uint16_t)opts.size;
+
+    struct rte_ether_hdr *eth = (struct rte_ether_hdr *)f->data;
+    struct rte_ipv4_hdr *ip = (struct rte_ipv4_hdr *)(eth + 1);
+    uint16_t ip_len = (uint16_t)(opts.size - sizeof(*eth));
+
+    eth->dst_addr = opts.dst_mac;
+    eth->src_addr = (struct rte_ether_addr){{ 0x02, 0x00, 0x00, 0x00, (uint8_t)(src >> 8), (uint8_t)src }};
+    eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+    ip->version_ihl = 0x45;
+    ip->time_to_live = 64;
+    ip->total_length = rte_cpu_to_be_16(ip_len);
+    ip->src_addr = rte_cpu_to_be_32(RTE_IPV4(10, 0, src >> 8, src & 0xff));
+    ip->dst_addr = rte_cpu_to_be_32(opts.dst_ip);
+
+    uint16_t sport = 1024 + (uint16_t)((r >> 16) % 64512);
+    uint16_t dport = 1024 + (uint16_t)((r >> 32) % 64512);
+    if (threat) {
+        struct rte_icmp_hdr *icmp = (struct rte_icmp_hdr *)(ip + 1);
+        ip->next_proto_id = IPPROTO_ICMP;
+        icmp->icmp_type = RTE_IP_ICMP_ECHO_REQUEST;
+        icmp->icmp_ident = rte_cpu_to_be_16(sport);
+        icmp->icmp_cksum = (uint16_t)~rte_raw_cksum(icmp, ip_len - sizeof(*ip));
+    } else if ((r >> 48) & 1) {
+        struct rte_tcp_hdr *tcp = (struct rte_tcp_hdr *)(ip + 1);
+        ip->next_proto_id = IPPROTO_TCP;
+        tcp->src_port = rte_cpu_to_be_16(sport);
+        tcp->dst_port = rte_cpu_to_be_16(dport);
+        tcp->data_off = (sizeof(*tcp) / 4) << 4;
+        tcp->tcp_flags = RTE_TCP_ACK_FLAG;
+        tcp->rx_win = rte_cpu_to_be_16(65535);
+        tcp->cksum = rte_ipv4_udptcp_cksum(ip, tcp);
+    } else {
+        struct rte_udp_hdr *udp = (struct rte_udp_hdr *)(ip + 1);
+        ip->next_proto_id = IPPROTO_UDP;
+        udp->src_port = rte_cpu_to_be_16(sport);
+        udp->dst_port = rte_cpu_to_be_16(dport);
+        udp->dgram_len = rte_cpu_to_be_16(ip_len - sizeof(*ip));
+    }
+    ip->hdr_checksum = rte_ipv4_cksum(ip);
+}
+
+static int build_frames(void) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    frames = calloc(GEN_TEMPLATES, sizeof(*frames));
+    if (!frames)
+        return -1;
+    for (unsigned i = 0; i < GEN_TEMPLATES; i++) {
+        bool threat = opts.mix == MIX_THREAT ||
+                      ((opts.mix == MIX_MIXED || opts.mix == MIX_BURST) && (gen_rand(&seed) & 1));
+        build_frame(&frames[i], threat, &seed);
+    }
+    nb_frames = GEN_TEMPLATES;
+    return 0;
+}
+
+// Classic libpcap format, either byte order, us or ns timestamps.
+// Frames are kept in memory; larger than GEN_MAX_FRAME are truncated.
+static int load_pcap(const char *path) {
+    struct { uint32_t magic; uint16_t major, minor; int32_t zone; uint32_t sigfigs, snaplen, link; } hdr;
+    struct { uint32_t sec, frac, incl, orig; } rec;
+    unsigned cap = 0;
+    FILE *f = fopen(path, "rb");
+
+    if (!f || fread(&hdr, sizeof(hdr), 1, f) != 1) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        goto fail;
+    }
+    bool swap = hdr.magic == rte_bswap32(PCAP_MAGIC_US) || hdr.magic == rte_bswap32(PCAP_MAGIC_NS);
+    if (!swap && hdr.magic != PCAP_MAGIC_US && hdr.magic != PCAP_MAGIC_NS) {
+        fprintf(stderr, "%s is not a pcap file\n", path);
+        goto fail;
+    }
+    if ((swap ? rte_bswap32(hdr.link) : hdr.link) != PCAP_LINK_ETHER) {
+        fprintf(stderr, "%s: only Ethernet captures can be replayed\n", path);
+        goto fail;
+    }
+
+    while (fread(&rec, sizeof(rec), 1, f) == 1) {
+        uint32_t len = swap ? rte_bswap32(rec.incl) : rec.incl;
+        if (nb_frames == cap) {
+            cap = cap ? cap * 2 : 1024;
+            struct frame *grown = realloc(frames, cap * sizeof(*frames));
+            if (!grown)
+                goto fail;
+            frames = grown;
+        }
+        struct frame *fr = &frames[nb_frames];
+        fr->len = (uint16_t)(len < GEN_MAX_FRAME ? len : GEN_MAX_FRAME);
+        if (fread(fr->data, 1, fr->len, f) != fr->len ||
+            (len > fr->len && fseek(f, len - fr->len, SEEK_CUR) != 0))
+            break;
+        if (fr->len >= sizeof(struct rte_ether_hdr))
+            nb_frames++;
+    }
+    fclose(f);
+    if (nb_frames == 0) {
+        fprintf(stderr, "%s holds no frames\n", path);
+        return -1;
+    }
+    return 0;
+
+fail:
+    if (f)
+        fclose(f);
+    return -1;
+}
+
+static int parse_args(int argc, char *argv[]) {
+    static const struct option long_opts[] = {
+        {"mix",      required_argument, NULL, 'm'},
+        {"pcap",     required_argument, NULL, 'p'},
+        {"rate",     required_argument, NULL, 'r'},
+        {"duration", required_argument, NULL, 'd'},
+        {"size",     required_argument, NULL, 's'},
+        {"tx-port",  required_argument, NULL, 't'},
+        {"rx-port",  required_argument, NULL, 'x'},
+        {"dst-mac",  required_argument, NULL, 'M'},
+        {"dst-ip",   required_argument, NULL, 'I'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    optind = 1;
+    while ((opt = getopt_long(argc, argv, "m:p:r:d:s:t:x:M:I:", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'm': {
+            unsigned i;
+            for (i = 0; i < sizeof(mix_names) / sizeof(mix_names[0]); i++)
+                if (strcmp(optarg, mix_names[i]) == 0)
+                    break;
+            if (i == sizeof(mix_names) / sizeof(mix_names[0])) {
+                fprintf(stderr, "Unknown mix '%s'\n", optarg);
+                return -1;
+            }
+            opts.mix = (enum gen_mix)i;
+            break;
+        }
+        case 'p': opts.pcap = optarg; break;
+        case 'r': opts.rate = strtoull(optarg, NULL, 10); break;
+        case 'd': opts.duration_s = (unsigned)strtoul(optarg, NULL, 10); break;
+        case 's':
+            opts.size = (unsigned)strtoul(optarg, NULL, 10);
+            if (opts.size < 60 || opts.size > GEN_MAX_FRAME) {
+                fprintf(stderr, "--size must be 60..%d\n", GEN_MAX_FRAME);
+                return -1;
+            }
+            break;
+        case 't': opts.tx_port = (uint16_t)strtoul(optarg, NULL, 10); break;
+        case 'x': opts.rx_port = (int)strtol(optarg, NULL, 10); break;
+        case 'M':
+            if (rte_ether_unformat_addr(optarg, &opts.dst_mac) < 0) {
+                fprintf(stderr, "Bad MAC '%s'\n", optarg);
+                return -1;
+            }
+            break;
+        case 'I': {
+            struct in_addr a;
+            if (inet_pton(AF_INET, optarg, &a) != 1) {
+                fprintf(stderr, "Bad IPv4 address '%s'\n", optarg);
+                return -1;
+            }
+            opts.dst_ip = rte_be_to_cpu_32(a.s_addr);
+            break;
+        }
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int port_init(uint16_t port, struct rte_mempool *pool, bool rx, bool tx) {
+    struct rte_eth_conf conf;
+
+    if (!rte_eth_dev_is_valid_port(port)) {
+        fprintf(stderr, "Port %u does not exist (add a --vdev)\n", port);
+        return -1;
+    }
+    memset(&conf, 0, sizeof(conf));
+    if (rte_eth_dev_configure(port, rx, tx, &conf) < 0 ||
+        (rx && rte_eth_rx_queue_setup(port, 0, GEN_RING_SIZE, rte_eth_dev_socket_id(port), NULL, pool) < 0) ||
+        (tx && rte_eth_tx_queue_setup(port, 0, GEN_RING_SIZE, rte_eth_dev_socket_id(port), NULL) < 0) ||
+        rte_eth_dev_start(port) < 0) {
+        fprintf(stderr, "Cannot start port %u\n", port);
+        return -1;
+    }
+    rte_eth_promiscuous_enable(port);
+    return 0;
+}
+
+static uint64_t rx_drain(void) {
+    struct rte_mbuf *mbufs[GEN_BURST];
+    uint16_t n;
+    uint64_t got = 0;
+
+    if (opts.rx_port < 0)
+        return 0;
+    while ((n = rte_eth_rx_burst((uint16_t)opts.rx_port, 0, mbufs, GEN_BURST)) > 0) {
+        rte_pktmbuf_free_bulk(mbufs, n);
+        got += n;
+    }
+    return got;
+}
+
+static void report(const char *metric, double value, const char *unit) {
+    char cas[64], rate[32] = "max";
+    if (opts.rate)
+        snprintf(rate, sizeof(rate), "%" PRIu64 "pps", opts.rate);
+    snprintf(cas, sizeof(cas), "%s_%s", opts.pcap ? "pcap" : mix_names[opts.mix], rate);
+    printf("traffic_gen,%s,%s,%.3f,%s\n", cas, metric, value, unit);
+}
+
+int main(int argc, char *argv[]) {
+    int eal_args = rte_eal_init(argc, argv);
+    if (eal_args < 0) {
+        fprintf(stderr, "EAL init failed\n");
+        return 1;
+    }
+    if (parse_args(argc - eal_args, argv + eal_args) < 0)
+        return 1;
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if ((opts.pcap ? load_pcap(opts.pcap) : build_frames()) < 0)
+        return 1;
+
+    struct rte_mempool *pool = rte_pktmbuf_pool_create("GEN_POOL", GEN_NUM_MBUFS, 256, 0,
+                                                       RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    if (!pool)
+        return 1;
+    bool same_port = opts.rx_port == opts.tx_port;
+    if (port_init(opts.tx_port, pool, same_port, true) < 0 ||
+        (opts.rx_port >= 0 && !same_port && port_init((uint16_t)opts.rx_port, pool, true, false) < 0))
+        return 1;
+
+    struct rte_mbuf *mbufs[GEN_BURST];
+    uint64_t hz = rte_get_tsc_hz(), seed = 0xD1B54A32D192ED03ULL;
+    uint64_t offered = 0, paced = 0, sent = 0, received = 0, alloc_fail = 0;
+    uint64_t start = rte_get_tsc_cycles(), end = start + hz * opts.duration_s;
+    uint64_t train_period = hz * TRAIN_PERIOD_MS / 1000, next_train = start + train_period;
+    unsigned train_left = 0, next_frame = 0;
+
+    uint64_t now;
+    while ((now = rte_get_tsc_cycles()) < end && !quit) {
+        unsigned want = GEN_BURST;
+        if (opts.mix == MIX_BURST && !opts.pcap && now >= next_train) {
+            train_left += TRAIN_MIN + gen_rand(&seed) % (TRAIN_MAX - TRAIN_MIN + 1);
+            next_train += train_period;
+        }
+        // Trains go out back-to-back on top of the paced load
+        bool in_train = train_left > 0;
+        if (in_train) {
+            want = RTE_MIN(train_left, (unsigned)GEN_BURST);
+        } else if (opts.rate) {
+            // Packets due by now at the target rate, not yet offered
+            uint64_t due = (uint64_t)((double)(now - start) / hz * opts.rate);
+            want = due > paced ? (unsigned)RTE_MIN(due - paced, (uint64_t)GEN_BURST) : 0;
+        }
+        if (want && rte_pktmbuf_alloc_bulk(pool, mbufs, want) < 0) {
+            alloc_fail += want;
+            want = 0;
+        }
+        for (unsigned i = 0; i < want; i++) {
+            const struct frame *fr = &frames[next_frame];
+            next_frame = next_frame + 1 == nb_frames ? 0 : next_frame + 1;
+            memcpy(rte_pktmbuf_append(mbufs[i], fr->len), fr->data, fr->len);
+        }
+        if (want) {
+            uint16_t n = rte_eth_tx_burst(opts.tx_port, 0, mbufs, (uint16_t)want);
+            if (n < want)
+                rte_pktmbuf_free_bulk(mbufs + n, want - n);
+            offered += want;
+            sent += n;
+            if (in_train)
+                train_left -= want;
+            else
+                paced += want;
+        }
+        received += rx_drain();
+    }
+    double elapsed = (double)(rte_get_tsc_cycles() - start) / hz;
+    uint64_t drain_end = rte_get_tsc_cycles() + hz * DRAIN_MS / 1000;
+    while (opts.rx_port >= 0 && rte_get_tsc_cycles() < drain_end)
+        received += rx_drain();
+
+    printf("benchmark,case,metric,value,unit\n");
+    report("offered_rate", offered / elapsed, "pps");
+    report("tx_rate", sent / elapsed, "pps");
+    report("tx_drop", offered ? 100.0 * (offered - sent) / offered : 0, "%");
+    report("alloc_fail", (double)alloc_fail, "pkts");
+    if (opts.rx_port >= 0) {
+        report("rx_rate", received / elapsed, "pps");
+        report("loss", sent ? 100.0 * (sent - RTE_MIN(received, sent)) / sent : 0, "%");
+    }
+    report("duration", elapsed, "s");
+
+    rte_eth_dev_stop(opts.tx_port);
+    if (opts.rx_port >= 0 && !same_port)
+        rte_eth_dev_stop((uint16_t)opts.rx_port);
+    free(frames);
+    rte_eal_cleanup();
+    return 0;
+}